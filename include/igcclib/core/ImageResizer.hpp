@@ -0,0 +1,332 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
+#include <igcclib/core/igcclib_eigen_def.hpp>
+#include <igcclib/core/ImageView.hpp>
+
+namespace _NS_UTILITY
+{
+	/// <summary>
+	/// Separable image resizer for many images of the same size. The filter taps and weights of both
+	/// axes are computed once by init(), then every resize() filters the rows of all channels together
+	/// into an intermediate buffer, and filters the columns from that buffer into the destination,
+	/// both in parallel over rows. The buffer and the sums are float for 8/16-bit and float images,
+	/// and double if the source or the destination is double. The intermediate buffer is kept, and the source is fully read before
+	/// the destination is written, so an image can be resized into itself.
+	/// Not thread safe, use one resizer per thread.
+	/// </summary>
+	class ImageResizer
+	{
+	public:
+		enum class Method
+		{
+			NEAREST,	//the same as cv::INTER_NEAREST
+			BILINEAR,	//the same as cv::INTER_LINEAR, without anti-aliasing
+			AREA,		//average of the covered source pixels when down sampling, bilinear when up sampling
+			LANCZOS		//lanczos with 3 lobes, widened by the scale when down sampling to avoid aliasing
+		};
+
+		/// <summary>
+		/// compute the filters, which are kept if the sizes and method are the same as the last call
+		/// </summary>
+		/// <returns>whether the filters are rebuilt</returns>
+		bool init(int src_width, int src_height, int dst_width, int dst_height, Method method = Method::BILINEAR);
+
+		/// <summary>
+		/// resize an image with the sizes given to init()
+		/// </summary>
+		/// <param name="src">the source view, of any layout</param>
+		/// <param name="dst">the destination view with the same number of channels, which can be the same memory as the source.
+		/// Integer outputs are rounded and saturated.</param>
+		template<typename S, typename D>
+		void resize(const ImageView_t<S>& src, const ImageView_t<D>& dst);
+
+		/// <summary>
+		/// resize an image with the sizes given to init(). The output has the same channels as the input,
+		/// and its storage is reused if it has the right size. The output can be the input.
+		/// </summary>
+		template<typename T>
+		void resize(const ImageRGBA_t<T>& input, ImageRGBA_t<T>& output);
+
+		int get_src_width() const { return m_filter_x.src_len; }
+		int get_src_height() const { return m_filter_y.src_len; }
+		int get_dst_width() const { return m_filter_x.dst_len; }
+		int get_dst_height() const { return m_filter_y.dst_len; }
+		Method get_method() const { return m_method; }
+
+	protected:
+		//the type of the buffer and the sums, double if either image is double
+		template<typename S, typename D>
+		using Accumulator_t = typename std::conditional<std::is_same<std::remove_const_t<S>, double>::value
+			|| std::is_same<std::remove_const_t<D>, double>::value, double, float>::type;
+
+		//the filter along one axis, output i is the sum of weights[i*n_tap+k] * input[start[i]+k]
+		struct AxisFilter
+		{
+			int src_len = 0;
+			int dst_len = 0;
+			int n_tap = 0;
+			std::vector<int> start;
+			std::vector<float> weights;
+			std::vector<double> weights_d;	//the same weights in double precision
+
+			void build(int _src_len, int _dst_len, Method method);
+
+			template<typename T>
+			const T* get_weights() const {
+				if constexpr (std::is_same<T, double>::value)
+					return weights_d.data();
+				else
+					return weights.data();
+			}
+		};
+
+		template<typename T>
+		std::vector<T>& get_buffer() {
+			if constexpr (std::is_same<T, double>::value)
+				return m_buffer_d;
+			else
+				return m_buffer;
+		}
+
+		//filter the rows of the source into the buffer, interleaved
+		template<int NCH, typename T, typename S>
+		void filter_rows(const ImageView_t<S>& src);
+
+		//filter the columns of the buffer into the destination
+		template<typename T, typename D>
+		void filter_columns(const ImageView_t<D>& dst);
+
+		template<typename T, typename S>
+		void filter_rows_by_channel(const ImageView_t<S>& src);
+
+	protected:
+		AxisFilter m_filter_x, m_filter_y;
+		Method m_method = Method::BILINEAR;
+		int m_n_channel = 0;
+		std::vector<float> m_buffer;	//src_height x dst_width x channels
+		std::vector<double> m_buffer_d;	//the buffer for double images
+	};
+}
+
+namespace _NS_UTILITY
+{
+	inline bool ImageResizer::init(int src_width, int src_height, int dst_width, int dst_height, Method method)
+	{
+		assert_throw(src_width > 0 && src_height > 0 && dst_width > 0 && dst_height > 0, "image size must be positive");
+		bool is_same = method == m_method
+			&& m_filter_x.src_len == src_width && m_filter_x.dst_len == dst_width
+			&& m_filter_y.src_len == src_height && m_filter_y.dst_len == dst_height;
+		if (is_same)
+			return false;
+
+		m_method = method;
+		m_filter_x.build(src_width, dst_width, method);
+		m_filter_y.build(src_height, dst_height, method);
+		return true;
+	}
+
+	inline void ImageResizer::AxisFilter::build(int _src_len, int _dst_len, Method method)
+	{
+		src_len = _src_len;
+		dst_len = _dst_len;
+		double scale = (double)src_len / dst_len;
+		const double pi = std::acos(-1.0);
+		auto sinc = [pi](double x) { return x == 0 ? 1.0 : std::sin(pi * x) / (pi * x); };
+
+		//contributions of the source pixels to each output, indices are clamped to the border
+		std::vector<std::vector<std::pair<int, double>>> taps(dst_len);
+		for (int i = 0; i < dst_len; i++)
+		{
+			auto& t = taps[i];
+			if (method == Method::NEAREST)
+				t.emplace_back(std::min((int)std::floor(i * scale), src_len - 1), 1.0);
+			else if (method == Method::BILINEAR || (method == Method::AREA && scale <= 1))
+			{
+				double c = (i + 0.5) * scale - 0.5;
+				int i0 = (int)std::floor(c);
+				double f = c - i0;
+				t.emplace_back(i0, 1 - f);
+				t.emplace_back(i0 + 1, f);
+			}
+			else if (method == Method::AREA)
+			{
+				double a = i * scale;
+				double b = (i + 1) * scale;
+				for (int k = (int)std::floor(a); k < (int)std::ceil(b); k++)
+					t.emplace_back(k, (std::min(b, k + 1.0) - std::max(a, (double)k)) / scale);
+			}
+			else
+			{
+				double filter_scale = std::max(scale, 1.0);
+				double support = 3 * filter_scale;
+				double c = (i + 0.5) * scale;
+				double sum = 0;
+				for (int k = (int)std::floor(c - support); k <= (int)std::ceil(c + support); k++)
+				{
+					double x = (k + 0.5 - c) / filter_scale;
+					if (std::abs(x) >= 3)
+						continue;
+					double w = sinc(x) * sinc(x / 3);
+					t.emplace_back(k, w);
+					sum += w;
+				}
+				for (auto& x : t)
+					x.second /= sum;
+			}
+
+			for (auto& x : t)
+				x.first = std::min(std::max(x.first, 0), src_len - 1);
+		}
+
+		//fixed number of taps, so that every output reads a contiguous window
+		n_tap = 1;
+		for (const auto& t : taps)
+		{
+			int lo = src_len, hi = 0;
+			for (const auto& x : t)
+			{
+				lo = std::min(lo, x.first);
+				hi = std::max(hi, x.first);
+			}
+			n_tap = std::max(n_tap, hi - lo + 1);
+		}
+		n_tap = std::min(n_tap, src_len);
+
+		start.assign(dst_len, 0);
+		weights_d.assign((size_t)dst_len * n_tap, 0.0);
+		for (int i = 0; i < dst_len; i++)
+		{
+			int lo = src_len;
+			for (const auto& x : taps[i])
+				lo = std::min(lo, x.first);
+			start[i] = std::min(lo, src_len - n_tap);
+			for (const auto& x : taps[i])
+				weights_d[(size_t)i * n_tap + x.first - start[i]] += x.second;
+		}
+		weights.assign(weights_d.begin(), weights_d.end());
+	}
+
+	template<int NCH, typename T, typename S>
+	void ImageResizer::filter_rows(const ImageView_t<S>& src)
+	{
+		int height = src.get_height();
+		int width = m_filter_x.dst_len;
+		int n_tap = m_filter_x.n_tap;
+		ptrdiff_t step = src.get_pixel_stride();
+		const int* starts = m_filter_x.start.data();
+		const T* weights = m_filter_x.get_weights<T>();
+		std::vector<T>& buffer = get_buffer<T>();
+		buffer.resize((size_t)height * width * NCH);
+
+#pragma omp parallel for if((int64_t)width * height >= _ImageView::PARALLEL_MIN_PIXELS)
+		for (int y = 0; y < height; y++)
+		{
+			S* s[NCH];
+			for (int c = 0; c < NCH; c++)
+				s[c] = src.ptr(c, y);
+			T* out = buffer.data() + (size_t)y * width * NCH;
+			for (int x = 0; x < width; x++)
+			{
+				const T* w = weights + (size_t)x * n_tap;
+				ptrdiff_t p = starts[x] * step;
+				T acc[NCH] = {};
+				for (int k = 0; k < n_tap; k++, p += step)
+					for (int c = 0; c < NCH; c++)
+						acc[c] += w[k] * (T)s[c][p];
+				for (int c = 0; c < NCH; c++)
+					out[x * NCH + c] = acc[c];
+			}
+		}
+	}
+
+	template<typename T, typename S>
+	void ImageResizer::filter_rows_by_channel(const ImageView_t<S>& src)
+	{
+		m_n_channel = src.get_number_of_channels();
+		switch (m_n_channel) {
+		case 1:
+			filter_rows<1, T>(src);
+			break;
+		case 2:
+			filter_rows<2, T>(src);
+			break;
+		case 3:
+			filter_rows<3, T>(src);
+			break;
+		default:
+			filter_rows<4, T>(src);
+		}
+	}
+
+	template<typename T, typename D>
+	void ImageResizer::filter_columns(const ImageView_t<D>& dst)
+	{
+		int height = m_filter_y.dst_len;
+		int width = m_filter_x.dst_len;
+		int n_ch = m_n_channel;
+		int n_tap = m_filter_y.n_tap;
+		size_t row_len = (size_t)width * n_ch;
+		ptrdiff_t step = dst.get_pixel_stride();
+		const T* weights = m_filter_y.get_weights<T>();
+		const T* buffer = get_buffer<T>().data();
+
+#pragma omp parallel if((int64_t)width * height >= _ImageView::PARALLEL_MIN_PIXELS)
+		{
+			std::vector<T> acc(row_len);
+#pragma omp for
+			for (int y = 0; y < height; y++)
+			{
+				//the taps are rows of the buffer, so the inner loop runs over contiguous memory
+				const T* w = weights + (size_t)y * n_tap;
+				const T* in = buffer + (size_t)m_filter_y.start[y] * row_len;
+				std::fill(acc.begin(), acc.end(), (T)0);
+				for (int k = 0; k < n_tap; k++, in += row_len)
+					for (size_t i = 0; i < row_len; i++)
+						acc[i] += w[k] * in[i];
+
+				for (int c = 0; c < n_ch; c++)
+				{
+					D* d = dst.ptr(c, y);
+					for (int x = 0; x < width; x++)
+						d[x * step] = _ImageView::cast_value<D>(acc[x * n_ch + c]);
+				}
+			}
+		}
+	}
+
+	template<typename S, typename D>
+	void ImageResizer::resize(const ImageView_t<S>& src, const ImageView_t<D>& dst)
+	{
+		static_assert(!std::is_const<D>::value, "cannot write to a read-only view");
+		assert_throw(src.get_width() == get_src_width() && src.get_height() == get_src_height(), "source size does not match the resizer");
+		assert_throw(dst.get_width() == get_dst_width() && dst.get_height() == get_dst_height(), "destination size does not match the resizer");
+		assert_throw(src.get_number_of_channels() == dst.get_number_of_channels(), "number of channels mismatch between views");
+		using T = Accumulator_t<S, D>;
+		filter_rows_by_channel<T>(src);
+		filter_columns<T>(dst);
+	}
+
+	template<typename T>
+	void ImageResizer::resize(const ImageRGBA_t<T>& input, ImageRGBA_t<T>& output)
+	{
+		assert_throw(input.get_width() == get_src_width() && input.get_height() == get_src_height(), "source size does not match the resizer");
+		bool has_channel[4];
+		for (int i = 0; i < 4; i++)
+			has_channel[i] = input.get_channel(i).size() > 0;
+
+		//the input is not needed after the rows are filtered, so the output may reuse its storage
+		using A = Accumulator_t<T, T>;
+		filter_rows_by_channel<A>(input.get_view());
+		for (int i = 0; i < 4; i++)
+		{
+			if (has_channel[i])
+				output.get_channel(i).resize(get_dst_height(), get_dst_width());
+			else
+				output.get_channel(i).resize(0, 0);
+		}
+		filter_columns<A>(output.get_view());
+	}
+}
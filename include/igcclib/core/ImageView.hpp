@@ -0,0 +1,434 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <igcclib/igcclib_master.hpp>
+
+namespace _NS_UTILITY
+{
+	/// <summary>
+	/// Non-owning view of an image with up to 4 channels. Every channel has its own base pointer,
+	/// and pixels are addressed by a pixel stride and a row stride counted in elements, so the same
+	/// view describes interleaved buffers (RGBARGBA, cv::Mat) and planar buffers (the channels of
+	/// ImageRGBA_t) without copying. ImageView_t&lt;const T&gt; is a read-only view.
+	/// </summary>
+	template<typename T>
+	class ImageView_t
+	{
+	public:
+		static const int MAX_CHANNEL = 4;
+
+		ImageView_t() {}
+
+		//a view of T can be used where a view of const T is expected
+		template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+		ImageView_t(const ImageView_t<U>& other)
+			: m_width(other.m_width), m_height(other.m_height), m_n_channel(other.m_n_channel),
+			m_pixel_stride(other.m_pixel_stride), m_row_stride(other.m_row_stride)
+		{
+			for (int i = 0; i < MAX_CHANNEL; i++)
+				m_data[i] = other.m_data[i];
+		}
+
+		/// <summary>
+		/// view of an interleaved buffer, where the channels of a pixel are adjacent
+		/// </summary>
+		/// <param name="data">pointer to the first channel of the first pixel</param>
+		/// <param name="row_stride">number of elements between two rows, if negative, the rows are packed</param>
+		static ImageView_t from_interleaved(T* data, int width, int height, int n_channel, ptrdiff_t row_stride = -1)
+		{
+			assert_throw(n_channel > 0 && n_channel <= MAX_CHANNEL, "number of channels must be within 1 to 4");
+			ImageView_t view;
+			view.m_width = width;
+			view.m_height = height;
+			view.m_n_channel = n_channel;
+			view.m_pixel_stride = n_channel;
+			view.m_row_stride = row_stride < 0 ? (ptrdiff_t)width * n_channel : row_stride;
+			for (int i = 0; i < n_channel; i++)
+				view.m_data[i] = data + i;
+			return view;
+		}
+
+		/// <summary>
+		/// view of separate channel planes, which share the same row stride
+		/// </summary>
+		/// <param name="planes">pointers to the first element of each plane</param>
+		/// <param name="row_stride">number of elements between two rows, if negative, the rows are packed</param>
+		static ImageView_t from_planes(T* const* planes, int width, int height, int n_channel, ptrdiff_t row_stride = -1)
+		{
+			assert_throw(n_channel > 0 && n_channel <= MAX_CHANNEL, "number of channels must be within 1 to 4");
+			ImageView_t view;
+			view.m_width = width;
+			view.m_height = height;
+			view.m_n_channel = n_channel;
+			view.m_pixel_stride = 1;
+			view.m_row_stride = row_stride < 0 ? (ptrdiff_t)width : row_stride;
+			for (int i = 0; i < n_channel; i++)
+				view.m_data[i] = planes[i];
+			return view;
+		}
+
+		int get_width() const { return m_width; }
+		int get_height() const { return m_height; }
+		int get_number_of_channels() const { return m_n_channel; }
+		ptrdiff_t get_pixel_stride() const { return m_pixel_stride; }
+		ptrdiff_t get_row_stride() const { return m_row_stride; }
+		bool is_empty() const { return m_width == 0 || m_height == 0 || m_n_channel == 0; }
+
+		/** \brief are the channels of a pixel adjacent in memory? */
+		bool is_interleaved() const {
+			if (m_pixel_stride != m_n_channel)
+				return false;
+			for (int i = 1; i < m_n_channel; i++)
+				if (m_data[i] != m_data[0] + i)
+					return false;
+			return true;
+		}
+
+		/** \brief are the pixels of a channel adjacent in memory? */
+		bool is_planar() const { return m_pixel_stride == 1; }
+
+		/** \brief is there no gap between rows? */
+		bool is_continuous() const { return m_row_stride == m_pixel_stride * m_width; }
+
+		/** \brief pointer to the first element of a row in a channel */
+		T* ptr(int channel, int y) const { return m_data[channel] + y * m_row_stride; }
+
+		T& at(int channel, int y, int x) const { return m_data[channel][y * m_row_stride + x * m_pixel_stride]; }
+
+		/** \brief view of a single channel */
+		ImageView_t get_channel(int channel) const {
+			assert_throw(channel >= 0 && channel < m_n_channel, "channel out of range");
+			ImageView_t view = *this;
+			view.m_n_channel = 1;
+			view.m_data[0] = m_data[channel];
+			for (int i = 1; i < MAX_CHANNEL; i++)
+				view.m_data[i] = nullptr;
+			return view;
+		}
+
+		/// <summary>
+		/// view of selected channels in the given order, e.g. {2,1,0} views RGB as BGR.
+		/// A channel can be selected more than once, e.g. {0,0,0} views gray as RGB for reading.
+		/// </summary>
+		ImageView_t get_channels(const int* channels, int n_channel) const {
+			assert_throw(n_channel > 0 && n_channel <= MAX_CHANNEL, "number of channels must be within 1 to 4");
+			ImageView_t view = *this;
+			view.m_n_channel = n_channel;
+			for (int i = 0; i < MAX_CHANNEL; i++)
+			{
+				if (i < n_channel)
+				{
+					assert_throw(channels[i] >= 0 && channels[i] < m_n_channel, "channel out of range");
+					view.m_data[i] = m_data[channels[i]];
+				}
+				else
+					view.m_data[i] = nullptr;
+			}
+			return view;
+		}
+
+		/** \brief view of a rectangular region */
+		ImageView_t get_region(int x, int y, int width, int height) const {
+			assert_throw(x >= 0 && y >= 0 && x + width <= m_width && y + height <= m_height, "region out of range");
+			ImageView_t view = *this;
+			view.m_width = width;
+			view.m_height = height;
+			for (int i = 0; i < m_n_channel; i++)
+				view.m_data[i] = m_data[i] + y * m_row_stride + x * m_pixel_stride;
+			return view;
+		}
+
+	protected:
+		template<typename U> friend class ImageView_t;
+
+		T* m_data[MAX_CHANNEL] = { nullptr, nullptr, nullptr, nullptr };
+		int m_width = 0;
+		int m_height = 0;
+		int m_n_channel = 0;
+		ptrdiff_t m_pixel_stride = 0;
+		ptrdiff_t m_row_stride = 0;
+	};
+
+	/// <summary>
+	/// copy pixels between two views of the same size and number of channels, converting the layout and the
+	/// data type. The values are transformed as dst = src * scale + offset, and rounded and saturated when
+	/// the destination is an integer type. Rows are processed in parallel, rows with the same layout and type
+	/// are copied by memcpy, and layout changes of 1 to 4 channels use loops with compile-time strides
+	/// so that they can be vectorized.
+	/// </summary>
+	/// <param name="src">the source view</param>
+	/// <param name="dst">the destination view, which must not overlap with the source</param>
+	template<typename S, typename D>
+	void copy_image_view(const ImageView_t<S>& src, const ImageView_t<D>& dst, double scale = 1.0, double offset = 0.0);
+
+	/// <summary>
+	/// convert between image formats in one pass, covering channel swizzles (RGB and BGR), adding or
+	/// dropping alpha, expanding gray to color, and color to gray with the weights of cv::cvtColor.
+	/// The values are transformed as dst = src * scale + offset like copy_image_view(), an added alpha
+	/// channel is opaque, which is 1 for floating point and the max value for integers.
+	/// </summary>
+	/// <param name="src">the source view, with the number of channels of src_format</param>
+	/// <param name="src_format">the format of the source</param>
+	/// <param name="dst">the destination view of the same size, with the number of channels of dst_format</param>
+	/// <param name="dst_format">the format of the destination</param>
+	template<typename S, typename D>
+	void convert_image_format(const ImageView_t<S>& src, ImageFormat src_format,
+		const ImageView_t<D>& dst, ImageFormat dst_format, double scale = 1.0, double offset = 0.0);
+}
+
+namespace _NS_UTILITY
+{
+	namespace _ImageView {
+		//smaller images are converted in a single thread
+		const int64_t PARALLEL_MIN_PIXELS = 1 << 16;
+
+		//convert a value, integer outputs are rounded and saturated like cv::saturate_cast
+		template<typename D, typename S>
+		inline D cast_value(S v) {
+			if constexpr (std::is_floating_point<D>::value || std::is_same<D, S>::value)
+				return (D)v;
+			else if constexpr (std::is_integral<S>::value)
+				return (D)std::min<int64_t>(std::max<int64_t>((int64_t)v, (int64_t)std::numeric_limits<D>::lowest()),
+					(int64_t)std::numeric_limits<D>::max());
+			else
+				return (D)std::min<double>(std::max<double>(std::round((double)v), (double)std::numeric_limits<D>::lowest()),
+					(double)std::numeric_limits<D>::max());
+		}
+
+		//copy one row of NCH channels, SRC_STEP and DST_STEP are the pixel strides, 0 means runtime stride
+		template<int NCH, int SRC_STEP, int DST_STEP, typename S, typename D, typename FUNC_T>
+		inline void copy_row(S* const* src, ptrdiff_t src_step, D* const* dst, ptrdiff_t dst_step, int width, FUNC_T func)
+		{
+			const ptrdiff_t ss = SRC_STEP > 0 ? SRC_STEP : src_step;
+			const ptrdiff_t ds = DST_STEP > 0 ? DST_STEP : dst_step;
+
+			//pixels in the outer loop, so that the unrolled channel loop forms the (de)interleaving pattern
+			for (int x = 0; x < width; x++)
+				for (int c = 0; c < NCH; c++)
+					dst[c][x * ds] = func(src[c][x * ss]);
+		}
+
+		template<int NCH, int SRC_STEP, int DST_STEP, typename S, typename D, typename FUNC_T>
+		void copy_rows_kernel(const ImageView_t<S>& src, const ImageView_t<D>& dst, FUNC_T func)
+		{
+			int height = src.get_height();
+			int width = src.get_width();
+			ptrdiff_t src_step = src.get_pixel_stride();
+			ptrdiff_t dst_step = dst.get_pixel_stride();
+#pragma omp parallel for if((int64_t)width * height >= PARALLEL_MIN_PIXELS)
+			for (int y = 0; y < height; y++)
+			{
+				S* s[NCH];
+				D* d[NCH];
+				for (int c = 0; c < NCH; c++)
+				{
+					s[c] = src.ptr(c, y);
+					d[c] = dst.ptr(c, y);
+				}
+				copy_row<NCH, SRC_STEP, DST_STEP>(s, src_step, d, dst_step, width, func);
+			}
+		}
+
+		//pick the kernel by the pixel strides, planar (1), packed (NCH) and 4-byte pixels with
+		//fewer channels (e.g. RGB of RGBA) are compile-time strides
+		template<int NCH, int SRC_STEP, typename S, typename D, typename FUNC_T>
+		void copy_rows_by_dst_step(const ImageView_t<S>& src, const ImageView_t<D>& dst, FUNC_T func)
+		{
+			ptrdiff_t step = dst.get_pixel_stride();
+			if (step == 1)
+				copy_rows_kernel<NCH, SRC_STEP, 1>(src, dst, func);
+			else if (step == NCH)
+				copy_rows_kernel<NCH, SRC_STEP, NCH>(src, dst, func);
+			else if (step == 4)
+				copy_rows_kernel<NCH, SRC_STEP, 4>(src, dst, func);
+			else
+				copy_rows_kernel<NCH, SRC_STEP, 0>(src, dst, func);
+		}
+
+		template<int NCH, typename S, typename D, typename FUNC_T>
+		void copy_rows(const ImageView_t<S>& src, const ImageView_t<D>& dst, FUNC_T func)
+		{
+			ptrdiff_t step = src.get_pixel_stride();
+			if (step == 1)
+				copy_rows_by_dst_step<NCH, 1>(src, dst, func);
+			else if (step == NCH)
+				copy_rows_by_dst_step<NCH, NCH>(src, dst, func);
+			else if (step == 4)
+				copy_rows_by_dst_step<NCH, 4>(src, dst, func);
+			else
+				copy_rows_by_dst_step<NCH, 0>(src, dst, func);
+		}
+
+		template<typename S, typename D, typename FUNC_T>
+		void copy_rows_by_channel(const ImageView_t<S>& src, const ImageView_t<D>& dst, FUNC_T func)
+		{
+			switch (src.get_number_of_channels()) {
+			case 1:
+				copy_rows<1>(src, dst, func);
+				break;
+			case 2:
+				copy_rows<2>(src, dst, func);
+				break;
+			case 3:
+				copy_rows<3>(src, dst, func);
+				break;
+			default:
+				copy_rows<4>(src, dst, func);
+			}
+		}
+	}
+
+	template<typename S, typename D>
+	void copy_image_view(const ImageView_t<S>& src, const ImageView_t<D>& dst, double scale, double offset)
+	{
+		using SRC_T = typename std::remove_const<S>::type;
+		static_assert(!std::is_const<D>::value, "cannot write to a read-only view");
+		assert_throw(src.get_width() == dst.get_width() && src.get_height() == dst.get_height(), "size mismatch between views");
+		assert_throw(src.get_number_of_channels() == dst.get_number_of_channels(), "number of channels mismatch between views");
+		if (src.is_empty())
+			return;
+
+		bool is_identity = scale == 1.0 && offset == 0.0;
+		if constexpr (std::is_same<SRC_T, D>::value)
+		{
+			//same type and layout, copy the rows as raw memory
+			bool both_interleaved = src.is_interleaved() && dst.is_interleaved();
+			bool both_planar = src.is_planar() && dst.is_planar();
+			if (is_identity && (both_interleaved || both_planar))
+			{
+				int n_plane = both_interleaved ? 1 : src.get_number_of_channels();
+				size_t row_bytes = sizeof(D) * src.get_width() * (both_interleaved ? src.get_number_of_channels() : 1);
+				int height = src.get_height();
+#pragma omp parallel for if((int64_t)src.get_width() * height >= _ImageView::PARALLEL_MIN_PIXELS)
+				for (int y = 0; y < height; y++)
+					for (int c = 0; c < n_plane; c++)
+						std::memcpy(dst.ptr(c, y), src.ptr(c, y), row_bytes);
+				return;
+			}
+		}
+
+		if (is_identity)
+			_ImageView::copy_rows_by_channel(src, dst, [](SRC_T v) { return _ImageView::cast_value<D>(v); });
+		else
+			_ImageView::copy_rows_by_channel(src, dst, [scale, offset](SRC_T v) {
+				return _ImageView::cast_value<D>((double)v * scale + offset);
+			});
+	}
+
+	namespace _ImageView {
+		//channel of r,g,b,a in the format, -1 if absent. Gray provides r,g,b from its only channel.
+		inline void get_rgba_index(ImageFormat fmt, int* index)
+		{
+			int r = -1, g = -1, b = -1, a = -1;
+			switch (fmt) {
+			case ImageFormat::GRAY:
+				r = g = b = 0;
+				break;
+			case ImageFormat::RGB:
+				r = 0; g = 1; b = 2;
+				break;
+			case ImageFormat::RGBA:
+				r = 0; g = 1; b = 2; a = 3;
+				break;
+			case ImageFormat::BGR:
+				b = 0; g = 1; r = 2;
+				break;
+			case ImageFormat::BGRA:
+				b = 0; g = 1; r = 2; a = 3;
+				break;
+			default:
+				break;
+			}
+			index[0] = r;
+			index[1] = g;
+			index[2] = b;
+			index[3] = a;
+		}
+
+		template<typename D>
+		void fill_channel(const ImageView_t<D>& view, int channel, D value)
+		{
+			int height = view.get_height();
+			int width = view.get_width();
+			ptrdiff_t step = view.get_pixel_stride();
+#pragma omp parallel for if((int64_t)width * height >= PARALLEL_MIN_PIXELS)
+			for (int y = 0; y < height; y++)
+			{
+				D* p = view.ptr(channel, y);
+				for (int x = 0; x < width; x++)
+					p[x * step] = value;
+			}
+		}
+	}
+
+	template<typename S, typename D>
+	void convert_image_format(const ImageView_t<S>& src, ImageFormat src_format,
+		const ImageView_t<D>& dst, ImageFormat dst_format, double scale, double offset)
+	{
+		static_assert(!std::is_const<D>::value, "cannot write to a read-only view");
+		assert_throw(src_format != ImageFormat::NONE && dst_format != ImageFormat::NONE, "image format is not specified");
+		assert_throw(src.get_number_of_channels() == get_num_channel(src_format), "source does not match its format");
+		assert_throw(dst.get_number_of_channels() == get_num_channel(dst_format), "destination does not match its format");
+		assert_throw(src.get_width() == dst.get_width() && src.get_height() == dst.get_height(), "size mismatch between views");
+		if (src.is_empty())
+			return;
+
+		int src_index[4], dst_index[4];
+		_ImageView::get_rgba_index(src_format, src_index);
+		_ImageView::get_rgba_index(dst_format, dst_index);
+
+		//color to gray, weighted sum of r,g,b
+		if (dst_format == ImageFormat::GRAY && src_format != ImageFormat::GRAY)
+		{
+			int height = src.get_height();
+			int width = src.get_width();
+			ptrdiff_t ss = src.get_pixel_stride();
+			ptrdiff_t ds = dst.get_pixel_stride();
+#pragma omp parallel for if((int64_t)width * height >= _ImageView::PARALLEL_MIN_PIXELS)
+			for (int y = 0; y < height; y++)
+			{
+				const S* r = src.ptr(src_index[0], y);
+				const S* g = src.ptr(src_index[1], y);
+				const S* b = src.ptr(src_index[2], y);
+				D* d = dst.ptr(0, y);
+				for (int x = 0; x < width; x++)
+				{
+					double v = 0.299 * r[x * ss] + 0.587 * g[x * ss] + 0.114 * b[x * ss];
+					d[x * ds] = _ImageView::cast_value<D>(v * scale + offset);
+				}
+			}
+			return;
+		}
+
+		//every destination channel reads one source channel, except an added alpha
+		int src_channels[4], dst_channels[4];
+		int n_copy = 0;
+		int alpha_channel = -1;
+		for (int k = 0; k < 4; k++)
+		{
+			int di = dst_index[k];
+			if (di < 0 || std::find(dst_channels, dst_channels + n_copy, di) != dst_channels + n_copy)
+				continue;
+			if (src_index[k] < 0)
+				alpha_channel = di;
+			else
+			{
+				src_channels[n_copy] = src_index[k];
+				dst_channels[n_copy] = di;
+				n_copy++;
+			}
+		}
+
+		copy_image_view(src.get_channels(src_channels, n_copy), dst.get_channels(dst_channels, n_copy), scale, offset);
+		if (alpha_channel >= 0)
+		{
+			D alpha = std::is_integral<D>::value ? std::numeric_limits<D>::max() : (D)1;
+			_ImageView::fill_channel(dst, alpha_channel, alpha);
+		}
+	}
+}
@@ -2,6 +2,7 @@
 #pragma once
 #include <Eigen/Eigen>
 #include <igcclib/igcclib_master.hpp>
+#include <igcclib/core/ImageView.hpp>
 
 namespace _NS_UTILITY
 {
@@ -147,12 +148,15 @@ namespace _NS_UTILITY
 		template<typename D>
 		void convert_to(ImageRGBA_t<D>& output, double value_scale, double value_offset = 0) const
 		{
-			for (int i = 0; i < get_number_of_channels(); i++)
+			//the output has the same channels, integer outputs are rounded and saturated
+			for (int i = 0; i < 4; i++)
 			{
-				MATRIX_d x = get_channel(i).template cast<double>();
-				x.array() = x.array() * value_scale + value_offset;
-				output.get_channel(i) = x.template cast<D>();
+				if (get_channel(i).size() > 0)
+					output.get_channel(i).resize(get_height(), get_width());
+				else
+					output.get_channel(i).resize(0, 0);
 			}
+			copy_image_view(get_view(), output.get_view(), value_scale, value_offset);
 		}
 
 		void clear(T r, T g, T b, T a)
@@ -274,6 +278,24 @@ namespace _NS_UTILITY
 				throw std::logic_error("channel out of range");
 		}
 
+		/// <summary>
+		/// planar view of the non-empty channels, in RGBA order, without copying
+		/// </summary>
+		ImageView_t<T> get_view() {
+			T* planes[4];
+			int nch = 0;
+			for (int i = 0; i < 4; i++)
+				if (get_channel(i).size() > 0)
+					planes[nch++] = get_channel(i).data();
+			if (nch == 0)
+				return ImageView_t<T>();
+			return ImageView_t<T>::from_planes(planes, get_width(), get_height(), nch);
+		}
+
+		ImageView_t<const T> get_view() const {
+			return const_cast<ImageRGBA_t*>(this)->get_view();
+		}
+
 		/// <summary>
 		/// convert the image into linear buffer, in RGBARGBA format.
 		/// The pixel data will be normalized to [out_min, out_max]
@@ -287,26 +309,15 @@ namespace _NS_UTILITY
 		void to_linear_buffer(std::vector<D>& output,
 			float_type in_min, float_type in_max, float_type out_min, float_type out_max) const
 		{
-			int width = get_width();
-			int height = get_height();
-			int nch = get_number_of_channels();
-
-			std::vector<const MATRIX_t<T>*> matlist;
-
-			for (int i = 0; i < nch; i++)
-				matlist.push_back(&get_channel(i));
-
-			int w = 0;
-			output.resize(width * height * nch);
-			auto in_len = in_max - in_min;
-			auto out_len = out_max - out_min;
-			for (int i = 0; i < width * height; i++)
-			{
-				for (int k = 0; k < matlist.size(); k++)
-				{
-					output[w++] = (D)((float_type((*matlist[k])(i)) - in_min) / in_len * out_len + out_min);
-				}
-			}
+			auto src = get_view();
+			int nch = src.get_number_of_channels();
+			output.resize((size_t)get_width() * get_height() * nch);
+			if (nch == 0)
+				return;
+
+			double scale = (out_max - out_min) / (in_max - in_min);
+			double offset = out_min - in_min * scale;
+			copy_image_view(src, ImageView_t<D>::from_interleaved(output.data(), get_width(), get_height(), nch), scale, offset);
 		}
 
 		template<typename D>
@@ -318,24 +329,16 @@ namespace _NS_UTILITY
 
 			//collect the channels
 			this->allocate(width, height, n_channel);
-			std::vector<MATRIX_t<T>*> matlist;
+			T* planes[4];
 			for (size_t i = 0; i < n_channel; i++)
-				matlist.push_back(&get_channel(i));
-
-			auto in_len = in_max - in_min;
-			auto out_len = out_max - out_min;
-
-			for (size_t i = 0; i < width * height; i++)
-			{
-				for (size_t k = 0; k < n_channel; k++)
-				{
-					//read a pixel and normalize it
-					T value = (T)((float_type(input[i * n_channel + k]) - in_min) / in_len * out_len + out_min);
-
-					//write it
-					(*matlist[k])(i) = value;
-				}
-			}
+				planes[i] = get_channel(i).data();
+			if (input.empty())
+				return;
+
+			double scale = (out_max - out_min) / (in_max - in_min);
+			double offset = out_min - in_min * scale;
+			copy_image_view(ImageView_t<const D>::from_interleaved(input.data(), (int)width, (int)height, (int)n_channel),
+				ImageView_t<T>::from_planes(planes, (int)width, (int)height, (int)n_channel), scale, offset);
 		}
 	};
 
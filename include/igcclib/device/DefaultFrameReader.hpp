@@ -1,6 +1,7 @@
 #pragma once
 
 #include <igcclib/device/FrameReader.hpp>
+#include <igcclib/vision/DepthColorRegistration.hpp>
 
 namespace _NS_UTILITY
 {
@@ -19,15 +20,23 @@ namespace _NS_UTILITY
 		virtual bool get_depth_image(cv::Mat* output) const override;
 
 		virtual bool get_color_coordinate_for_depth(fVECTOR_2* out_color_xy, const iVECTOR_2& depth_xy) const override;
+
+		/** \brief the depth2color_xy segment is returned as reference. Without it, the coordinates are computed from the cameras. */
 		virtual bool get_color_coordinate_for_depth(cv::Mat* out_depth2color_xy, cv::Mat* out_mask) const override;
 
 		/** \brief image format is not used in default frame reader, we just copy the value as is */
 		virtual bool get_color_value_for_depth(iVECTOR_4* out_color_value, const iVECTOR_2& depth_xy, ImageFormat fmt = ImageFormat::NONE) const override;
 
-		/** \brief image format is not used in default frame reader, we just copy the value as is */
+		/** \brief image format is not used in default frame reader, we just copy the value as is.
+		The depth2color segment is returned as reference. Otherwise the color image is sampled through the depth2color_xy
+		segment, or through the registration of the cameras if there is no such segment. */
 		virtual bool get_color_value_for_depth(cv::Mat* out_depth2color, cv::Mat* out_mask, ImageFormat fmt = ImageFormat::NONE) const override;
 		virtual CameraModel get_depth_camera() const override;
 		virtual bool get_depth_3d_point(fVECTOR_3* out_point, const iVECTOR_2& depth_xy) const override;
+
+		/** \brief use the depth2xyz segment if it exists and normals are not requested, otherwise back project the depth image
+		through the rays of the depth camera */
+		virtual bool get_depth_point_cloud(cv::Mat* out_depth2xyz, cv::Mat* out_normals = nullptr) const override;
 		virtual bool get_color_image(cv::Mat* output, ImageFormat fmt = ImageFormat::NONE) const override;
 		virtual void set_framedata(FrameData::Ptr data) override;
 		virtual CameraModel get_color_camera() const override;
@@ -37,6 +46,18 @@ namespace _NS_UTILITY
 	public:
 		using DepthValue_t = uint16_t;
 
+	protected:
+		/** \brief the registration of the color camera to the depth camera, built by set_framedata().
+		Return nullptr if either image is missing or either camera has no projection. */
+		const DepthColorRegistration* get_registration() const { return m_has_registration ? &m_registration : nullptr; }
+
+		/** \brief the rays of the depth camera, built by set_framedata(). Return nullptr if there is no depth image
+		or the depth camera has no projection. */
+		const DepthBackProjector* get_depth_rays() const { return m_has_depth_rays ? &m_registration.get_depth_rays() : nullptr; }
+
+		/** \brief rebuild the depth rays and the registration for the current frame, the tables are kept if the cameras do not change */
+		void update_registration();
+
 	protected:
 		//accelerate access
 		cv::Mat m_color_image;
@@ -47,5 +68,11 @@ namespace _NS_UTILITY
 		cv::Mat m_depth2xyz;
 		cv::Mat m_depth2color;
 		cv::Mat m_depth_intrinsic, m_depth_extrinsic;
+
+		//registration tables and the rays of the depth camera, built by set_framedata() and kept while the cameras do not change.
+		//the rays may exist without the registration if there is no color image.
+		DepthColorRegistration m_registration;
+		bool m_has_registration = false;
+		bool m_has_depth_rays = false;
 	};
 }
\ No newline at end of file
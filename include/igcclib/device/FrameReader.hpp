@@ -1,6 +1,7 @@
 #pragma once
 
 #include <igcclib/device/FrameData.hpp>
+#include <igcclib/vision/DepthBackProjector.hpp>
 
 namespace _NS_UTILITY
 {
@@ -86,11 +87,54 @@ namespace _NS_UTILITY
 		return whether the conversion is successful. */
 		virtual bool get_depth_3d_point(fVECTOR_3* out_point, const iVECTOR_2& depth_xy) const = 0;
 
+		/**
+		* \brief get the 3d points of all depth pixels in depth camera space, in the unit of the depth image.
+		By default, the depth image is back projected through the rays of the depth camera, which are computed
+		in every call. Readers used for many frames should keep a DepthBackProjector built when the frame data is set.
+		*
+		* \param out_depth2xyz CV_32FC3 points, invalid depth pixels are (0,0,0)
+		* \param out_normals if not null, CV_32FC3 unit normals facing the camera, (0,0,0) if not available
+		* \return bool whether the depth image and the depth camera are available
+		*/
+		virtual bool get_depth_point_cloud(cv::Mat* out_depth2xyz, cv::Mat* out_normals = nullptr) const
+		{
+			CameraModel camera;
+			if (!get_depth_projection_camera(&camera))
+				return false;
+			if (!out_depth2xyz && !out_normals)
+				return true;
+
+			DepthBackProjector projector;
+			projector.init(camera);
+			cv::Mat dmap, xyz;
+			get_depth_image(&dmap);
+			projector.back_project(dmap, out_depth2xyz ? *out_depth2xyz : xyz, 1.0, out_normals);
+			return true;
+		}
+
 		/** \brief color image captured by color camera with specified format.
 		If not specified, use the format as the device does. */
 		virtual bool get_color_image(cv::Mat* output, ImageFormat fmt = ImageFormat::NONE) const = 0;
 
 		/** \brief get the color camera intrinsic, extrinsic and distortion info */
 		virtual CameraModel get_color_camera() const = 0;
+
+	protected:
+		/** \brief get the depth camera with the size of the depth image. Return false if there is no depth image
+		or the depth camera has no projection, so that the depth image cannot be back projected. */
+		bool get_depth_projection_camera(CameraModel* output) const
+		{
+			cv::Mat dmap;
+			if (!get_depth_image(&dmap) || dmap.empty())
+				return false;
+
+			CameraModel camera = get_depth_camera();
+			if (camera.is_orthographic() || camera.get_projection_matrix()(0, 0) == 0)
+				return false;
+			camera.set_image_size(dmap.cols, dmap.rows);
+			if (output)
+				*output = camera;
+			return true;
+		}
 	};
 }
\ No newline at end of file
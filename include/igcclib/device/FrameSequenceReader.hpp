@@ -0,0 +1,131 @@
+#pragma once
+#include <list>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <igcclib/device/igcclib_device_def.hpp>
+
+namespace _NS_UTILITY
+{
+	/*!
+	 * \class FrameSequenceReader
+	 *
+	 * \brief read a sequence of frames stored as files, like the IMAGE and NUMPY outputs of FrameRecorder,
+	 with the same interface as VideoReader. Frames are decoded by a pool of worker threads ahead of the
+	 reading direction, and kept in a cache with a memory budget which drops the least recently used frames,
+	 so stepping back and forth through the sequence mostly reads from the cache.
+	 The frames read from the cache are shared with it, you should not modify them before making a copy.
+	 The reader is meant to be used by one thread.
+	 */
+	class FrameSequenceReader
+	{
+	public:
+		/**
+		* \brief index the frames in a directory, sorted in natural order, and start the workers
+		*
+		* \param dirname the directory of the sequence
+		* \param filename if not empty, every sub directory of dirname is a frame which is read from this file,
+		like "color.png" or "depth.npy" written by FrameRecorder. Otherwise every image or .npy file in dirname is a frame.
+		* \param cache_bytes the memory budget of the decoded frames
+		* \param n_worker number of decoding threads, if 0, use the number of cores
+		* \param n_readahead number of frames decoded ahead of the last read frame
+		* \return bool whether any frame is found and the first frame can be read
+		*/
+		bool init_from_dir(const std::string& dirname, const std::string& filename = "",
+			size_t cache_bytes = 512 * 1024 * 1024, int n_worker = 0, int n_readahead = 8);
+
+		/** \brief stop the workers and clear the frames */
+		void close();
+
+		/** \brief get the number of frames */
+		size_t get_num_frames() const { return m_filenames.size(); }
+
+		/** \brief get framerate as fps, which is 0 unless set by set_frame_rate() */
+		double get_frame_rate() const { return m_fps; }
+
+		/** \brief set the frame rate, which is needed to read frames by time */
+		void set_frame_rate(double fps) { m_fps = fps; }
+
+		/** \brief prepare the reader for sequential reading */
+		void begin_sequential_read();
+
+		/** \brief in sequential reading, read the next frame. Return true if a frame is read successfully, otherwise return false. */
+		bool read_next_frame(cv::Mat* output);
+
+		/** \brief read a specific frame. */
+		bool read_frame_by_index(size_t n, cv::Mat* output);
+
+		/** \brief read frame by a timestamp in seconds, the frame rate must be set */
+		bool read_frame_by_time(double t_sec, cv::Mat* output);
+
+		/** \brief size of the first frame */
+		int get_frame_width() const { return m_width; }
+		int get_frame_height() const { return m_height; }
+
+		/** \brief get the time in ms of the last read frame, by the frame rate */
+		double get_current_time_ms() const;
+
+		/** \brief get the index of the frame next to the last read one, like VideoReader */
+		size_t get_current_frame_index() const { return m_frame_index; }
+
+		/** \brief the files of the frames */
+		const std::vector<std::string>& get_filenames() const { return m_filenames; }
+
+		/** \brief total bytes of the cached frames */
+		size_t get_cache_size() const;
+
+		/** \brief read a frame file, .npy files are read as numpy arrays, others by cv::imread() without any conversion */
+		static bool read_frame_file(const std::string& filename, cv::Mat& output);
+
+		FrameSequenceReader() {}
+		FrameSequenceReader(const FrameSequenceReader&) = delete;
+		FrameSequenceReader& operator=(const FrameSequenceReader&) = delete;
+		virtual ~FrameSequenceReader();
+
+	protected:
+		struct CachedFrame
+		{
+			cv::Mat image;		//empty if the file cannot be read
+			std::list<size_t>::iterator lru_pos;
+		};
+
+		void worker_loop();
+
+		//queue frame n first, then the frames after n in the reading direction, dropping older requests.
+		//must be called with the mutex locked.
+		void schedule(size_t n, bool is_forward);
+
+		//is frame n queued or being decoded, must be called with the mutex locked
+		bool is_pending(size_t n) const;
+
+		//must be called with the mutex locked
+		void add_to_cache(size_t n, const cv::Mat& image);
+
+	protected:
+		std::vector<std::string> m_filenames;
+		size_t m_frame_index = 0;	//the next frame to read
+		size_t m_last_read = 0;
+		double m_fps = 0;
+		int m_width = 0;
+		int m_height = 0;
+		size_t m_cache_budget = 0;
+		int m_n_readahead = 0;
+
+		//cache and work queue, guarded by the mutex
+		std::vector<std::shared_ptr<std::thread>> m_workers;
+		mutable std::mutex m_mutex;
+		std::condition_variable m_cv_worker;	//wakes the workers for new requests or stopping
+		std::condition_variable m_cv_reader;	//wakes the reader when a frame is decoded
+		std::unordered_map<size_t, CachedFrame> m_cache;
+		std::list<size_t> m_lru;		//frame indices, most recently used first
+		size_t m_cache_bytes = 0;
+		std::deque<size_t> m_queue;
+		std::unordered_set<size_t> m_decoding;
+		bool m_stop = false;
+	};
+}
@@ -61,6 +61,16 @@ public:
     DenseMatrix evalJacobian(DenseVector x) const override;
     DenseMatrix evalHessian(DenseVector x) const override;
 
+    /**
+     * Batch evaluation, each row of x is an evaluation point. The points are evaluated in parallel
+     * with preallocated basis workspace instead of sparse Kronecker products. Points outside of
+     * the domain evaluate to zero.
+     */
+    DenseVector evalBatch(const DenseMatrix &x) const;
+
+    // Returns the (numPoints x numVariables) matrix whose i-th row is the Jacobian at x.row(i)
+    DenseMatrix evalJacobianBatch(const DenseMatrix &x) const;
+
     // Evaluation of B-spline basis functions
     SparseVector evalBasis(DenseVector x) const;
     SparseMatrix evalBasisJacobian(DenseVector x) const;
@@ -148,6 +158,9 @@ private:
     // Helper functions
     bool pointInDomain(DenseVector x) const;
 
+    // Shared by evalBatch and evalJacobianBatch, either output can be null
+    void evalBatchImpl(const DenseMatrix &x, DenseVector *values, DenseMatrix *jacobians) const;
+
     void load(const std::string &fileName) override;
 
     friend class Serializer;
@@ -37,6 +37,7 @@ public:
 
     // Getters
     BSplineBasis1D getSingleBasis(int dim);
+    const BSplineBasis1D &getBasis1D(unsigned int dim) const { return bases.at(dim); }
     std::vector< std::vector<double> > getKnotVectors() const;
     std::vector<double> getKnotVector(int dim) const;
 
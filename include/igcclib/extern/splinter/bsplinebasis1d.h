@@ -26,6 +26,11 @@ public:
     SparseVector evalDerivative(double x, int r) const;
     SparseVector evalFirstDerivative(double x) const; // Depricated
 
+    // Evaluate the degree+1 nonzero basis functions, and optionally their first derivatives, at x
+    // into caller provided buffers without allocation. Returns the index of the first nonzero
+    // basis function, or -1 if x is outside the support.
+    int evalNonZero(double x, double *values, double *derivatives = nullptr) const;
+
     // Knot vector related
     SparseMatrix refineKnots();
     SparseMatrix refineKnotsLocally(double x);
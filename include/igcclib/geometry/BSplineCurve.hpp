@@ -1,7 +1,10 @@
 #pragma once
 
+#include <vector>
+#include <algorithm>
 #include <igcclib/igcclib_master.hpp>
 #include <igcclib/core/igcclib_eigen_def.hpp>
+#include <igcclib/math/sparse.hpp>
 #include <igcclib/extern/splinter/bspline.h>
 #include <igcclib/extern/splinter/bsplinebuilder.h>
 
@@ -19,13 +22,41 @@ namespace _NS_UTILITY {
 		If arc-length parameterization is used, the 2nd order derivative is curve normal.*/
 		Point_t evaluate_derivative(float_type t, int order = 1) const;
 
-		/** \brief evaluate the curve at points t */
+		/** \brief evaluate the curve at points t, in parallel over the parameters */
 		MATRIX_t<T> evaluate_point(const VECTOR_t<T>& ts) const;
 
-		/** \brief evaluate the first or second derivatives at parameters ts.
+		/** \brief evaluate the first or second derivatives at parameters ts, in parallel over the parameters.
 		If arc-length parameterization is used, the 2nd order derivative is curve normal.*/
 		MATRIX_t<T> evaluate_derivative(const VECTOR_t<T>& ts, int order = 1) const;
 
+		/// <summary>
+		/// build a table that maps arc length to curve parameter, required by the arc length functions.
+		/// The length of each segment is integrated by gauss-legendre quadrature of the curve speed.
+		/// The table is discarded when the curve changes.
+		/// </summary>
+		/// <param name="n_segment">number of uniform parameter segments in the table</param>
+		void build_arclength_table(int n_segment = 256);
+
+		bool has_arclength_table() const { return !m_arclength_s.empty(); }
+
+		/** \brief total length of the curve, requires build_arclength_table() */
+		double get_arclength() const {
+			assert_throw(has_arclength_table(), "arc length table is not built");
+			return m_arclength_s.back();
+		}
+
+		/** \brief find curve parameters of given arc lengths from the start of the curve,
+		requires build_arclength_table() */
+		VECTOR_t<T> get_parameter_by_arclength(const VECTOR_t<T>& lens) const;
+
+		/// <summary>
+		/// sample points uniformly spaced in arc length, requires build_arclength_table()
+		/// </summary>
+		/// <param name="n_point">number of points, including both end points</param>
+		/// <param name="out_ts">curve parameters of the sampled points</param>
+		/// <returns>the sampled points</returns>
+		MATRIX_t<T> resample_by_arclength(int n_point, VECTOR_t<T>* out_ts = nullptr) const;
+
 		/**
 		* \brief fit to a list of points
 		*
@@ -56,6 +87,18 @@ namespace _NS_UTILITY {
 		void init_by_fit(const MATRIX_t<T>& pts, int n_degree,
 			double w_smooth = 0.02, double end_point_multiplicity = 10.0);
 
+		/**
+		* \brief fit many curves whose points share the same parameters, in parallel.
+		The curves share the knot vector, and the fitting system is factorized only once.
+		See init_by_fit() for the parameters.
+		*
+		* \param output the fitted curves, one for each point list
+		* \param pts_list the points of each curve, all with the same number of points as ts
+		*/
+		static void init_by_fit_batch(std::vector<BSplineCurve>& output,
+			const std::vector<MATRIX_t<T>>& pts_list, const VECTOR_t<T>& ts, int n_degree,
+			double w_smooth = 0.02, double end_point_multiplicity = 10.0);
+
 		double get_t_min() const { return m_tmin; }
 		double get_t_max() const { return m_tmax; }
 		double is_empty() const {
@@ -102,17 +145,86 @@ namespace _NS_UTILITY {
 			}
 
 			ar(m_tmin, m_tmax);
+			update_evaluator();
 		}
 
 	private:
 		using Spline_t = SPLINTER::BSpline;
 
+		//degrees up to this are evaluated by the native evaluator
+		static constexpr int MAX_NATIVE_DEGREE = 7;
+
+		/** \brief extract the knots and coefficients for the native evaluator, and discard the arc length table */
+		void update_evaluator();
+
+		/** \brief is the native evaluator usable */
+		bool has_native_evaluator() const { return m_degree > 0; }
+
+		/// <summary>
+		/// evaluate the non-zero basis functions and their derivatives at x,
+		/// P is the degree known at compile time, or 0 if it is only known at runtime
+		/// </summary>
+		/// <param name="knots">the clamped knot vector</param>
+		/// <param name="degree">degree of the basis functions</param>
+		/// <param name="x">the parameter</param>
+		/// <param name="order">highest derivative order</param>
+		/// <param name="ders">ders[k][j] is the k-th derivative of the j-th non-zero basis function</param>
+		/// <returns>index of the first non-zero basis function, or -1 if x is outside of the curve</returns>
+		template<int P>
+		static int eval_basis(const std::vector<double>& knots, int degree,
+			double x, int order, double ders[3][MAX_NATIVE_DEGREE + 1]);
+
+		/** \brief the banded least squares system of fitting, shared by curves with the same parameters */
+		struct _FitSystem
+		{
+			std::vector<double> knots;
+			int degree = 0;
+			BandedCholesky_t<double> solver;
+
+			//for each sample, the first non-zero basis function, the values of the non-zero ones and the sample weight
+			std::vector<int> first_basis;
+			MATRIX_t<double> basis;
+			std::vector<double> weights;
+		};
+
+		/// <summary>
+		/// build and factorize the p-spline fitting system, the same as SPLINTER::BSpline::Builder
+		/// with moving average knots and PSPLINE smoothing, but exploiting the band structure.
+		/// </summary>
+		/// <returns>false if the native fitting does not apply, and SPLINTER should be used</returns>
+		static bool make_fit_system(_FitSystem& output, const VECTOR_t<T>& ts, int n_degree,
+			double w_smooth, double end_point_multiplicity);
+
+		/** \brief solve the fitting system for the points, and set the splines */
+		void init_by_fit_system(const _FitSystem& sys, const MATRIX_t<T>& pts, double tmin, double tmax);
+
+		/** \brief fit each dimension by SPLINTER::BSpline::Builder */
+		void init_by_fit_splinter(const MATRIX_t<T>& pts, const VECTOR_t<T>& ts, int n_degree,
+			double w_smooth, double end_point_multiplicity);
+
+		/** \brief evaluate the order-th derivative at many parameters with the native evaluator */
+		void evaluate_native(const VECTOR_t<T>& ts, int order, MATRIX_t<T>& output) const;
+
+		/** \brief evaluate the order-th derivative at one parameter with the native evaluator into NDIM values,
+		the basis is computed in a fixed-size buffer so nothing is allocated */
+		template<typename OUT_T>
+		void evaluate_native(double x, int order, OUT_T* output) const;
+
 		/** \brief spline for each dimension */
 		std::vector<Spline_t> m_splines;
 
 		/** \brief range of parameter t */
 		double m_tmin = 0;
 		double m_tmax = 0;
+
+		/** \brief native evaluator data, shared by all dimensions. m_degree < 0 if not available */
+		std::vector<double> m_knots;
+		int m_degree = -1;
+		MATRIX_t<double> m_coefs;	//n_basis x NDIM
+
+		/** \brief arc length table, m_arclength_s[i] is the length from the start to m_arclength_t[i] */
+		std::vector<double> m_arclength_t;
+		std::vector<double> m_arclength_s;
 	};
 
 	using fBSplineCurve_3 = BSplineCurve<3, float_type>;
@@ -141,6 +253,12 @@ namespace _NS_UTILITY {
 		assert_throw(order == 1 || order == 2, "order must be 1 or 2");
 
 		MATRIX_t<T> output(ts.size(), m_splines.size());
+		if (has_native_evaluator())
+		{
+			evaluate_native(ts, order, output);
+			return output;
+		}
+
 		std::vector<double> x(1);
 		for (Eigen::Index k = 0; k < ts.size(); k++) {
 			x[0] = ts(k);
@@ -158,8 +276,14 @@ namespace _NS_UTILITY {
 
 	template<int NDIM, typename T>
 	inline MATRIX_t<T> BSplineCurve<NDIM, T>::evaluate_point(const VECTOR_t<T>& ts) const {
-		std::vector<double> x(1);
 		MATRIX_t<T> output(ts.size(), m_splines.size());
+		if (has_native_evaluator())
+		{
+			evaluate_native(ts, 0, output);
+			return output;
+		}
+
+		std::vector<double> x(1);
 		for (Eigen::Index k = 0; k < ts.size(); k++)
 		{
 			x[0] = ts(k);
@@ -171,6 +295,250 @@ namespace _NS_UTILITY {
 		return output;
 	}
 
+	template<int NDIM, typename T>
+	inline void BSplineCurve<NDIM, T>::update_evaluator()
+	{
+		m_degree = -1;
+		m_knots.clear();
+		m_coefs.resize(0, 0);
+		m_arclength_t.clear();
+		m_arclength_s.clear();
+		if (m_splines.size() != NDIM)
+			return;
+
+		//all dimensions must share the same clamped knot vector and degree
+		auto knots = m_splines[0].getKnotVectors();
+		auto degrees = m_splines[0].getBasisDegrees();
+		if (knots.size() != 1 || degrees.size() != 1)
+			return;
+		int p = (int)degrees[0];
+		const auto& kv = knots[0];
+		if (p < 1 || p > MAX_NATIVE_DEGREE || kv.size() < (size_t)(2 * p + 2))
+			return;
+		for (int i = 1; i <= p; i++)
+			if (kv[i] != kv[0] || kv[kv.size() - 1 - i] != kv.back())
+				return;
+
+		int n_basis = (int)kv.size() - p - 1;
+		MATRIX_t<double> coefs(n_basis, NDIM);
+		for (int d = 0; d < NDIM; d++)
+		{
+			if (m_splines[d].getKnotVectors() != knots || m_splines[d].getBasisDegrees() != degrees)
+				return;
+			auto c = m_splines[d].getCoefficients();
+			if (c.size() != n_basis)
+				return;
+			coefs.col(d) = c;
+		}
+
+		m_knots = kv;
+		m_coefs = coefs;
+		m_degree = p;
+	}
+
+	template<int NDIM, typename T>
+	template<int P>
+	inline int BSplineCurve<NDIM, T>::eval_basis(const std::vector<double>& knots, int degree,
+		double x, int order, double ders[3][MAX_NATIVE_DEGREE + 1])
+	{
+		//basis functions and derivatives, see algorithm A2.3 in The NURBS Book
+		const int p = P > 0 ? P : degree;
+		const auto& U = knots;
+		if (x < U.front() || x > U.back())
+			return -1;
+
+		//the last knot is treated as the end of the last non-empty interval
+		int span = (int)(std::upper_bound(U.begin(), U.end(), x) - U.begin()) - 1;
+		span = std::min(span, (int)U.size() - p - 2);
+
+		double ndu[MAX_NATIVE_DEGREE + 1][MAX_NATIVE_DEGREE + 1];
+		double left[MAX_NATIVE_DEGREE + 1], right[MAX_NATIVE_DEGREE + 1];
+		ndu[0][0] = 1;
+		for (int j = 1; j <= p; j++)
+		{
+			left[j] = x - U[span + 1 - j];
+			right[j] = U[span + j] - x;
+			double saved = 0;
+			for (int r = 0; r < j; r++)
+			{
+				ndu[j][r] = right[r + 1] + left[j - r];
+				double temp = ndu[j][r] != 0 ? ndu[r][j - 1] / ndu[j][r] : 0;
+				ndu[r][j] = saved + right[r + 1] * temp;
+				saved = left[j - r] * temp;
+			}
+			ndu[j][j] = saved;
+		}
+		for (int j = 0; j <= p; j++)
+			ders[0][j] = ndu[j][p];
+
+		order = std::min(order, p);
+		if (order > 0)
+		{
+			double a[2][MAX_NATIVE_DEGREE + 1];
+			for (int r = 0; r <= p; r++)
+			{
+				int s1 = 0, s2 = 1;
+				a[0][0] = 1;
+				for (int k = 1; k <= order; k++)
+				{
+					double d = 0;
+					int rk = r - k;
+					int pk = p - k;
+					if (r >= k)
+					{
+						a[s2][0] = ndu[pk + 1][rk] != 0 ? a[s1][0] / ndu[pk + 1][rk] : 0;
+						d = a[s2][0] * ndu[rk][pk];
+					}
+					int j1 = rk >= -1 ? 1 : -rk;
+					int j2 = (r - 1 <= pk) ? k - 1 : p - r;
+					for (int j = j1; j <= j2; j++)
+					{
+						a[s2][j] = ndu[pk + 1][rk + j] != 0 ? (a[s1][j] - a[s1][j - 1]) / ndu[pk + 1][rk + j] : 0;
+						d += a[s2][j] * ndu[rk + j][pk];
+					}
+					if (r <= pk)
+					{
+						a[s2][k] = ndu[pk + 1][r] != 0 ? -a[s1][k - 1] / ndu[pk + 1][r] : 0;
+						d += a[s2][k] * ndu[r][pk];
+					}
+					ders[k][r] = d;
+					std::swap(s1, s2);
+				}
+			}
+
+			double factor = p;
+			for (int k = 1; k <= order; k++)
+			{
+				for (int j = 0; j <= p; j++)
+					ders[k][j] *= factor;
+				factor *= (p - k);
+			}
+		}
+		return span - p;
+	}
+
+	template<int NDIM, typename T>
+	inline void BSplineCurve<NDIM, T>::evaluate_native(const VECTOR_t<T>& ts, int order, MATRIX_t<T>& output) const
+	{
+		int n = (int)ts.size();
+		output.resize(n, NDIM);
+
+#pragma omp parallel for if(n > 256)
+		for (int k = 0; k < n; k++)
+		{
+			T y[NDIM];
+			evaluate_native(ts(k), order, y);
+			for (int d = 0; d < NDIM; d++)
+				output(k, d) = y[d];
+		}
+	}
+
+	template<int NDIM, typename T>
+	template<typename OUT_T>
+	inline void BSplineCurve<NDIM, T>::evaluate_native(double x, int order, OUT_T* output) const
+	{
+		double ders[3][MAX_NATIVE_DEGREE + 1];
+		int p = m_degree;
+		int first = -1;
+
+		//the common degrees are dispatched to fixed-degree instances so that the loops unroll
+		switch (p) {
+		case 1: first = eval_basis<1>(m_knots, p, x, order, ders); break;
+		case 2: first = eval_basis<2>(m_knots, p, x, order, ders); break;
+		case 3: first = eval_basis<3>(m_knots, p, x, order, ders); break;
+		case 4: first = eval_basis<4>(m_knots, p, x, order, ders); break;
+		case 5: first = eval_basis<5>(m_knots, p, x, order, ders); break;
+		default: first = eval_basis<0>(m_knots, p, x, order, ders); break;
+		}
+
+		//returns zero outside the domain
+		if (first < 0 || order > p)
+		{
+			for (int d = 0; d < NDIM; d++)
+				output[d] = 0;
+			return;
+		}
+
+		for (int d = 0; d < NDIM; d++)
+		{
+			double y = 0;
+			for (int j = 0; j <= p; j++)
+				y += ders[order][j] * m_coefs(first + j, d);
+			output[d] = (OUT_T)y;
+		}
+	}
+
+	template<int NDIM, typename T>
+	inline void BSplineCurve<NDIM, T>::build_arclength_table(int n_segment)
+	{
+		assert_throw(!is_empty(), "the curve is empty");
+		assert_throw(n_segment > 0, "number of segments must be positive");
+
+		//5-point gauss-legendre quadrature on [-1,1]
+		const double gx[5] = { -0.9061798459386640, -0.5384693101056831, 0.0, 0.5384693101056831, 0.9061798459386640 };
+		const double gw[5] = { 0.2369268850561891, 0.4786286704993665, 0.5688888888888889, 0.4786286704993665, 0.2369268850561891 };
+
+		double h = (m_tmax - m_tmin) / n_segment;
+		VECTOR_t<T> ts(n_segment * 5);
+		for (int i = 0; i < n_segment; i++)
+		{
+			double mid = m_tmin + (i + 0.5) * h;
+			for (int k = 0; k < 5; k++)
+				ts(i * 5 + k) = (T)(mid + gx[k] * h / 2);
+		}
+		MATRIX_t<T> ders = evaluate_derivative(ts, 1);
+
+		std::vector<double> tlist(n_segment + 1), slist(n_segment + 1);
+		tlist[0] = m_tmin;
+		slist[0] = 0;
+		for (int i = 0; i < n_segment; i++)
+		{
+			double len = 0;
+			for (int k = 0; k < 5; k++)
+				len += gw[k] * ders.row(i * 5 + k).norm();
+			tlist[i + 1] = m_tmin + (i + 1) * h;
+			slist[i + 1] = slist[i] + len * h / 2;
+		}
+		tlist.back() = m_tmax;
+
+		m_arclength_t = std::move(tlist);
+		m_arclength_s = std::move(slist);
+	}
+
+	template<int NDIM, typename T>
+	inline VECTOR_t<T> BSplineCurve<NDIM, T>::get_parameter_by_arclength(const VECTOR_t<T>& lens) const
+	{
+		assert_throw(has_arclength_table(), "arc length table is not built");
+		const auto& S = m_arclength_s;
+		const auto& U = m_arclength_t;
+
+		VECTOR_t<T> output(lens.size());
+		for (Eigen::Index i = 0; i < lens.size(); i++)
+		{
+			double s = std::min(std::max((double)lens(i), S.front()), S.back());
+			auto idx = (size_t)(std::upper_bound(S.begin(), S.end(), s) - S.begin());
+			idx = std::min(std::max(idx, (size_t)1), S.size() - 1);
+
+			//linear interpolation within the segment
+			double ds = S[idx] - S[idx - 1];
+			double a = ds > 0 ? (s - S[idx - 1]) / ds : 0;
+			output(i) = (T)(U[idx - 1] + a * (U[idx] - U[idx - 1]));
+		}
+		return output;
+	}
+
+	template<int NDIM, typename T>
+	inline MATRIX_t<T> BSplineCurve<NDIM, T>::resample_by_arclength(int n_point, VECTOR_t<T>* out_ts) const
+	{
+		assert_throw(n_point >= 2, "at least 2 points are needed");
+		auto lens = VECTOR_t<T>::LinSpaced(n_point, 0, (T)get_arclength());
+		auto ts = get_parameter_by_arclength(lens);
+		auto pts = evaluate_point(ts);
+		if (out_ts)
+			*out_ts = ts;
+		return pts;
+	}
+
 	template<int NDIM, typename T>
 	inline void BSplineCurve<NDIM, T>::init_by_fit(
 		const MATRIX_t<T>& pts, int n_degree, double w_smooth, double end_point_multiplicity) 
@@ -194,6 +562,12 @@ namespace _NS_UTILITY {
 	{
 		assert_throw(order == 1 || order == 2, "order must be 1 or 2");
 		Point_t output;
+		if (has_native_evaluator())
+		{
+			evaluate_native((double)(T)t, order, output.data());
+			return output;
+		}
+
 		std::vector<double> x = { t };
 		for (int i = 0; i < NDIM; i++) {
 			double y = 0;
@@ -209,8 +583,14 @@ namespace _NS_UTILITY {
 	template<int NDIM, typename T /*= float_type*/>
 	inline typename BSplineCurve<NDIM,T>::Point_t BSplineCurve<NDIM, T>::evaluate_point(float_type t) const
 	{
-		std::vector<double> x = { t };
 		Point_t output;
+		if (has_native_evaluator())
+		{
+			evaluate_native((double)(T)t, 0, output.data());
+			return output;
+		}
+
+		std::vector<double> x = { t };
 		for (int i = 0; i < NDIM; i++) {
 			auto y = m_splines[i].eval(x);
 			output[i] = y;
@@ -224,6 +604,166 @@ namespace _NS_UTILITY {
 		double w_smooth, double end_point_multiplicity)
 	{
 		assert_throw(pts.rows() == ts.size(), "number of parameter is different from number of sites");
+
+		_FitSystem sys;
+		if (make_fit_system(sys, ts, n_degree, w_smooth, end_point_multiplicity))
+			init_by_fit_system(sys, pts, ts.minCoeff(), ts.maxCoeff());
+		else
+			init_by_fit_splinter(pts, ts, n_degree, w_smooth, end_point_multiplicity);
+	}
+
+	template<int NDIM, typename T>
+	inline void BSplineCurve<NDIM, T>::init_by_fit_batch(std::vector<BSplineCurve>& output,
+		const std::vector<MATRIX_t<T>>& pts_list, const VECTOR_t<T>& ts, int n_degree,
+		double w_smooth, double end_point_multiplicity)
+	{
+		for (const auto& pts : pts_list)
+			assert_throw(pts.rows() == ts.size(), "number of parameter is different from number of sites");
+
+		int n_curve = (int)pts_list.size();
+		output.clear();
+		output.resize(n_curve);
+		if (n_curve == 0)
+			return;
+
+		_FitSystem sys;
+		bool use_native = make_fit_system(sys, ts, n_degree, w_smooth, end_point_multiplicity);
+		double tmin = ts.minCoeff();
+		double tmax = ts.maxCoeff();
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int i = 0; i < n_curve; i++)
+		{
+			if (use_native)
+				output[i].init_by_fit_system(sys, pts_list[i], tmin, tmax);
+			else
+				output[i].init_by_fit_splinter(pts_list[i], ts, n_degree, w_smooth, end_point_multiplicity);
+		}
+	}
+
+	template<int NDIM, typename T>
+	inline bool BSplineCurve<NDIM, T>::make_fit_system(_FitSystem& output, const VECTOR_t<T>& ts, int n_degree,
+		double w_smooth, double end_point_multiplicity)
+	{
+		int p = n_degree;
+		if (p < 1 || p > MAX_NATIVE_DEGREE || ts.size() == 0)
+			return false;
+
+		int n_endpt = 1;
+		if (end_point_multiplicity >= 1.0)
+			n_endpt = (int)std::round(end_point_multiplicity);
+		else
+			n_endpt = (int)(ts.size() * end_point_multiplicity);
+		if (n_endpt < 1)
+			n_endpt = 1;
+
+		//knots by moving average of the unique parameters, the same as SPLINTER
+		std::vector<double> unique(ts.data(), ts.data() + ts.size());
+		std::sort(unique.begin(), unique.end());
+		unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+		int n_basis = (int)unique.size();
+		if (n_basis < p + 1 || n_basis < 3)
+			return false;
+
+		int window = p + 2;
+		std::vector<double> knots;
+		knots.reserve(n_basis + p + 1);
+		knots.insert(knots.end(), p + 1, unique.front());
+		for (int i = 0; i < n_basis - p - 1; i++)
+		{
+			double ma = 0;
+			for (int j = 0; j < window; j++)
+				ma += unique[i + j];
+			knots.push_back(ma / window);
+		}
+		knots.insert(knots.end(), p + 1, unique.back());
+
+		//the duplicated end points of SPLINTER become sample weights
+		Eigen::Index idx_start, idx_end;
+		ts.maxCoeff(&idx_end);
+		ts.minCoeff(&idx_start);
+
+		int n_sample = (int)ts.size();
+		output.first_basis.resize(n_sample);
+		output.basis.resize(n_sample, p + 1);
+		output.weights.assign(n_sample, 1.0);
+		output.weights[idx_start] += n_endpt - 1;
+		output.weights[idx_end] += n_endpt - 1;
+
+#pragma omp parallel for if(n_sample > 1024)
+		for (int i = 0; i < n_sample; i++)
+		{
+			double ders[3][MAX_NATIVE_DEGREE + 1];
+			output.first_basis[i] = eval_basis<0>(knots, p, ts(i), 0, ders);
+			for (int j = 0; j <= p; j++)
+				output.basis(i, j) = ders[0][j];
+		}
+
+		//A = B'*W*B + alpha*D'*D, D is the second order difference, so the half bandwidth is max(p,2)
+		int bw = std::max(p, 2);
+		MATRIX_t<double> band = MATRIX_t<double>::Zero(n_basis, bw + 1);
+		for (int i = 0; i < n_sample; i++)
+		{
+			int f = output.first_basis[i];
+			double w = output.weights[i];
+			for (int a = 0; a <= p; a++)
+				for (int b = 0; b <= a; b++)
+					band(f + a, a - b) += w * output.basis(i, a) * output.basis(i, b);
+		}
+
+		const double dcoef[3] = { 1, -2, 1 };
+		for (int l = 0; l < n_basis - 2; l++)
+			for (int a = 0; a < 3; a++)
+				for (int b = 0; b <= a; b++)
+					band(l + a, a - b) += w_smooth * dcoef[a] * dcoef[b];
+
+		if (!output.solver.factorize(band))
+			return false;
+
+		output.knots = std::move(knots);
+		output.degree = p;
+		return true;
+	}
+
+	template<int NDIM, typename T>
+	inline void BSplineCurve<NDIM, T>::init_by_fit_system(const _FitSystem& sys, const MATRIX_t<T>& pts,
+		double tmin, double tmax)
+	{
+		//b = B'*W*y for all dimensions
+		int p = sys.degree;
+		MATRIX_t<double> rhs = MATRIX_t<double>::Zero(sys.solver.get_size(), NDIM);
+		for (Eigen::Index i = 0; i < pts.rows(); i++)
+		{
+			int f = sys.first_basis[i];
+			for (int a = 0; a <= p; a++)
+			{
+				double wb = sys.weights[i] * sys.basis(i, a);
+				for (int d = 0; d < NDIM; d++)
+					rhs(f + a, d) += wb * pts(i, d);
+			}
+		}
+
+		MATRIX_t<double> coefs;
+		sys.solver.solve(rhs, coefs);
+
+		m_tmin = tmin;
+		m_tmax = tmax;
+		m_splines.clear();
+		std::vector<std::vector<double>> knots = { sys.knots };
+		std::vector<unsigned int> degrees = { (unsigned int)p };
+		for (int d = 0; d < NDIM; d++)
+		{
+			SPLINTER::DenseVector c = coefs.col(d);
+			m_splines.emplace_back(c, knots, degrees);
+		}
+		update_evaluator();
+	}
+
+	template<int NDIM, typename T>
+	inline void BSplineCurve<NDIM, T>::init_by_fit_splinter(
+		const MATRIX_t<T>& pts, const VECTOR_t<T>& ts, int n_degree,
+		double w_smooth, double end_point_multiplicity)
+	{
 		m_tmin = ts.minCoeff();
 		m_tmax = ts.maxCoeff();
 
@@ -265,6 +805,7 @@ namespace _NS_UTILITY {
 				.build();
 			m_splines.push_back(spline);
 		}
+		update_evaluator();
 	}
 
 }
\ No newline at end of file
@@ -0,0 +1,229 @@
+#pragma once
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <igcclib/core/igcclib_eigen_def.hpp>
+
+namespace _NS_UTILITY
+{
+	/// <summary>
+	/// Static 2d kdtree over single precision points, built in bulk and stored in flat arrays.
+	/// The points are reordered so that each leaf is a contiguous range, and the nodes are kept
+	/// in a single array. Queries are read-only and can be issued from multiple threads, the batch
+	/// queries process many query points in parallel and return variable-length results in
+	/// compressed sparse row (CSR) form: the results of the i-th query are
+	/// out_index[out_offsets[i]] to out_index[out_offsets[i+1]-1].
+	/// </summary>
+	class FlatKDTree_2
+	{
+	public:
+		struct Node
+		{
+			float minc[2];
+			float maxc[2];
+			int begin;	//range of points in this node
+			int end;
+			int left;	//child nodes, -1 for leaf
+			int right;
+		};
+
+	public:
+		/// <summary>
+		/// build the tree
+		/// </summary>
+		/// <param name="xy">the points, as interleaved x,y coordinates</param>
+		/// <param name="n_point">number of points</param>
+		/// <param name="leaf_size">maximum number of points in a leaf</param>
+		void init_with_points(const float* xy, size_t n_point, int leaf_size = 16);
+
+		/** \brief build the tree from nx2 points */
+		template<typename T>
+		void init_with_points(const MATRIX_t<T>& pts, int leaf_size = 16);
+
+		size_t get_num_points() const { return m_index.size(); }
+		bool is_empty() const { return m_index.empty(); }
+
+		// ================ single query ================
+		/// <summary>
+		/// find k nearest neighbors
+		/// </summary>
+		/// <param name="out_index">k-size buffer, indices of the found points sorted by distance</param>
+		/// <param name="out_distance">k-size buffer, distances of the found points</param>
+		/// <returns>number of found points, which is less than k if there are not enough points</returns>
+		int query_knn(float x, float y, int k, int_type* out_index, float* out_distance) const;
+
+		/** \brief append the indices of points whose distance to (x,y) is no more than r */
+		void query_radius(float x, float y, float r, std::vector<int_type>& out_index,
+			std::vector<float>* out_distance = nullptr) const;
+
+		/** \brief append the indices of points inside the box, boundary inclusive */
+		void query_aabb(float xmin, float ymin, float xmax, float ymax, std::vector<int_type>& out_index) const;
+
+		// ================ batch query ================
+		/// <summary>
+		/// k nearest neighbors of many points, in parallel
+		/// </summary>
+		/// <param name="qpts">nx2 query points</param>
+		/// <param name="k">number of neighbors</param>
+		/// <param name="out_index">nxk indices, -1 if there are less than k points</param>
+		/// <param name="out_distance">nxk distances, infinity if there are less than k points</param>
+		template<typename T>
+		void query_knn_batch(const MATRIX_t<T>& qpts, int k, iMATRIX* out_index, MATRIX_t<T>* out_distance = nullptr) const;
+
+		/// <summary>
+		/// points within a radius of many query points, in parallel
+		/// </summary>
+		/// <param name="qpts">nx2 query points</param>
+		/// <param name="r">the radius</param>
+		/// <param name="out_offsets">(n+1) CSR offsets</param>
+		/// <param name="out_index">CSR indices of the found points</param>
+		/// <param name="out_distance">CSR distances of the found points</param>
+		template<typename T>
+		void query_radius_batch(const MATRIX_t<T>& qpts, double r, std::vector<size_t>* out_offsets,
+			std::vector<int_type>* out_index, std::vector<float>* out_distance = nullptr) const;
+
+		/// <summary>
+		/// points inside many boxes, in parallel
+		/// </summary>
+		/// <param name="minc">nx2 min corners of the boxes</param>
+		/// <param name="maxc">nx2 max corners of the boxes</param>
+		/// <param name="out_offsets">(n+1) CSR offsets</param>
+		/// <param name="out_index">CSR indices of the found points</param>
+		template<typename T>
+		void query_aabb_batch(const MATRIX_t<T>& minc, const MATRIX_t<T>& maxc,
+			std::vector<size_t>* out_offsets, std::vector<int_type>* out_index) const;
+
+	protected:
+		/// <summary>
+		/// run variable-length queries in blocks and gather the results into CSR form
+		/// </summary>
+		/// <param name="n_query">number of queries</param>
+		/// <param name="func">func(i, index_buffer, distance_buffer) appends the results of the i-th query</param>
+		template<typename FUNC_T>
+		static void run_batch_csr(int n_query, FUNC_T func, bool with_distance, std::vector<size_t>* out_offsets,
+			std::vector<int_type>* out_index, std::vector<float>* out_distance);
+
+	protected:
+		std::vector<Node> m_nodes;
+
+		//reordered points as interleaved x,y, and their original indices
+		std::vector<float> m_xy;
+		std::vector<int_type> m_index;
+	};
+}
+
+namespace _NS_UTILITY
+{
+	template<typename T>
+	void FlatKDTree_2::init_with_points(const MATRIX_t<T>& pts, int leaf_size)
+	{
+		assert_throw(pts.rows() == 0 || pts.cols() == 2, "points must be nx2");
+		std::vector<float> xy(pts.rows() * 2);
+		for (Eigen::Index i = 0; i < pts.rows(); i++)
+		{
+			xy[i * 2] = (float)pts(i, 0);
+			xy[i * 2 + 1] = (float)pts(i, 1);
+		}
+		init_with_points(xy.data(), pts.rows(), leaf_size);
+	}
+
+	template<typename T>
+	void FlatKDTree_2::query_knn_batch(const MATRIX_t<T>& qpts, int k, iMATRIX* out_index, MATRIX_t<T>* out_distance) const
+	{
+		int n_query = (int)qpts.rows();
+		iMATRIX idxmat(n_query, k);
+		MATRIX_t<T> distmat(n_query, k);
+		idxmat.setConstant(-1);
+		distmat.setConstant(std::numeric_limits<T>::infinity());
+
+#pragma omp parallel
+		{
+			std::vector<int_type> idx(k);
+			std::vector<float> dist(k);
+#pragma omp for
+			for (int i = 0; i < n_query; i++)
+			{
+				int n = query_knn((float)qpts(i, 0), (float)qpts(i, 1), k, idx.data(), dist.data());
+				for (int j = 0; j < n; j++)
+				{
+					idxmat(i, j) = idx[j];
+					distmat(i, j) = dist[j];
+				}
+			}
+		}
+
+		if (out_index)
+			*out_index = std::move(idxmat);
+		if (out_distance)
+			*out_distance = std::move(distmat);
+	}
+
+	template<typename T>
+	void FlatKDTree_2::query_radius_batch(const MATRIX_t<T>& qpts, double r, std::vector<size_t>* out_offsets,
+		std::vector<int_type>* out_index, std::vector<float>* out_distance) const
+	{
+		auto func = [&](int i, std::vector<int_type>& idx, std::vector<float>* dist) {
+			query_radius((float)qpts(i, 0), (float)qpts(i, 1), (float)r, idx, dist);
+		};
+		run_batch_csr((int)qpts.rows(), func, out_distance != nullptr, out_offsets, out_index, out_distance);
+	}
+
+	template<typename T>
+	void FlatKDTree_2::query_aabb_batch(const MATRIX_t<T>& minc, const MATRIX_t<T>& maxc,
+		std::vector<size_t>* out_offsets, std::vector<int_type>* out_index) const
+	{
+		assert_throw(minc.rows() == maxc.rows(), "min and max corners must have the same number of rows");
+		auto func = [&](int i, std::vector<int_type>& idx, std::vector<float>*) {
+			query_aabb((float)minc(i, 0), (float)minc(i, 1), (float)maxc(i, 0), (float)maxc(i, 1), idx);
+		};
+		run_batch_csr((int)minc.rows(), func, false, out_offsets, out_index, nullptr);
+	}
+
+	template<typename FUNC_T>
+	void FlatKDTree_2::run_batch_csr(int n_query, FUNC_T func, bool with_distance, std::vector<size_t>* out_offsets,
+		std::vector<int_type>* out_index, std::vector<float>* out_distance)
+	{
+		//queries are split into blocks, each block collects its results into one buffer
+		//so that no per-query allocation is needed
+		const int block_size = 256;
+		int n_block = (n_query + block_size - 1) / block_size;
+		std::vector<std::vector<int_type>> block_index(n_block);
+		std::vector<std::vector<float>> block_dist(n_block);
+		std::vector<size_t> counts(n_query + 1, 0);
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int b = 0; b < n_block; b++)
+		{
+			auto& idx = block_index[b];
+			auto* dist = with_distance ? &block_dist[b] : nullptr;
+			int i_end = std::min(n_query, (b + 1) * block_size);
+			for (int i = b * block_size; i < i_end; i++)
+			{
+				auto n_prev = idx.size();
+				func(i, idx, dist);
+				counts[i + 1] = idx.size() - n_prev;
+			}
+		}
+
+		for (int i = 0; i < n_query; i++)
+			counts[i + 1] += counts[i];
+
+		std::vector<int_type> index(counts.back());
+		std::vector<float> distance(with_distance ? counts.back() : 0);
+#pragma omp parallel for
+		for (int b = 0; b < n_block; b++)
+		{
+			auto offset = counts[b * block_size];
+			std::copy(block_index[b].begin(), block_index[b].end(), index.begin() + offset);
+			if (with_distance)
+				std::copy(block_dist[b].begin(), block_dist[b].end(), distance.begin() + offset);
+		}
+
+		if (out_offsets)
+			*out_offsets = std::move(counts);
+		if (out_index)
+			*out_index = std::move(index);
+		if (out_distance)
+			*out_distance = std::move(distance);
+	}
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <igcclib/core/igcclib_eigen_def.hpp>
+#include <igcclib/core/KDTreeSearcher.hpp>
+#include <igcclib/geometry/TriangularMesh.hpp>
+
+namespace _NS_UTILITY
+{
+	class MeshSearcher;
+
+	/// <summary>
+	/// Iterative closest point registration of a source point set against a target,
+	/// where the target is either a point cloud (searched with kdtree) or a triangular mesh
+	/// (searched with MeshSearcher). All transformation matrices are 4x4 right-multiply matrices,
+	/// that is, transformed_points = [pts,1].dot(transmat).
+	/// </summary>
+	class ICPRegistration
+	{
+	public:
+		enum class ErrorMetric
+		{
+			POINT_TO_POINT,
+			POINT_TO_PLANE
+		};
+
+		//weighting function applied to the correspondence residuals
+		enum class RobustKernel
+		{
+			NONE,
+			HUBER,
+			TUKEY,
+			CAUCHY
+		};
+
+		struct Options
+		{
+			ErrorMetric metric = ErrorMetric::POINT_TO_POINT;
+
+			//maximum number of iterations for each resolution level
+			int max_iterations = 50;
+
+			//correspondences farther than this are rejected, <=0 to disable
+			float_type max_correspondence_distance = -1;
+
+			//correspondences whose normals differ by more than this angle (in degree) are rejected,
+			//only applicable when both source and target normals are available. <=0 to disable
+			float_type max_normal_angle_deg = -1;
+
+			//keep only this portion of the correspondences with the smallest residuals (trimmed ICP)
+			float_type trim_ratio = 1.0;
+
+			RobustKernel robust_kernel = RobustKernel::NONE;
+
+			//scale of the residuals used by the robust kernel. If <=0, it is estimated in each
+			//iteration from the median absolute residual
+			float_type robust_scale = -1;
+
+			//number of source points used in each resolution level, from coarse to fine.
+			//A value of 0 (or more than the number of source points) uses all points.
+			//If empty, a single level with all source points is used.
+			std::vector<size_t> level_num_points;
+
+			//early termination, the level stops when the incremental transformation
+			//is smaller than both thresholds, or the rmse change is less than rmse_tolerance
+			float_type rotation_tolerance_deg = 1e-4;
+			float_type translation_tolerance = 1e-6;
+			float_type rmse_tolerance = 1e-8;
+		};
+
+		/** \brief information about a single iteration, time is in seconds */
+		struct IterationInfo
+		{
+			int level = 0;
+			int iteration = 0;
+			size_t num_correspondences = 0;
+			size_t num_inliers = 0;
+			float_type rmse = 0;
+			double time_correspondence = 0;
+			double time_solve = 0;
+			double time_total = 0;
+		};
+
+		struct Result
+		{
+			//the transformation that maps source points to the target
+			fMATRIX_4 transmat = fMATRIX_4::Identity();
+
+			//whether the finest level terminated before running out of iterations
+			bool converged = false;
+
+			//rmse of the inlier correspondences in the last iteration
+			float_type rmse = 0;
+			std::vector<IterationInfo> iterations;
+		};
+
+	public:
+		/// <summary>
+		/// use a point cloud as the registration target
+		/// </summary>
+		/// <param name="pts">nx3 target points</param>
+		/// <param name="normals">nx3 target normals, required by point-to-plane metric. If not provided,
+		/// they are estimated from the neighborhood of each point.</param>
+		void set_target_points(const fMATRIX& pts, const fMATRIX* normals = nullptr);
+
+		/// <summary>
+		/// use a triangular mesh as the registration target, the mesh is copied in global coordinate
+		/// </summary>
+		/// <param name="mesh">the target mesh</param>
+		void set_target_mesh(const TriangularMesh& mesh);
+
+		/** \brief the number of neighbors used to estimate target normals, set it before set_target_points() */
+		void set_normal_estimation_neighbors(int k) { m_normal_estimation_k = k; }
+
+		void set_options(const Options& opt) { m_options = opt; }
+		const Options& get_options() const { return m_options; }
+
+		/// <summary>
+		/// register the source points to the target
+		/// </summary>
+		/// <param name="source_pts">nx3 source points</param>
+		/// <param name="output">the registration result</param>
+		/// <param name="init_transmat">initial transformation of the source points</param>
+		/// <param name="source_normals">nx3 source normals, used for normal compatibility rejection</param>
+		void register_points(const fMATRIX& source_pts, Result* output,
+			const fMATRIX_4* init_transmat = nullptr,
+			const fMATRIX* source_normals = nullptr) const;
+
+		/// <summary>
+		/// for each query point, find the closest point on the target in parallel
+		/// </summary>
+		/// <param name="pts">nx3 query points</param>
+		/// <param name="out_closest_pts">nx3 closest points on the target</param>
+		/// <param name="out_normals">nx3 target normals at the closest points,
+		/// only available if the target has normals</param>
+		/// <param name="out_valid">whether the i-th query has found a closest point</param>
+		void find_correspondence(const fMATRIX& pts, fMATRIX* out_closest_pts,
+			fMATRIX* out_normals = nullptr, std::vector<uint8_t>* out_valid = nullptr) const;
+
+		bool has_target() const { return m_kdtree != nullptr || m_mesh_searcher != nullptr; }
+
+	protected:
+		void estimate_target_normals();
+
+	protected:
+		Options m_options;
+
+		//point cloud target
+		std::shared_ptr<fKDTREE_STATIC_n> m_kdtree;
+		fMATRIX m_target_points;
+		int m_normal_estimation_k = 10;
+
+		//mesh target
+		std::shared_ptr<MeshSearcher> m_mesh_searcher;
+		std::shared_ptr<TriangularMesh> m_target_mesh;
+
+		//for point target, one normal per point, for mesh target, one normal per face
+		fMATRIX m_target_normals;
+	};
+}
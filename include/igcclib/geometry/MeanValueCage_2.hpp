@@ -0,0 +1,120 @@
+#pragma once
+#include <vector>
+#include <igcclib/core/igcclib_eigen_def.hpp>
+#include <igcclib/geometry/igcclib_geometry.hpp>
+
+namespace _NS_UTILITY
+{
+	/// <summary>
+	/// 2d cage deformation by mean value coordinates. The coordinates of a fixed set of points
+	/// (e.g. pixel centers or mesh vertices) are computed once against the rest cage, then
+	/// every deformation of the cage is a single matrix product.
+	/// </summary>
+	class MeanValueCage_2
+	{
+	public:
+		//a sparse row is kept in full if its kept weights sum to less than this
+		static constexpr float_type MIN_KEPT_WEIGHT_SUM = 0.5;
+
+		/// <summary>
+		/// compute the coordinates of the points with respect to the rest cage
+		/// </summary>
+		/// <param name="cage">mx2 vertices of the rest cage polygon</param>
+		/// <param name="pts">nx2 points to be deformed</param>
+		/// <param name="sparse_threshold">if positive, weights whose magnitude is below it are dropped and
+		/// the weights are stored in a sparse matrix, each row is renormalized to sum to one. If the kept weights of a row
+		/// sum to less than MIN_KEPT_WEIGHT_SUM, the row is kept in full instead.</param>
+		void init(const fMATRIX& cage, const fMATRIX& pts, float_type sparse_threshold = 0);
+
+		/// <summary>
+		/// deform the points by a new cage
+		/// </summary>
+		/// <param name="deformed_cage">mx2 vertices of the deformed cage, in the same order as the rest cage</param>
+		/// <param name="output">nx2 deformed points</param>
+		void apply(const fMATRIX& deformed_cage, fMATRIX& output) const;
+
+		fMATRIX apply(const fMATRIX& deformed_cage) const {
+			fMATRIX output;
+			apply(deformed_cage, output);
+			return output;
+		}
+
+		bool is_sparse() const { return m_is_sparse; }
+		size_t get_num_points() const { return m_num_points; }
+		size_t get_num_cage_vertices() const { return m_num_cage_vertices; }
+
+		/** \brief the nxm weights, empty if the weights are sparse */
+		const fMATRIX& get_weights_dense() const { return m_weights_dense; }
+
+		/** \brief the nxm weights, empty if the weights are dense */
+		const SP_MATRIX_t<float_type>& get_weights_sparse() const { return m_weights_sparse; }
+
+	protected:
+		fMATRIX m_weights_dense;
+		SP_MATRIX_t<float_type> m_weights_sparse;
+		bool m_is_sparse = false;
+		size_t m_num_points = 0;
+		size_t m_num_cage_vertices = 0;
+	};
+}
+
+namespace _NS_UTILITY
+{
+	inline void MeanValueCage_2::init(const fMATRIX& cage, const fMATRIX& pts, float_type sparse_threshold)
+	{
+		assert_throw(cage.cols() == 2 && pts.cols() == 2, "cage and points must be 2d");
+		m_num_points = pts.rows();
+		m_num_cage_vertices = cage.rows();
+
+		fMATRIX weights;
+		compute_mean_value_coordinate_2(cage, pts, weights);
+
+		m_is_sparse = sparse_threshold > 0;
+		if (!m_is_sparse)
+		{
+			m_weights_dense = std::move(weights);
+			m_weights_sparse.resize(0, 0);
+			return;
+		}
+
+		//keep the large weights of each row, rows are filled in parallel then assembled
+		int n_pts = (int)weights.rows();
+		std::vector<std::vector<TRIP_t<float_type>>> row_trips(n_pts);
+#pragma omp parallel for
+		for (int i = 0; i < n_pts; i++)
+		{
+			auto w = weights.row(i);
+			float_type sum = 0;
+			for (Eigen::Index k = 0; k < w.size(); k++)
+				if (std::abs(w(k)) >= sparse_threshold)
+					sum += w(k);
+
+			//weights are negative in concave cages, so the kept weights may cancel out, in which case
+			//renormalizing them would blow up the row, keep the row as is
+			bool keep_all = sum < MIN_KEPT_WEIGHT_SUM;
+			for (Eigen::Index k = 0; k < w.size(); k++)
+			{
+				if (keep_all)
+					row_trips[i].emplace_back(i, (int)k, w(k));
+				else if (std::abs(w(k)) >= sparse_threshold)
+					row_trips[i].emplace_back(i, (int)k, w(k) / sum);
+			}
+		}
+
+		std::vector<TRIP_t<float_type>> trips;
+		for (const auto& x : row_trips)
+			trips.insert(trips.end(), x.begin(), x.end());
+		m_weights_sparse.resize(n_pts, weights.cols());
+		m_weights_sparse.setFromTriplets(trips.begin(), trips.end());
+		m_weights_dense.resize(0, 0);
+	}
+
+	inline void MeanValueCage_2::apply(const fMATRIX& deformed_cage, fMATRIX& output) const
+	{
+		assert_throw((size_t)deformed_cage.rows() == m_num_cage_vertices, "the deformed cage does not match the rest cage");
+		if (m_is_sparse)
+			output = m_weights_sparse * deformed_cage;
+		else
+			output = m_weights_dense * deformed_cage;
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <memory>
+#include <igcclib/core/igcclib_eigen_def.hpp>
+#include <igcclib/geometry/TriangularMesh.hpp>
+
+namespace _NS_UTILITY
+{
+	/// <summary>
+	/// Mesh simplification by quadric error metric (QEM) edge collapse.
+	/// Boundary vertices and UV seam vertices can be locked so that the boundary and the seams are
+	/// kept exactly, other vertices collapse into their neighbors in the order of increasing quadric error.
+	/// The quadrics and the initial edge costs are computed in parallel, the collapses are serial.
+	/// </summary>
+	class MeshDecimator
+	{
+	public:
+		struct Options
+		{
+			//stop when the number of faces is not more than this, 0 to disable
+			size_t target_num_faces = 0;
+
+			//stop when the cheapest collapse has a larger quadric error (sum of squared distances
+			//to the original planes, in local coordinate), <=0 to disable
+			float_type max_error = -1;
+
+			//boundary vertices are never removed or moved
+			bool preserve_boundary = true;
+
+			//vertices with more than one texture coordinate are never removed or moved
+			bool preserve_uv_seam = true;
+
+			//reject a collapse if a face normal rotates more than this angle (in degree)
+			float_type max_normal_flip_deg = 90;
+		};
+
+		struct Info
+		{
+			size_t num_collapses = 0;
+
+			//the largest quadric error among the performed collapses
+			float_type max_error = 0;
+		};
+
+	public:
+		/// <summary>
+		/// set the mesh to be simplified, the mesh is copied and decimated in local coordinate,
+		/// so the output keeps the transformation of the input
+		/// </summary>
+		/// <param name="mesh">the input triangular mesh</param>
+		void init_with_mesh(const TriangularMesh& mesh);
+
+		void set_options(const Options& opt) { m_options = opt; }
+		const Options& get_options() const { return m_options; }
+
+		/// <summary>
+		/// simplify the mesh. The input mesh is not modified, so this can be called
+		/// several times with different options to create multiple levels of detail.
+		/// </summary>
+		/// <param name="output">the simplified mesh, with texture coordinates and texture image of the input.
+		/// Normals are recomputed per vertex if the input has normals, user-defined vertex attributes are dropped.</param>
+		/// <param name="out_vertex_index">for each output vertex, the index of the input vertex it comes from</param>
+		/// <param name="out_info">statistics of the decimation</param>
+		void decimate(TriangularMesh* output, std::vector<int_type>* out_vertex_index = nullptr,
+			Info* out_info = nullptr) const {
+			decimate_with_options(m_options, output, out_vertex_index, out_info);
+		}
+
+		/** \brief simplify the mesh with the given options instead of the stored ones,
+		it is safe to call this concurrently from multiple threads */
+		void decimate_with_options(const Options& opt, TriangularMesh* output,
+			std::vector<int_type>* out_vertex_index = nullptr, Info* out_info = nullptr) const;
+
+		bool is_initialized() const { return m_mesh != nullptr; }
+
+	protected:
+		Options m_options;
+		std::shared_ptr<TriangularMesh> m_mesh;
+
+		//per-vertex quadric, stored as the upper triangle of the symmetric 4x4 matrix
+		std::vector<std::array<double, 10>> m_quadrics;
+
+		//vertices on boundary or uv seams
+		std::vector<uint8_t> m_is_boundary;
+		std::vector<uint8_t> m_is_seam;
+	};
+}
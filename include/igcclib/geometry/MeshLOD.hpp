@@ -0,0 +1,135 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <functional>
+#include <igcclib/core/igcclib_eigen_def.hpp>
+#include <igcclib/geometry/TriangularMesh.hpp>
+
+namespace _NS_UTILITY
+{
+	/// <summary>
+	/// Level-of-detail pyramid of a triangular mesh. Level 0 is the original mesh, higher levels
+	/// are simplified by MeshDecimator and get coarser. All levels share the transformation
+	/// of the original mesh.
+	/// </summary>
+	class MeshLOD
+	{
+	public:
+		struct Level
+		{
+			std::shared_ptr<TriangularMesh> mesh;
+
+			//approximate maximum deviation from the original surface, in local coordinate
+			float_type error = 0;
+
+			template<typename Archive_t>
+			void serialize(Archive_t& ar) {
+				ar(mesh);
+				ar(error);
+			}
+		};
+
+		struct Options
+		{
+			//target number of faces of each simplified level, relative to the original mesh
+			std::vector<float_type> face_ratios = { 0.5, 0.25, 0.125, 0.0625, 0.03125 };
+
+			//levels with fewer faces than this are not created
+			size_t min_num_faces = 64;
+
+			bool preserve_boundary = true;
+			bool preserve_uv_seam = true;
+		};
+
+	public:
+		/// <summary>
+		/// create the pyramid by simplifying the mesh, the levels are simplified in parallel
+		/// </summary>
+		/// <param name="output">the output pyramid</param>
+		/// <param name="mesh">the original mesh, which is copied as level 0</param>
+		/// <param name="opt">options of the simplified levels</param>
+		static void init_with_mesh(MeshLOD& output, const TriangularMesh& mesh, const Options& opt);
+		static void init_with_mesh(MeshLOD& output, const TriangularMesh& mesh) {
+			init_with_mesh(output, mesh, Options());
+		}
+
+		size_t get_num_levels() const { return m_levels.size(); }
+		const Level& get_level(size_t idx) const { return m_levels.at(idx); }
+		const TriangularMesh& get_mesh(size_t idx) const { return *m_levels.at(idx).mesh; }
+
+		/** \brief the diagonal length of the bounding box of the original mesh, in local coordinate */
+		float_type get_diagonal_length() const { return m_diagonal_length; }
+
+		/** \brief index of the coarsest level whose error is within the budget, in local coordinate */
+		size_t select_level_by_error(float_type max_error) const;
+
+		/// <summary>
+		/// select a level by the projected size on screen
+		/// </summary>
+		/// <param name="screen_size">number of pixels covered by the diagonal of the mesh bounding box</param>
+		/// <param name="pixel_tolerance">maximum allowed error in pixels</param>
+		/// <returns>index of the coarsest level whose projected error is within the tolerance</returns>
+		size_t select_level_by_screen_size(float_type screen_size, float_type pixel_tolerance = 1.0) const;
+
+		/// <summary>
+		/// write the levels from coarse to fine, each level is a separate record, so that a reader
+		/// can use the coarse levels before the finer ones arrive
+		/// </summary>
+		/// <param name="ar">cereal output archive</param>
+		template<typename Archive_t>
+		void save_progressive(Archive_t& ar) const;
+
+		/// <summary>
+		/// read levels written by save_progressive()
+		/// </summary>
+		/// <param name="ar">cereal input archive</param>
+		/// <param name="output">the pyramid</param>
+		/// <param name="on_level_loaded">called when a level is read, with the level and its index in the final pyramid</param>
+		template<typename Archive_t>
+		static void load_progressive(Archive_t& ar, MeshLOD& output,
+			std::function<void(const Level&, size_t)> on_level_loaded = nullptr);
+
+	public:
+		//cereal serialization support
+		template<typename Archive_t>
+		void serialize(Archive_t& ar) {
+			ar(m_levels);
+			ar(m_diagonal_length);
+		}
+
+	protected:
+		std::vector<Level> m_levels;
+		float_type m_diagonal_length = 0;
+	};
+}
+
+namespace _NS_UTILITY
+{
+	template<typename Archive_t>
+	void MeshLOD::save_progressive(Archive_t& ar) const
+	{
+		ar((uint64_t)m_levels.size());
+		ar(m_diagonal_length);
+		for (auto it = m_levels.rbegin(); it != m_levels.rend(); ++it)
+			ar(*it);
+	}
+
+	template<typename Archive_t>
+	void MeshLOD::load_progressive(Archive_t& ar, MeshLOD& output,
+		std::function<void(const Level&, size_t)> on_level_loaded)
+	{
+		uint64_t n_level = 0;
+		ar(n_level);
+		ar(output.m_diagonal_length);
+
+		output.m_levels.clear();
+		output.m_levels.resize(n_level);
+		for (uint64_t i = 0; i < n_level; i++)
+		{
+			auto idx = n_level - 1 - i;
+			ar(output.m_levels[idx]);
+			if (on_level_loaded)
+				on_level_loaded(output.m_levels[idx], idx);
+		}
+	}
+}
@@ -20,6 +20,9 @@ namespace _NS_UTILITY
 		//triangle list for use with aabb tree
 		std::shared_ptr<std::vector<TRI_3>> m_trilist;
 
+		//global vertices from which the triangle list is created, for barycentric computation
+		fMATRIX m_vertices;
+
 	// management
 	public:
 		/// <summary>
@@ -59,8 +62,10 @@ namespace _NS_UTILITY
 		/// </summary>
 		/// <param name="pts">the query points, nx3 matrix</param>
 		/// <param name="out_nnpts">output nearest point for each query point</param>
-		/// <param name="out_idxtri">the index of the triangle where the nearest point lies in</param>
-		/// <param name="out_bc_pts">the barycentric coordinate of each nearest point</param>
+		/// <param name="out_idxtri">the index of the triangle where the nearest point lies in.
+		/// If out_bc_pts is requested, it is -1 for points in degenerate triangles.</param>
+		/// <param name="out_bc_pts">the barycentric coordinate of each nearest point. In a degenerate triangle,
+		/// the point is projected to the longest edge.</param>
 		void find_closest_point(const fMATRIX& pts, fMATRIX* out_nnpts,
 			iVECTOR* out_idxtri = 0, fMATRIX* out_bc_pts =0);
 
@@ -69,8 +74,9 @@ namespace _NS_UTILITY
 		*
 		* \param p the point in space whose closest point on the mesh will be found
 		* \param out_closest_point the closest point on the mesh
-		* \param out_idxtri the index of the triangle where the nearest point lies in 
-		* \param out_barycentric the barycentric coordinate of the closest point
+		* \param out_idxtri the index of the triangle where the nearest point lies in.
+		If out_barycentric is requested, it is -1 if the triangle is degenerate.
+		* \param out_barycentric the barycentric coordinate of the closest point, computed like the batch query
 		*/
 		void find_closest_point(const POINT_3& p, POINT_3* out_closest_point, 
 			int_type* out_idxtri, POINT_3* out_barycentric = nullptr);
@@ -80,8 +86,9 @@ namespace _NS_UTILITY
 		*
 		* \param p the point in space whose closest point on the mesh will be found
 		* \param out_closest_point the closest point on the mesh
-		* \param out_idxtri the index of the triangle where the nearest point lies in
-		* \param out_barycentric the barycentric coordinate of the closest point
+		* \param out_idxtri the index of the triangle where the nearest point lies in.
+		If out_barycentric is requested, it is -1 if the triangle is degenerate.
+		* \param out_barycentric the barycentric coordinate of the closest point, computed like the batch query
 		*/
 		void find_closest_point(const fVECTOR_3& p, fVECTOR_3* out_closest_point,
 			int_type* out_idxtri, fVECTOR_3* out_barycentric = nullptr);
@@ -92,7 +99,8 @@ namespace _NS_UTILITY
 		/// <param name="p0">nx3, origins of the rays</param>
 		/// <param name="dirs">nx3, directions of the rays</param>
 		/// <param name="out_hitpts">nx3, output hit points of each row</param>
-		/// <param name="out_idxtri">1xn, output indices of the triangles that contain the hit points. If a ray has no hit point, out_idxtri[i]=-1</param>
+		/// <param name="out_idxtri">1xn, output indices of the triangles that contain the hit points. If a ray has no hit point, out_idxtri[i]=-1.
+		/// If out_bcpts is requested, it is also -1 for hits in degenerate triangles.</param>
 		/// <param name="out_bcpts">nx3, barycentric coordinates of the hitpts in their triangles</param>
 		void intersect_with_ray_first(const fMATRIX& p0, const fMATRIX& dirs, 
 			fMATRIX* out_hitpts, iVECTOR* out_idxtri =0, fMATRIX* out_bcpts =0);
@@ -102,7 +110,8 @@ namespace _NS_UTILITY
 		/// </summary>
 		/// <param name="ray">the query ray</param>
 		/// <param name="out_hitpoint">output hit point</param>
-		/// <param name="out_idxtri">index of the triangle that contains the hit point. Equal to -1 if no hit point is found.</param>
+		/// <param name="out_idxtri">index of the triangle that contains the hit point. Equal to -1 if no hit point is found,
+		/// or if out_barycentric is requested and the triangle is degenerate.</param>
 		/// <param name="out_barycentric">the output barycentric coordinate</param>
 		void intersect_with_ray_first(const RAY_3& ray, POINT_3* out_hitpoint, int_type* out_idxtri, POINT_3* out_barycentric = nullptr);
 
@@ -1,37 +1,47 @@
 #pragma once
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <shared_mutex>
 #include <igcclib/core/igcclib_eigen_def.hpp>
 #include <igcclib/geometry/igcclib_cgal_def.hpp>
-
-#include <CGAL/Kd_tree.h>
-#include <CGAL/Search_traits_2.h>
-#include <CGAL/Search_traits_adapter.h>
-#include <boost/tuple/tuple.hpp>
+#include <igcclib/geometry/FlatKDTree_2.hpp>
 
 namespace _NS_UTILITY
 {
+	/// <summary>
+	/// 2d point query structure, a thin wrapper over FlatKDTree_2. Inserted points are kept in
+	/// a small buffer that is searched linearly, and merged into the tree when the buffer grows large.
+	/// It is safe to insert points from one thread while other threads query: the merged tree is
+	/// rebuilt outside the lock and swapped in, so queries are only blocked for the duration of an append.
+	/// Use get_index() for batch queries over the points in the tree.
+	/// </summary>
 	class SpatialQuery_2
 	{
-	public:
-		using TraitsBase = CGAL::Search_traits_2<KERNEL>;
-		using PointWithIndex = boost::tuple<POINT_2, size_t>;
-		using Traits = CGAL::Search_traits_adapter<PointWithIndex,
-			CGAL::Nth_of_tuple_property_map<0, PointWithIndex>,
-			TraitsBase>;
-		using KdTree = CGAL::Kd_tree<Traits>;
-
-
 	protected:
-		std::shared_ptr<KdTree> m_tree;
+		//immutable once built, replaced as a whole when inserted points are merged
+		std::shared_ptr<const FlatKDTree_2> m_tree;
 
-		//keep a record of the points
+		//keep a record of the points, the first m_tree->get_num_points() are in the tree
 		std::vector<POINT_2> m_points;
 
+		//guards m_tree and m_points
+		mutable std::shared_mutex m_mutex;
+
+		//is a merge running
+		std::atomic<bool> m_is_merging{ false };
+
+		//incremented by init_with_points(), so that a merge started before it is discarded
+		size_t m_generation = 0;
+
 	public:
 		SpatialQuery_2();
 		virtual ~SpatialQuery_2() {};
 
-		bool is_empty() const { return m_tree->size() == 0; }
+		bool is_empty() const { return get_num_points() == 0; }
+
+		/** \brief number of points, including those not yet merged into the tree */
+		size_t get_num_points() const;
 
 		/** \brief initialize with a list of 2d points */
 		void init_with_points(const std::vector<POINT_2>& pts);
@@ -55,9 +65,22 @@ namespace _NS_UTILITY
 		*/
 		std::vector<size_t> query_by_point(const POINT_2& p, int k, std::vector<double>* out_distance=nullptr) const;
 
-		/** \brief get all the points */
+		/** \brief get all the points, not safe if another thread is inserting points */
 		const std::vector<POINT_2>& get_points() const;
+
+		/** \brief get a copy of all the points, safe to call while other threads insert points */
+		std::vector<POINT_2> get_points_copy() const;
+
+		/** \brief merge the inserted points into the tree, so that all points are covered by get_index() */
+		void flush();
+
+		/** \brief snapshot of the underlying index, which may not include the most recently inserted points.
+		The snapshot stays valid after later inserts. */
+		std::shared_ptr<const FlatKDTree_2> get_index() const;
+
+	protected:
+		/** \brief build a tree over the current points without holding the lock, and swap it in */
+		void merge_pending_points();
 	};
 }
 
-
@@ -1,8 +1,8 @@
 #pragma once
 //CGAL and Eigen interop
 
-#include <CGAL/Barycentric_coordinates_2/Mean_value_coordinates_2.h>
 #include <igcclib/core/igcclib_eigen_def.hpp>
+#include <igcclib/geometry/igcclib_geometry.hpp>
 #include <igcclib/geometry/igcclib_cgal_def.hpp>
 
 namespace _NS_UTILITY
@@ -235,44 +235,6 @@ namespace _NS_UTILITY
 		triangulate_polygon_2(ptslist, out);
 	}
 
-	/// <summary>
-	/// compute mean value coordinates in 2d
-	/// </summary>
-	/// <param name="polygon_pts">the polygon point sequence, the first and last point DO NOT have to be the same,
-	/// as the polygon will be automatically closed</param>
-	/// <param name="query_pts">points against which mean value coordinates are computed</param>
-	/// <param name="output">output mean value coordinates for each point, each row is a point</param>
-	template<typename FLOAT_T>
-	inline void compute_mean_value_coordinate_2(
-		const MATRIX_t<FLOAT_T>& polygon_pts, const MATRIX_t<FLOAT_T>& query_pts,
-		MATRIX_t<FLOAT_T>& output)
-	{
-		// TODO: test needed
-		assert_throw(polygon_pts.cols() == 2, "only accepts 2d points");
-		assert_throw(query_pts.cols() == 2, "only accepts 2d points");
-
-		//construct mean value coordinate object
-		// using MEAN_VALUE = CGAL::Barycentric_coordinates::Mean_value_2<KERNEL>;
-		// using MEAN_VALUE_COORD = CGAL::Barycentric_coordinates::Generalized_barycentric_coordinates_2<MEAN_VALUE, KERNEL>;
-
-		auto _polygon_pts = to_point_list_2(polygon_pts);
-		// MEAN_VALUE_COORD mvc_computer(_polygon_pts.begin(), _polygon_pts.end());
-		output.resize(query_pts.rows(), polygon_pts.rows());
-
-		std::vector<FLOAT_T> _out;
-		_out.reserve(polygon_pts.rows());
-
-		for (int i = 0; i < query_pts.rows(); ++i)
-		{
-			_out.clear();
-			POINT_2 p(query_pts(i, 0), query_pts(i, 1));
-			CGAL::Barycentric_coordinates::mean_value_coordinates_2(polygon_pts, p, std::back_inserter(_out));
-			mvc_computer(p, std::back_inserter(_out));
-			for (int k = 0; k < _out.size(); k++)
-				output(i, k) = _out[k];
-		}
-	}
-
 	template<typename T>
 	void compute_vertex_normals(const TRIMESH_3& trimesh, MATRIX_t<T>& output) {
 		std::vector<VEC_3> normals;
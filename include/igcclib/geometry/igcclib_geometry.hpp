@@ -176,6 +176,56 @@ namespace _NS_UTILITY
 		int n_vert_dim = -1,
 		VertexOrderInFormulation vertex_order = VertexOrderInFormulation::XYZXYZ);
 
+	enum class LaplacianWeight
+	{
+		UNIFORM,	//every edge has weight 1
+		COTANGENT	//edge (i,j) has weight (cot(a)+cot(b))/2, a and b are the angles opposite to the edge
+	};
+
+	/// <summary>
+	/// create NxN laplacian matrix L=D-W from a mesh, where W is the edge weight matrix and D is
+	/// the diagonal matrix of row sums of W. The triplets are generated per face in parallel.
+	/// </summary>
+	/// <param name="output">the output laplacian matrix</param>
+	/// <param name="faces">the faces of the mesh, must be triangles for cotangent weight</param>
+	/// <param name="n_vert">number of vertices</param>
+	/// <param name="weight_type">the edge weight</param>
+	/// <param name="vertices">the vertices of the mesh, required for cotangent weight</param>
+	/// <param name="normalize">should we normalize each row so that the diagonal is one?</param>
+	template<typename T>
+	void laplacian_from_faces(SP_MATRIX_t<T>& output, const iMATRIX& faces, size_t n_vert,
+		LaplacianWeight weight_type = LaplacianWeight::UNIFORM,
+		const MATRIX_t<T>* vertices = nullptr, bool normalize = false);
+
+	/// <summary>
+	/// compute barycentric coordinates of many points, each in a given triangle of a mesh.
+	/// Points are processed in blocks gathered into single precision SoA buffers so that the
+	/// arithmetic vectorizes. A point off the triangle plane is projected onto it first.
+	/// Degenerate triangles (collinear or coincident vertices) are handled explicitly: the point is
+	/// projected to the longest edge of the triangle, so the output never contains NaN.
+	/// </summary>
+	/// <param name="vertices">nx3 vertices of the mesh</param>
+	/// <param name="faces">nx3 faces of the mesh</param>
+	/// <param name="idxfaces">for each point, the index of the triangle, negative to skip the point</param>
+	/// <param name="pts">nx3 points</param>
+	/// <param name="output">nx3 barycentric coordinates, zeros for skipped points</param>
+	/// <param name="out_degenerate">whether the triangle of each point is degenerate</param>
+	template<typename T>
+	void compute_barycentric_in_faces(const MATRIX_t<T>& vertices, const iMATRIX& faces,
+		const int_type* idxfaces, const MATRIX_t<T>& pts, MATRIX_t<T>& output,
+		std::vector<uint8_t>* out_degenerate = nullptr);
+
+	/// <summary>
+	/// compute 2d mean value coordinates of many query points with respect to a closed polygon,
+	/// in parallel over the query points. Points on the polygon boundary get the linear interpolation
+	/// weights of the edge or vertex they lie on.
+	/// </summary>
+	/// <param name="polygon">mx2 polygon vertices, the polygon is closed automatically</param>
+	/// <param name="query_pts">nx2 query points</param>
+	/// <param name="output">nxm coordinates, each row sums to one</param>
+	template<typename T>
+	void compute_mean_value_coordinate_2(const MATRIX_t<T>& polygon, const MATRIX_t<T>& query_pts, MATRIX_t<T>& output);
+
 	/**
 	* \brief project a list of points to a plane
 	*
@@ -850,4 +900,281 @@ namespace _NS_UTILITY
 			output.setFromTriplets(trips.begin(), trips.end());
 		}
 	}
-}
\ No newline at end of file
+
+	template<typename T>
+	void laplacian_from_faces(SP_MATRIX_t<T>& output, const iMATRIX& faces, size_t n_vert,
+		LaplacianWeight weight_type, const MATRIX_t<T>* vertices, bool normalize)
+	{
+		using TRIP = Eigen::Triplet<T>;
+		int n_face = (int)faces.rows();
+		int n_face_dim = (int)faces.cols();
+		bool is_cot = weight_type == LaplacianWeight::COTANGENT;
+		if (is_cot)
+		{
+			assert_throw(vertices != nullptr, "vertices are required for cotangent weight");
+			assert_throw(n_face_dim == 3, "cotangent weight requires triangle faces");
+		}
+
+		//each face edge creates 2 symmetric entries, written to a fixed slot so faces run in parallel
+		std::vector<TRIP> trips(n_face * n_face_dim * 2);
+
+#pragma omp parallel for
+		for (int i = 0; i < n_face; i++)
+		{
+			for (int k = 0; k < n_face_dim; k++)
+			{
+				auto u = faces(i, k);
+				auto v = faces(i, (k + 1) % n_face_dim);
+				T w = 1;
+				if (is_cot)
+				{
+					//angle at the vertex opposite to edge (u,v)
+					auto o = faces(i, (k + 2) % 3);
+					VECTOR_t<T> a = vertices->row(u) - vertices->row(o);
+					VECTOR_t<T> b = vertices->row(v) - vertices->row(o);
+					T sin_len;
+					if (a.size() == 3)
+						sin_len = VECTOR_3t<T>(a).cross(VECTOR_3t<T>(b)).norm();
+					else
+						sin_len = std::abs(a(0) * b(1) - a(1) * b(0));
+					w = a.dot(b) / std::max(sin_len, std::numeric_limits<T>::epsilon()) / 2;
+				}
+				auto idx = (i * n_face_dim + k) * 2;
+				trips[idx] = TRIP(u, v, w);
+				trips[idx + 1] = TRIP(v, u, w);
+			}
+		}
+
+		//cotangent weights from the 2 faces sharing an edge are summed,
+		//while uniform weight counts a shared edge only once
+		SP_MATRIX_t<T> wmat(n_vert, n_vert);
+		if (is_cot)
+			wmat.setFromTriplets(trips.begin(), trips.end());
+		else
+			wmat.setFromTriplets(trips.begin(), trips.end(), [](const T& a, const T&) { return a; });
+		std::vector<TRIP>().swap(trips);
+
+		//row sums of the weights
+		VECTOR_t<T> dgs = VECTOR_t<T>::Zero(n_vert);
+#pragma omp parallel for
+		for (int i = 0; i < (int)n_vert; i++)
+		{
+			for (typename SP_MATRIX_t<T>::InnerIterator it(wmat, i); it; ++it)
+				dgs(i) += it.value();
+		}
+
+		SP_MATRIX_t<T> dmat(n_vert, n_vert);
+		if (normalize)
+		{
+			//L = I - D^-1 W, isolated vertices get a zero row
+			VECTOR_t<T> inv_dgs(n_vert);
+			VECTOR_t<T> diag(n_vert);
+			for (size_t i = 0; i < n_vert; i++)
+			{
+				inv_dgs(i) = dgs(i) != 0 ? 1 / dgs(i) : 0;
+				diag(i) = dgs(i) != 0 ? 1 : 0;
+			}
+			dmat = diag.asDiagonal();
+			output = dmat - inv_dgs.asDiagonal() * wmat;
+		}
+		else
+		{
+			dmat = dgs.asDiagonal();
+			output = dmat - wmat;
+		}
+		output.makeCompressed();
+	}
+
+	template<typename T>
+	void compute_barycentric_in_faces(const MATRIX_t<T>& vertices, const iMATRIX& faces,
+		const int_type* idxfaces, const MATRIX_t<T>& pts, MATRIX_t<T>& output,
+		std::vector<uint8_t>* out_degenerate)
+	{
+		//a triangle is degenerate if the squared sine of its angle at the first vertex is below this
+		const float degenerate_tolerance = 1e-6f;
+		const int block_size = 256;
+
+		int n_pts = (int)pts.rows();
+		output.resize(n_pts, 3);
+		if (out_degenerate)
+			out_degenerate->assign(n_pts, 0);
+		int n_block = (n_pts + block_size - 1) / block_size;
+
+#pragma omp parallel for
+		for (int b = 0; b < n_block; b++)
+		{
+			//SoA buffers of triangle edges and points relative to the first vertex
+			alignas(64) float e1[3][block_size], e2[3][block_size], q[3][block_size];
+			alignas(64) float bu[block_size], bv[block_size], bw[block_size];
+			alignas(64) int is_bad[block_size];
+
+			int i_begin = b * block_size;
+			int n = std::min(block_size, n_pts - i_begin);
+
+			//gather, the differences are taken in the input precision to keep accuracy
+			for (int j = 0; j < n; j++)
+			{
+				auto f = idxfaces[i_begin + j];
+				if (f < 0)
+				{
+					for (int d = 0; d < 3; d++)
+						e1[d][j] = e2[d][j] = q[d][j] = 0;
+					continue;
+				}
+				auto a = faces(f, 0);
+				for (int d = 0; d < 3; d++)
+				{
+					auto x0 = vertices(a, d);
+					e1[d][j] = (float)(vertices(faces(f, 1), d) - x0);
+					e2[d][j] = (float)(vertices(faces(f, 2), d) - x0);
+					q[d][j] = (float)(pts(i_begin + j, d) - x0);
+				}
+			}
+
+#pragma omp simd
+			for (int j = 0; j < n; j++)
+			{
+				float d00 = e1[0][j] * e1[0][j] + e1[1][j] * e1[1][j] + e1[2][j] * e1[2][j];
+				float d01 = e1[0][j] * e2[0][j] + e1[1][j] * e2[1][j] + e1[2][j] * e2[2][j];
+				float d11 = e2[0][j] * e2[0][j] + e2[1][j] * e2[1][j] + e2[2][j] * e2[2][j];
+				float d20 = q[0][j] * e1[0][j] + q[1][j] * e1[1][j] + q[2][j] * e1[2][j];
+				float d21 = q[0][j] * e2[0][j] + q[1][j] * e2[1][j] + q[2][j] * e2[2][j];
+				float denom = d00 * d11 - d01 * d01;
+				int bad = !(denom > degenerate_tolerance * d00 * d11) || !(d00 > 0) || !(d11 > 0);
+				float inv = bad ? 0.0f : 1.0f / denom;
+				float v = (d11 * d20 - d01 * d21) * inv;
+				float w = (d00 * d21 - d01 * d20) * inv;
+				bv[j] = v;
+				bw[j] = w;
+				bu[j] = 1.0f - v - w;
+				is_bad[j] = bad;
+			}
+
+			//scatter, with degenerate triangles resolved by projecting to the longest edge
+			for (int j = 0; j < n; j++)
+			{
+				auto i = i_begin + j;
+				if (idxfaces[i] < 0)
+				{
+					output.row(i).setZero();
+					continue;
+				}
+				if (!is_bad[j])
+				{
+					output(i, 0) = bu[j];
+					output(i, 1) = bv[j];
+					output(i, 2) = bw[j];
+					continue;
+				}
+
+				if (out_degenerate)
+					(*out_degenerate)[i] = 1;
+
+				//the 3 edges as (start, direction) relative to the first vertex, with vertex indices
+				VECTOR_3t<T> p0 = VECTOR_3t<T>::Zero();
+				VECTOR_3t<T> p1(e1[0][j], e1[1][j], e1[2][j]);
+				VECTOR_3t<T> p2(e2[0][j], e2[1][j], e2[2][j]);
+				VECTOR_3t<T> pq(q[0][j], q[1][j], q[2][j]);
+				const VECTOR_3t<T>* corners[3] = { &p0, &p1, &p2 };
+
+				int best = 0;
+				T best_len = -1;
+				for (int k = 0; k < 3; k++)
+				{
+					T len = (*corners[(k + 1) % 3] - *corners[k]).squaredNorm();
+					if (len > best_len)
+					{
+						best_len = len;
+						best = k;
+					}
+				}
+
+				VECTOR_3t<T> bc = VECTOR_3t<T>::Zero();
+				if (best_len > 0)
+				{
+					const auto& s = *corners[best];
+					const auto& t = *corners[(best + 1) % 3];
+					T u = (pq - s).dot(t - s) / best_len;
+					u = std::min<T>(1, std::max<T>(0, u));
+					bc(best) = 1 - u;
+					bc((best + 1) % 3) = u;
+				}
+				else
+					bc(0) = 1; //all vertices coincide
+				output.row(i) = bc.transpose();
+			}
+		}
+	}
+
+	template<typename T>
+	void compute_mean_value_coordinate_2(const MATRIX_t<T>& polygon, const MATRIX_t<T>& query_pts, MATRIX_t<T>& output)
+	{
+		int n_vert = (int)polygon.rows();
+		int n_query = (int)query_pts.rows();
+		assert_throw(n_vert >= 3, "the polygon needs at least 3 vertices");
+
+		//tolerance relative to the size of the polygon
+		T scale = (polygon.colwise().maxCoeff() - polygon.colwise().minCoeff()).norm();
+		T eps = std::max(scale, T(1)) * std::numeric_limits<T>::epsilon() * 16;
+
+		output.resize(n_query, n_vert);
+
+#pragma omp parallel
+		{
+			std::vector<T> sx(n_vert), sy(n_vert), r(n_vert), tan_half(n_vert);
+
+#pragma omp for
+			for (int i = 0; i < n_query; i++)
+			{
+				auto w = output.row(i);
+				w.setZero();
+				T qx = query_pts(i, 0);
+				T qy = query_pts(i, 1);
+
+				int on_vertex = -1;
+				for (int k = 0; k < n_vert; k++)
+				{
+					sx[k] = polygon(k, 0) - qx;
+					sy[k] = polygon(k, 1) - qy;
+					r[k] = std::sqrt(sx[k] * sx[k] + sy[k] * sy[k]);
+					if (r[k] <= eps && on_vertex < 0)
+						on_vertex = k;
+				}
+				if (on_vertex >= 0)
+				{
+					w(on_vertex) = 1;
+					continue;
+				}
+
+				//tan(a/2) = 2A/(r*r'+D), where a is the signed angle spanned by an edge
+				int on_edge = -1;
+				for (int k = 0; k < n_vert && on_edge < 0; k++)
+				{
+					int k1 = (k + 1) % n_vert;
+					T area2 = sx[k] * sy[k1] - sx[k1] * sy[k];
+					T dot = sx[k] * sx[k1] + sy[k] * sy[k1];
+					if (std::abs(area2) <= eps * (r[k] + r[k1]) && dot < 0)
+						on_edge = k;
+					else
+						tan_half[k] = area2 / (r[k] * r[k1] + dot);
+				}
+				if (on_edge >= 0)
+				{
+					int k1 = (on_edge + 1) % n_vert;
+					w(on_edge) = r[k1] / (r[on_edge] + r[k1]);
+					w(k1) = r[on_edge] / (r[on_edge] + r[k1]);
+					continue;
+				}
+
+				T sum = 0;
+				for (int k = 0; k < n_vert; k++)
+				{
+					int kp = (k + n_vert - 1) % n_vert;
+					w(k) = (tan_half[kp] + tan_half[k]) / r[k];
+					sum += w(k);
+				}
+				w /= sum;
+			}
+		}
+	}
+}
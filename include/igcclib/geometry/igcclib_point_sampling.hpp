@@ -0,0 +1,451 @@
+#pragma once
+
+#include <vector>
+#include <random>
+#include <numeric>
+#include <unordered_map>
+
+#include <igcclib/core/igcclib_eigen_def.hpp>
+#include <igcclib/core/igcclib_eigen.hpp>
+#include <igcclib/geometry/TriangularMesh.hpp>
+
+namespace _NS_UTILITY
+{
+	// ================= delarations ============================
+
+	/** \brief how a voxel selects its representative point in voxel grid downsampling */
+	enum class VoxelSamplePolicy
+	{
+		CENTROID,	//the mean of all points in the voxel
+		FIRST,		//the point with the smallest index in the voxel
+		CLOSEST		//the point closest to the mean of the voxel
+	};
+
+	/// <summary>
+	/// downsample points by a regular voxel grid, each non-empty voxel produces one point.
+	/// The output order follows the first appearance of each voxel in the input.
+	/// </summary>
+	/// <param name="pts">nxd points, d=2 or 3</param>
+	/// <param name="voxel_size">the edge length of the voxel</param>
+	/// <param name="out_pts">the output points, one per voxel</param>
+	/// <param name="out_index">for each output point, the index of an input point in the same voxel,
+	/// which is the selected point for FIRST and CLOSEST policy, and the first point for CENTROID policy</param>
+	/// <param name="policy">how to select the representative point</param>
+	/// <param name="out_voxel_of_point">for each input point, the index of the output point of its voxel</param>
+	template<typename T>
+	void downsample_by_voxel_grid(const MATRIX_t<T>& pts, double voxel_size,
+		MATRIX_t<T>* out_pts, std::vector<int_type>* out_index = nullptr,
+		VoxelSamplePolicy policy = VoxelSamplePolicy::CENTROID,
+		std::vector<int_type>* out_voxel_of_point = nullptr);
+
+	/// <summary>
+	/// select a subset of points such that no two selected points are closer than radius
+	/// (poisson disk sampling by sample elimination). Points are visited in a random order
+	/// determined by seed, and grid cells far apart are processed in parallel.
+	/// </summary>
+	/// <param name="pts">nxd points, d=2 or 3</param>
+	/// <param name="radius">minimum distance between selected points</param>
+	/// <param name="seed">random seed of the visiting order</param>
+	/// <returns>indices of the selected points</returns>
+	template<typename T>
+	std::vector<int_type> sample_points_poisson_disk(const MATRIX_t<T>& pts, double radius, unsigned int seed = 0);
+
+	/// <summary>
+	/// randomly sample points on a triangle mesh surface, the number of samples in each face is
+	/// proportional to its area
+	/// </summary>
+	/// <param name="vertices">nx3 vertices</param>
+	/// <param name="faces">nx3 faces</param>
+	/// <param name="n_sample">number of samples</param>
+	/// <param name="out_pts">the sampled points</param>
+	/// <param name="out_face_index">the face where each sample lies</param>
+	/// <param name="out_barycentric">nx3 barycentric coordinate of each sample in its face</param>
+	/// <param name="seed">the random seed</param>
+	inline void sample_mesh_surface_uniform(const fMATRIX& vertices, const iMATRIX& faces, size_t n_sample,
+		fMATRIX* out_pts, std::vector<int_type>* out_face_index = nullptr,
+		fMATRIX* out_barycentric = nullptr, unsigned int seed = 0);
+
+	/// <summary>
+	/// poisson disk sampling of a triangle mesh surface. Area-weighted random samples are drawn
+	/// first and then thinned so that no two samples are closer than radius.
+	/// </summary>
+	/// <param name="vertices">nx3 vertices</param>
+	/// <param name="faces">nx3 faces</param>
+	/// <param name="radius">minimum distance between samples</param>
+	/// <param name="out_pts">the sampled points</param>
+	/// <param name="out_face_index">the face where each sample lies</param>
+	/// <param name="out_barycentric">nx3 barycentric coordinate of each sample in its face</param>
+	/// <param name="oversample">the number of random candidates relative to the densest possible
+	/// packing of disks, larger value gives better coverage</param>
+	/// <param name="seed">the random seed</param>
+	inline void sample_mesh_surface_poisson_disk(const fMATRIX& vertices, const iMATRIX& faces, double radius,
+		fMATRIX* out_pts, std::vector<int_type>* out_face_index = nullptr,
+		fMATRIX* out_barycentric = nullptr, double oversample = 5.0, unsigned int seed = 0);
+
+	/** \brief poisson disk sampling of a mesh surface in global coordinate */
+	inline void sample_mesh_surface_poisson_disk(const TriangularMesh& mesh, double radius,
+		fMATRIX* out_pts, std::vector<int_type>* out_face_index = nullptr,
+		fMATRIX* out_barycentric = nullptr, double oversample = 5.0, unsigned int seed = 0);
+}
+
+namespace _NS_UTILITY
+{
+	namespace _PointSampling
+	{
+		//number of bits for each dimension of a voxel key
+		constexpr int KEY_BITS = 21;
+		constexpr int64_t KEY_MAX = (int64_t(1) << KEY_BITS) - 1;
+
+		//compute integer cell coordinates of each point, packed into a single 64-bit key
+		template<typename T>
+		void compute_cell_keys(const MATRIX_t<T>& pts, double cell_size, std::vector<uint64_t>& keys)
+		{
+			auto ndim = pts.cols();
+			assert_throw(ndim == 2 || ndim == 3, "only 2d or 3d points are supported");
+			assert_throw(cell_size > 0, "cell size must be positive");
+
+			int n_pts = (int)pts.rows();
+			keys.resize(n_pts);
+			if (n_pts == 0)
+				return;
+
+			VECTOR_t<T> minc = pts.colwise().minCoeff();
+			VECTOR_t<T> maxc = pts.colwise().maxCoeff();
+			for (Eigen::Index k = 0; k < ndim; k++)
+				assert_throw((maxc(k) - minc(k)) / cell_size < KEY_MAX,
+					"cell size is too small for the extent of the points");
+
+#pragma omp parallel for
+			for (int i = 0; i < n_pts; i++)
+			{
+				uint64_t key = 0;
+				for (Eigen::Index k = 0; k < ndim; k++)
+				{
+					auto c = (uint64_t)((pts(i, k) - minc(k)) / cell_size);
+					key |= c << (KEY_BITS * k);
+				}
+				keys[i] = key;
+			}
+		}
+
+		inline int64_t key_coordinate(uint64_t key, int dim)
+		{
+			return (int64_t)((key >> (KEY_BITS * dim)) & KEY_MAX);
+		}
+
+		inline uint64_t make_key(const int64_t* coords, int ndim)
+		{
+			uint64_t key = 0;
+			for (int k = 0; k < ndim; k++)
+				key |= (uint64_t)coords[k] << (KEY_BITS * k);
+			return key;
+		}
+
+		//group points by key, output cells in the order of first appearance, with CSR point lists
+		inline void group_by_key(const std::vector<uint64_t>& keys,
+			std::unordered_map<uint64_t, int>& key2cell,
+			std::vector<int>& cell_of_point,
+			std::vector<int>& cell_offsets, std::vector<int>& cell_points)
+		{
+			key2cell.clear();
+			key2cell.reserve(keys.size());
+			cell_of_point.resize(keys.size());
+			for (size_t i = 0; i < keys.size(); i++)
+			{
+				auto it = key2cell.emplace(keys[i], (int)key2cell.size()).first;
+				cell_of_point[i] = it->second;
+			}
+
+			auto n_cell = key2cell.size();
+			cell_offsets.assign(n_cell + 1, 0);
+			for (auto c : cell_of_point)
+				cell_offsets[c + 1]++;
+			std::partial_sum(cell_offsets.begin(), cell_offsets.end(), cell_offsets.begin());
+
+			//points in each cell keep their input order
+			cell_points.resize(keys.size());
+			std::vector<int> cursor(cell_offsets.begin(), cell_offsets.end() - 1);
+			for (size_t i = 0; i < keys.size(); i++)
+				cell_points[cursor[cell_of_point[i]]++] = (int)i;
+		}
+	}
+
+	template<typename T>
+	void downsample_by_voxel_grid(const MATRIX_t<T>& pts, double voxel_size,
+		MATRIX_t<T>* out_pts, std::vector<int_type>* out_index,
+		VoxelSamplePolicy policy, std::vector<int_type>* out_voxel_of_point)
+	{
+		std::vector<uint64_t> keys;
+		_PointSampling::compute_cell_keys(pts, voxel_size, keys);
+
+		std::unordered_map<uint64_t, int> key2cell;
+		std::vector<int> cell_of_point, cell_offsets, cell_points;
+		_PointSampling::group_by_key(keys, key2cell, cell_of_point, cell_offsets, cell_points);
+
+		int n_cell = (int)key2cell.size();
+		auto ndim = pts.cols();
+		MATRIX_t<T> output(n_cell, ndim);
+		std::vector<int_type> index(n_cell);
+
+#pragma omp parallel for
+		for (int c = 0; c < n_cell; c++)
+		{
+			int i_begin = cell_offsets[c];
+			int i_end = cell_offsets[c + 1];
+			int first = cell_points[i_begin];
+			if (policy == VoxelSamplePolicy::FIRST)
+			{
+				output.row(c) = pts.row(first);
+				index[c] = first;
+				continue;
+			}
+
+			VECTOR_t<double> center = VECTOR_t<double>::Zero(ndim);
+			for (int i = i_begin; i < i_end; i++)
+				center += pts.row(cell_points[i]).transpose().template cast<double>();
+			center /= (i_end - i_begin);
+
+			if (policy == VoxelSamplePolicy::CENTROID)
+			{
+				output.row(c) = center.transpose().template cast<T>();
+				index[c] = first;
+			}
+			else
+			{
+				int best = first;
+				double best_dist = std::numeric_limits<double>::max();
+				for (int i = i_begin; i < i_end; i++)
+				{
+					auto idx = cell_points[i];
+					auto d = (pts.row(idx).transpose().template cast<double>() - center).squaredNorm();
+					if (d < best_dist)
+					{
+						best_dist = d;
+						best = idx;
+					}
+				}
+				output.row(c) = pts.row(best);
+				index[c] = best;
+			}
+		}
+
+		if (out_pts)
+			*out_pts = std::move(output);
+		if (out_index)
+			*out_index = std::move(index);
+		if (out_voxel_of_point)
+			out_voxel_of_point->assign(cell_of_point.begin(), cell_of_point.end());
+	}
+
+	template<typename T>
+	std::vector<int_type> sample_points_poisson_disk(const MATRIX_t<T>& pts, double radius, unsigned int seed)
+	{
+		using namespace _PointSampling;
+		std::vector<int_type> output;
+		if (pts.rows() == 0)
+			return output;
+
+		//with cell size = radius, only the 3^d neighboring cells can contain conflicting points
+		std::vector<uint64_t> keys;
+		compute_cell_keys(pts, radius, keys);
+
+		std::unordered_map<uint64_t, int> key2cell;
+		std::vector<int> cell_of_point, cell_offsets, cell_points;
+		group_by_key(keys, key2cell, cell_of_point, cell_offsets, cell_points);
+
+		int ndim = (int)pts.cols();
+		int n_cell = (int)key2cell.size();
+		double r2 = radius * radius;
+
+		//random visiting order inside each cell
+		{
+			std::mt19937 gen(seed);
+			for (int c = 0; c < n_cell; c++)
+				std::shuffle(cell_points.begin() + cell_offsets[c], cell_points.begin() + cell_offsets[c + 1], gen);
+		}
+
+		//neighbor cells of each cell, and the phase of each cell.
+		//Cells in the same phase are at least 3 cells apart in some dimension, so they never
+		//read each other's selection and can be processed concurrently.
+		std::vector<uint64_t> cell_keys(n_cell);
+		for (const auto& kv : key2cell)
+			cell_keys[kv.second] = kv.first;
+
+		int n_phase = ndim == 2 ? 9 : 27;
+		std::vector<std::vector<int>> phase_cells(n_phase);
+		for (int c = 0; c < n_cell; c++)
+		{
+			int phase = 0;
+			for (int k = ndim - 1; k >= 0; k--)
+				phase = phase * 3 + (int)(key_coordinate(cell_keys[c], k) % 3);
+			phase_cells[phase].push_back(c);
+		}
+
+		std::vector<std::vector<int>> selected(n_cell);
+		for (int ph = 0; ph < n_phase; ph++)
+		{
+			const auto& cells = phase_cells[ph];
+			int n = (int)cells.size();
+
+#pragma omp parallel for schedule(dynamic, 64)
+			for (int ic = 0; ic < n; ic++)
+			{
+				int c = cells[ic];
+				int64_t coord[3] = { 0,0,0 };
+				for (int k = 0; k < ndim; k++)
+					coord[k] = key_coordinate(cell_keys[c], k);
+
+				//collect the neighboring cells that exist
+				std::vector<int> nbcells;
+				int n_nb = ndim == 2 ? 9 : 27;
+				for (int m = 0; m < n_nb; m++)
+				{
+					int64_t nbcoord[3];
+					int mm = m;
+					bool valid = true;
+					for (int k = 0; k < ndim; k++)
+					{
+						nbcoord[k] = coord[k] + (mm % 3) - 1;
+						mm /= 3;
+						valid = valid && nbcoord[k] >= 0 && nbcoord[k] <= KEY_MAX;
+					}
+					if (!valid)
+						continue;
+					auto it = key2cell.find(make_key(nbcoord, ndim));
+					if (it != key2cell.end() && it->second != c)
+						nbcells.push_back(it->second);
+				}
+
+				auto& sel = selected[c];
+				for (int i = cell_offsets[c]; i < cell_offsets[c + 1]; i++)
+				{
+					int idx = cell_points[i];
+					auto p = pts.row(idx);
+					auto is_conflict = [&](const std::vector<int>& cand) {
+						for (auto j : cand)
+							if ((pts.row(j) - p).template cast<double>().squaredNorm() < r2)
+								return true;
+						return false;
+					};
+
+					bool conflict = is_conflict(sel);
+					for (size_t k = 0; k < nbcells.size() && !conflict; k++)
+						conflict = is_conflict(selected[nbcells[k]]);
+					if (!conflict)
+						sel.push_back(idx);
+				}
+			}
+		}
+
+		for (const auto& sel : selected)
+			output.insert(output.end(), sel.begin(), sel.end());
+		std::sort(output.begin(), output.end());
+		return output;
+	}
+
+	inline void sample_mesh_surface_uniform(const fMATRIX& vertices, const iMATRIX& faces, size_t n_sample,
+		fMATRIX* out_pts, std::vector<int_type>* out_face_index,
+		fMATRIX* out_barycentric, unsigned int seed)
+	{
+		int n_face = (int)faces.rows();
+		assert_throw(n_face > 0 || n_sample == 0, "cannot sample an empty mesh");
+
+		//cumulative face area
+		std::vector<double> cum_area(n_face);
+#pragma omp parallel for
+		for (int i = 0; i < n_face; i++)
+		{
+			fVECTOR_3 ab = vertices.row(faces(i, 1)) - vertices.row(faces(i, 0));
+			fVECTOR_3 ac = vertices.row(faces(i, 2)) - vertices.row(faces(i, 0));
+			cum_area[i] = ab.cross(ac).norm() / 2;
+		}
+		std::partial_sum(cum_area.begin(), cum_area.end(), cum_area.begin());
+		double total_area = n_face > 0 ? cum_area.back() : 0;
+
+		fMATRIX pts(n_sample, 3);
+		fMATRIX bcpts(n_sample, 3);
+		std::vector<int_type> idxface(n_sample);
+
+		//each block has its own generator so that the result does not depend on the number of threads
+		const int block_size = 4096;
+		int n_block = (int)((n_sample + block_size - 1) / block_size);
+
+#pragma omp parallel for
+		for (int b = 0; b < n_block; b++)
+		{
+			std::mt19937 gen(seed + (unsigned int)b * 7919u);
+			std::uniform_real_distribution<double> dist(0.0, 1.0);
+			size_t i_end = std::min(n_sample, (size_t)(b + 1) * block_size);
+			for (size_t i = (size_t)b * block_size; i < i_end; i++)
+			{
+				auto a = dist(gen) * total_area;
+				int f = (int)(std::upper_bound(cum_area.begin(), cum_area.end(), a) - cum_area.begin());
+				f = std::min(f, n_face - 1);
+
+				//uniform sampling in a triangle
+				auto u = dist(gen);
+				auto v = dist(gen);
+				if (u + v > 1)
+				{
+					u = 1 - u;
+					v = 1 - v;
+				}
+				fVECTOR_3 bc(1 - u - v, u, v);
+				idxface[i] = f;
+				bcpts.row(i) = bc.transpose();
+				pts.row(i) = bc(0) * vertices.row(faces(f, 0)) + bc(1) * vertices.row(faces(f, 1)) + bc(2) * vertices.row(faces(f, 2));
+			}
+		}
+
+		if (out_pts)
+			*out_pts = std::move(pts);
+		if (out_face_index)
+			*out_face_index = std::move(idxface);
+		if (out_barycentric)
+			*out_barycentric = std::move(bcpts);
+	}
+
+	inline void sample_mesh_surface_poisson_disk(const fMATRIX& vertices, const iMATRIX& faces, double radius,
+		fMATRIX* out_pts, std::vector<int_type>* out_face_index,
+		fMATRIX* out_barycentric, double oversample, unsigned int seed)
+	{
+		assert_throw(radius > 0, "radius must be positive");
+
+		double total_area = 0;
+		for (Eigen::Index i = 0; i < faces.rows(); i++)
+		{
+			fVECTOR_3 ab = vertices.row(faces(i, 1)) - vertices.row(faces(i, 0));
+			fVECTOR_3 ac = vertices.row(faces(i, 2)) - vertices.row(faces(i, 0));
+			total_area += ab.cross(ac).norm() / 2;
+		}
+
+		//densest packing of disks with diameter radius is hexagonal, each taking sqrt(3)/2*r^2 area
+		auto n_max = total_area / (std::sqrt(3.0) / 2 * radius * radius);
+		auto n_candidate = (size_t)std::ceil(std::max(1.0, oversample) * n_max) + 1;
+
+		fMATRIX cand_pts, cand_bc;
+		std::vector<int_type> cand_face;
+		sample_mesh_surface_uniform(vertices, faces, n_candidate, &cand_pts, &cand_face, &cand_bc, seed);
+
+		auto idxsel = sample_points_poisson_disk(cand_pts, radius, seed);
+		if (out_pts)
+			*out_pts = get_sub_matrix(cand_pts, idxsel, -1);
+		if (out_barycentric)
+			*out_barycentric = get_sub_matrix(cand_bc, idxsel, -1);
+		if (out_face_index)
+		{
+			out_face_index->resize(idxsel.size());
+			for (size_t i = 0; i < idxsel.size(); i++)
+				(*out_face_index)[i] = cand_face[idxsel[i]];
+		}
+	}
+
+	inline void sample_mesh_surface_poisson_disk(const TriangularMesh& mesh, double radius,
+		fMATRIX* out_pts, std::vector<int_type>* out_face_index,
+		fMATRIX* out_barycentric, double oversample, unsigned int seed)
+	{
+		auto v = mesh.get_vertices(true);
+		sample_mesh_surface_poisson_disk(v, mesh.get_faces(), radius,
+			out_pts, out_face_index, out_barycentric, oversample, seed);
+	}
+}
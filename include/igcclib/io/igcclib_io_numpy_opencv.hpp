@@ -1,5 +1,6 @@
 #pragma once
 
+#include <fstream>
 #include <igcclib/io/igcclib_io_numpy.hpp>
 #include <igcclib/vision/igcclib_opencv_def.hpp>
 
@@ -32,4 +33,44 @@ namespace _NS_UTILITY
 		else
 			assert_throw(false, "unknown data type");
 	}
+
+	/// <summary>
+	/// read a numpy array of shape (height, width) or (height, width, channel) into an opencv image.
+	/// The data is read directly into the image, whose buffer is reused if the size and type are unchanged.
+	/// </summary>
+	/// <param name="filename">the .npy file, the data must be in C order and host byte order</param>
+	/// <param name="output">the output image</param>
+	inline void read_np_array(const std::string& filename, cv::Mat& output)
+	{
+		std::ifstream infile(filename, std::ios::binary);
+		assert_throw(infile.good(), "failed to open " + filename);
+		auto header = npy::parse_header(npy::read_header(infile));
+		assert_throw(!header.fortran_order, "fortran order is not supported");
+		assert_throw(header.shape.size() >= 2 && header.shape.size() <= 3, "the array is not an image");
+
+		int depth = -1;
+		const auto& dt = header.dtype;
+		bool is_host_order = dt.byteorder == npy::no_endian_char || dt.byteorder == npy::host_endian_char;
+		if (dt.kind == 'u' && dt.itemsize == 1)
+			depth = CV_8U;
+		else if (dt.kind == 'i' && dt.itemsize == 1)
+			depth = CV_8S;
+		else if (dt.kind == 'u' && dt.itemsize == 2)
+			depth = CV_16U;
+		else if (dt.kind == 'i' && dt.itemsize == 2)
+			depth = CV_16S;
+		else if (dt.kind == 'i' && dt.itemsize == 4)
+			depth = CV_32S;
+		else if (dt.kind == 'f' && dt.itemsize == 4)
+			depth = CV_32F;
+		else if (dt.kind == 'f' && dt.itemsize == 8)
+			depth = CV_64F;
+		assert_throw(depth >= 0 && is_host_order, "unsupported data type " + dt.str());
+
+		int n_channel = header.shape.size() > 2 ? (int)header.shape[2] : 1;
+		assert_throw(n_channel <= CV_CN_MAX, "too many channels");
+		output.create((int)header.shape[0], (int)header.shape[1], CV_MAKETYPE(depth, n_channel));
+		infile.read((char*)output.data, output.total() * output.elemSize());
+		assert_throw(infile.good(), "failed to read the data of " + filename);
+	}
 }
\ No newline at end of file
@@ -289,20 +289,26 @@ namespace _NS_UTILITY
 		std::string texture_name = fn + ".png";
 		std::string mtl_name; 
 
-		ImageRGBA_u tex_img;
-		input_mesh.get_texture_image(tex_img);
-		/*std::cout << "Write obj texture channels:"<<tex_img.get_number_of_channels() << std::endl;*/
+		const auto& tex_data = input_mesh.get_texture_data_uint8();
 		
-		if (!tex_img.is_empty() && with_texture)
+		if (!tex_data.empty() && with_texture)
 		{
 			mtl_name = fn + ".mtl";
 
-			cv::Mat img;
-			to_opencv_image(tex_img, img);
-			if (img.channels() == 3)
-				cv::cvtColor(img, img, cv::COLOR_RGB2BGR);
-			else if (img.channels() == 4)
-				cv::cvtColor(img, img, cv::COLOR_RGBA2BGRA);
+			//swizzle the texture buffer into the BGR order of opencv in one pass
+			int width = (int)input_mesh.get_texture_width();
+			int height = (int)input_mesh.get_texture_height();
+			auto tex_format = input_mesh.get_texture_format();
+			int nch = get_num_channel(tex_format);
+			auto img_format = tex_format;
+			if (tex_format == ImageFormat::RGB)
+				img_format = ImageFormat::BGR;
+			else if (tex_format == ImageFormat::RGBA)
+				img_format = ImageFormat::BGRA;
+
+			cv::Mat img(height, width, CV_8UC(nch));
+			convert_image_format(ImageView_t<const uint8_t>::from_interleaved(tex_data.data(), width, height, nch), tex_format,
+				make_image_view<uint8_t>(img), img_format);
 			cv::imwrite(fn_out_texture, img);			
 
 			std::ofstream of_mtl(fn_out_mtl);		
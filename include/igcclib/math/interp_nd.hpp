@@ -63,6 +63,11 @@ namespace _NS_UTILITY
 		std::vector<GridRefCountT> m_grid_ref_list;	// reference counts for grids  
 		std::vector<std::vector<T> > m_grid_copy_list;  	// if CopyData == true, this holds the copies of the grids
 
+		// if all grids are uniformly spaced, cells are found in O(1) from the grid start and inverse spacing
+		bool m_is_uniform = false;
+		std::array<T, N> m_grid_start;
+		std::array<T, N> m_grid_inv_step;
+
 												// constructors assume that [f_begin, f_end) is a contiguous array in C-order  
 												// non ref-counted constructor.
 		template <class IterT1, class IterT2, class IterT3>
@@ -97,15 +102,44 @@ namespace _NS_UTILITY
 			for (int i = 0; i<N; i++) {
 				int gridLength = grids_len_begin[i];
 				if (bCopy == false) {
-					T const *grid_ptr = &(*grids_begin[i].begin());
+					T const *grid_ptr = &grids_begin[i][0];
 					m_grid_list.push_back(grid_type(gridLength, (T*)grid_ptr));	  				// use the given pointer
 				}
 				else {
-					m_grid_copy_list.push_back(std::vector<T>(grids_begin[i].begin(), grids_begin[i].begin() + grids_len_begin[i]));	// make our own copy of the grid
+					m_grid_copy_list.push_back(std::vector<T>(&grids_begin[i][0], &grids_begin[i][0] + grids_len_begin[i]));	// make our own copy of the grid
 					T *begin = &(m_grid_copy_list[i][0]);
 					m_grid_list.push_back(grid_type(gridLength, begin));							// use our copy
 				}
 			}
+			update_uniform_grid();
+		}
+
+		bool is_uniform_grid() const { return m_is_uniform; }
+
+		// check whether every grid is uniformly spaced, which enables the O(1) cell lookup
+		void update_uniform_grid() {
+			m_is_uniform = true;
+			for (int i = 0; i < N && m_is_uniform; i++) {
+				grid_type const &grid(m_grid_list[i]);
+				int n = grid.size();
+				if (n < 2) {
+					m_is_uniform = false;
+					break;
+				}
+				T step = (grid[n - 1] - grid[0]) / (n - 1);
+				if (!(step > 0)) {
+					m_is_uniform = false;
+					break;
+				}
+				for (int k = 0; k < n; k++) {
+					if (std::abs(grid[k] - (grid[0] + k * step)) > step * 1e-6) {
+						m_is_uniform = false;
+						break;
+					}
+				}
+				m_grid_start[i] = grid[0];
+				m_grid_inv_step[i] = 1 / step;
+			}
 		}
 	/*	template <class IterT1, class RefCountIterT>
 		void set_grids_refcount(RefCountIterT refs_begin, RefCountIterT refs_end) {
@@ -150,6 +184,16 @@ namespace _NS_UTILITY
 			grid_type const &grid(m_grid_list[dim]);
 			if (x < *(grid.begin())) return -1;
 			else if (x >= *(grid.end() - 1)) return grid.size() - 1;
+			else if (m_is_uniform) {
+				// guess the cell from the spacing, then fix the rounding error so that the result
+				// is the same as the binary search
+				int last = (int)grid.size() - 2;
+				int c = (int)((x - m_grid_start[dim]) * m_grid_inv_step[dim]);
+				c = std::min(std::max(c, 0), last);
+				while (c > 0 && x < grid[c]) c--;
+				while (c < last && x >= grid[c + 1]) c++;
+				return c;
+			}
 			else {
 				auto i_upper = std::upper_bound(grid.begin(), grid.end(), x);
 				return i_upper - grid.begin() - 1;
@@ -352,6 +396,65 @@ namespace _NS_UTILITY
 				*i_result++ = linterp_nd_unitcube(f.begin(), f.end(), x.begin(), x.end());
 			}
 		}
+
+		// interpolate many points in parallel, the same as interp_vec().
+		// pts holds the points in row-major order, the i-th point is pts[i*N] to pts[i*N+N-1].
+		// The 2^N corners are blended as a weighted sum over precomputed offsets into f.
+		void interp_batch(int n, T const *pts, DT *output) const {
+			const int n_vert = 1 << N;
+			DT const *fdata = super::m_pF->data();
+			auto const *strides = super::m_pF->strides();
+
+#pragma omp parallel for if(n > 1024)
+			for (int i = 0; i < n; i++) {
+				// per dimension, the index of the lower vertex, the step to the upper one and the blend weight
+				std::array<long, N> base, step;
+				std::array<T, N> y;
+				for (int dim = 0; dim < N; dim++) {
+					auto const &grid(super::m_grid_list[dim]);
+					T xi = pts[(size_t)i * N + dim];
+					int c = this->find_cell(dim, xi);
+					int len = (int)grid.size();
+					if (c == -1) {
+						base[dim] = 0;
+						step[dim] = 0;
+						y[dim] = 1.0;
+					}
+					else if (c == len - 1) {
+						base[dim] = super::m_bContinuous ? len - 1 : 2 * len - 1;
+						step[dim] = 0;
+						y[dim] = 0.0;
+					}
+					else {
+						base[dim] = super::m_bContinuous ? c : 1 + 2 * c;
+						step[dim] = 1;
+						T t = (xi - grid[c]) / (grid[c + 1] - grid[c]);
+						y[dim] = t < 0 ? 0 : (t > 1 ? 1 : t);
+					}
+				}
+
+				// vertex v selects the upper side of dim if bit (N-dim-1) is set, as in get_f_val()
+				std::array<long, 1 << N> offset;
+				std::array<DT, 1 << N> weight;
+				for (int v = 0; v < n_vert; v++) {
+					long off = 0;
+					DT w = 1;
+					for (int dim = 0; dim < N; dim++) {
+						int bit = (v >> (N - dim - 1)) & 1;
+						off += (base[dim] + bit * step[dim]) * strides[dim];
+						w *= bit ? y[dim] : 1 - y[dim];
+					}
+					offset[v] = off;
+					weight[v] = w;
+				}
+
+				DT sum = 0;
+#pragma omp simd reduction(+:sum)
+				for (int v = 0; v < n_vert; v++)
+					sum += weight[v] * fdata[offset[v]];
+				output[i] = sum;
+			}
+		}
 	};
 
 	typedef InterpSimplex<1, double,double> NDInterpolator_1_S;
@@ -372,7 +475,7 @@ namespace _NS_UTILITY
 		void linterp_simplex_3(double **grids_begin, int *grid_len_begin, double *pF, int xi_len, double **xi_begin, double *pResult);
 	}
 
-	void linterp_simplex_1(double **grids_begin, int *grid_len_begin, double *pF, int xi_len, double **xi_begin, double *pResult) {
+	inline void linterp_simplex_1(double **grids_begin, int *grid_len_begin, double *pF, int xi_len, double **xi_begin, double *pResult) {
 		const int N = 1;
 		size_t total_size = 1;
 		for (int i = 0; i<N; i++) {
@@ -382,7 +485,7 @@ namespace _NS_UTILITY
 		interp_obj.interp_vec(xi_len, xi_begin, xi_begin + N, pResult);
 	}
 
-	void linterp_simplex_2(double **grids_begin, int *grid_len_begin, double *pF, int xi_len, double **xi_begin, double *pResult) {
+	inline void linterp_simplex_2(double **grids_begin, int *grid_len_begin, double *pF, int xi_len, double **xi_begin, double *pResult) {
 		const int N = 2;
 		size_t total_size = 1;
 		for (int i = 0; i<N; i++) {
@@ -392,7 +495,7 @@ namespace _NS_UTILITY
 		interp_obj.interp_vec(xi_len, xi_begin, xi_begin + N, pResult);
 	}
 
-	void linterp_simplex_3(double **grids_begin, int *grid_len_begin, double *pF, int xi_len, double **xi_begin, double *pResult) {
+	inline void linterp_simplex_3(double **grids_begin, int *grid_len_begin, double *pF, int xi_len, double **xi_begin, double *pResult) {
 		const int N = 3;
 		size_t total_size = 1;
 		for (int i = 0; i<N; i++) {
@@ -1,4 +1,6 @@
 #pragma once
+#include <algorithm>
+#include <vector>
 #include <igcclib/igcclib_master.hpp>
 #include <igcclib/core/igcclib_eigen.hpp>
 
@@ -32,4 +34,292 @@ namespace _NS_UTILITY {
 		MATRIX_t<T> sol = solver.solve(A.transpose() * b);
 		return sol;
 	}
-};
\ No newline at end of file
+
+	enum class SparseSolverMethod
+	{
+		LLT,	//symmetric positive definite
+		LDLT,	//symmetric, possibly semi-definite
+		LU		//general square matrix
+	};
+
+	/// <summary>
+	/// Sparse linear solver that keeps the factorization of the system matrix, so that
+	/// repeated solves with the same matrix (e.g. laplacian smoothing with a fixed mesh) do not
+	/// refactorize. When the matrix is updated with the same sparsity pattern, only the numeric
+	/// factorization is recomputed and the symbolic analysis (ordering) is reused.
+	/// </summary>
+	template<typename T>
+	class SparseSolver_t
+	{
+	public:
+		using SPMAT = SP_MATRIX_col_t<T>;
+
+		SparseSolver_t(SparseSolverMethod method = SparseSolverMethod::LLT) : m_method(method) {}
+		SparseSolver_t(const SparseSolver_t&) = delete;
+		SparseSolver_t& operator=(const SparseSolver_t&) = delete;
+
+		/// <summary>
+		/// factorize the system matrix
+		/// </summary>
+		/// <param name="A">the system matrix</param>
+		/// <param name="least_squares">if true, solve A*x=b in least squares sense by factorizing A^T*A,
+		/// otherwise A must be square and is factorized directly</param>
+		/// <returns>whether the factorization succeeded</returns>
+		bool factorize(const SP_MATRIX_t<T>& A, bool least_squares = false);
+
+		/** \brief solve A*x=b for all columns of b, the columns are solved in parallel */
+		void solve(const MATRIX_t<T>& b, MATRIX_t<T>& output) const;
+		MATRIX_t<T> solve(const MATRIX_t<T>& b) const {
+			MATRIX_t<T> output;
+			solve(b, output);
+			return output;
+		}
+
+		/** \brief change the solver method, the factorization is discarded */
+		void set_method(SparseSolverMethod method) {
+			m_method = method;
+			clear();
+		}
+		SparseSolverMethod get_method() const { return m_method; }
+
+		bool is_factorized() const { return m_factorized; }
+		bool is_least_squares() const { return m_least_squares; }
+
+		/** \brief discard the factorization and the cached symbolic analysis */
+		void clear() {
+			m_factorized = false;
+			m_outer_index.clear();
+			m_inner_index.clear();
+			m_A_transpose.resize(0, 0);
+		}
+
+	protected:
+		//is the sparsity pattern of mat the same as the one last analyzed
+		bool is_same_pattern(const SPMAT& mat) const;
+
+	protected:
+		SparseSolverMethod m_method = SparseSolverMethod::LLT;
+		bool m_factorized = false;
+		bool m_least_squares = false;
+
+		Eigen::SimplicialLLT<SPMAT> m_llt;
+		Eigen::SimplicialLDLT<SPMAT> m_ldlt;
+		Eigen::SparseLU<SPMAT> m_lu;
+
+		//sparsity pattern of the analyzed matrix
+		std::vector<typename SPMAT::StorageIndex> m_outer_index;
+		std::vector<typename SPMAT::StorageIndex> m_inner_index;
+
+		//A^T, used to form the right hand side in least squares mode
+		SPMAT m_A_transpose;
+	};
+	using fSparseSolver = SparseSolver_t<float_type>;
+
+	/// <summary>
+	/// Cholesky factorization of a symmetric positive definite band matrix, which takes O(n*w^2) time
+	/// where w is the half bandwidth, e.g. the normal equations of 1d spline fitting.
+	/// The lower band is stored densely as an nx(w+1) matrix, where band(i,k) = A(i,i-k).
+	/// </summary>
+	template<typename T>
+	class BandedCholesky_t
+	{
+	public:
+		/// <summary>
+		/// factorize the band matrix
+		/// </summary>
+		/// <param name="band">nx(w+1) lower band, band(i,k) = A(i,i-k). Entries with i-k<0 are ignored.</param>
+		/// <returns>whether the matrix is positive definite</returns>
+		bool factorize(const MATRIX_t<T>& band);
+
+		/** \brief solve A*x=b for all columns of b, the columns are solved in parallel */
+		void solve(const MATRIX_t<T>& b, MATRIX_t<T>& output) const;
+		MATRIX_t<T> solve(const MATRIX_t<T>& b) const {
+			MATRIX_t<T> output;
+			solve(b, output);
+			return output;
+		}
+
+		bool is_factorized() const { return m_factorized; }
+		Eigen::Index get_size() const { return m_L.rows(); }
+		int get_bandwidth() const { return (int)m_L.cols() - 1; }
+
+		void clear() {
+			m_factorized = false;
+			m_L.resize(0, 0);
+		}
+
+	protected:
+		//lower band of the cholesky factor, in the same layout as the input
+		MATRIX_t<T> m_L;
+		bool m_factorized = false;
+	};
+	using fBandedCholesky = BandedCholesky_t<float_type>;
+
+	// ================== implementations =======================
+	template<typename T>
+	bool SparseSolver_t<T>::is_same_pattern(const SPMAT& mat) const
+	{
+		if (m_outer_index.size() != (size_t)mat.outerSize() + 1 || m_inner_index.size() != (size_t)mat.nonZeros())
+			return false;
+		return std::equal(m_outer_index.begin(), m_outer_index.end(), mat.outerIndexPtr()) &&
+			std::equal(m_inner_index.begin(), m_inner_index.end(), mat.innerIndexPtr());
+	}
+
+	template<typename T>
+	bool SparseSolver_t<T>::factorize(const SP_MATRIX_t<T>& A, bool least_squares)
+	{
+		SPMAT mat;
+		if (least_squares)
+		{
+			m_A_transpose = A.transpose();
+			mat = m_A_transpose * A;
+		}
+		else
+		{
+			assert_throw(A.rows() == A.cols(), "the system matrix must be square, use least squares otherwise");
+			m_A_transpose.resize(0, 0);
+			mat = A;
+		}
+		mat.makeCompressed();
+		m_least_squares = least_squares;
+
+		//symbolic analysis only when the pattern changes
+		bool need_analyze = !is_same_pattern(mat);
+		Eigen::ComputationInfo info = Eigen::Success;
+		switch (m_method)
+		{
+		case SparseSolverMethod::LLT:
+			if (need_analyze)
+				m_llt.analyzePattern(mat);
+			m_llt.factorize(mat);
+			info = m_llt.info();
+			break;
+		case SparseSolverMethod::LDLT:
+			if (need_analyze)
+				m_ldlt.analyzePattern(mat);
+			m_ldlt.factorize(mat);
+			info = m_ldlt.info();
+			break;
+		case SparseSolverMethod::LU:
+			if (need_analyze)
+				m_lu.analyzePattern(mat);
+			m_lu.factorize(mat);
+			info = m_lu.info();
+			break;
+		}
+
+		if (need_analyze)
+		{
+			m_outer_index.assign(mat.outerIndexPtr(), mat.outerIndexPtr() + mat.outerSize() + 1);
+			m_inner_index.assign(mat.innerIndexPtr(), mat.innerIndexPtr() + mat.nonZeros());
+		}
+
+		m_factorized = info == Eigen::Success;
+		return m_factorized;
+	}
+
+	template<typename T>
+	void SparseSolver_t<T>::solve(const MATRIX_t<T>& b, MATRIX_t<T>& output) const
+	{
+		assert_throw(m_factorized, "the solver is not factorized");
+
+		MATRIX_col_t<T> rhs;
+		if (m_least_squares)
+			rhs = m_A_transpose * b;
+		else
+			rhs = b;
+
+		int n_col = (int)rhs.cols();
+		MATRIX_col_t<T> sol(rhs.rows(), n_col);
+
+		//the factorization is only read in solve(), so the columns can be solved concurrently
+#pragma omp parallel for if(n_col > 1)
+		for (int i = 0; i < n_col; i++)
+		{
+			switch (m_method)
+			{
+			case SparseSolverMethod::LLT:
+				sol.col(i) = m_llt.solve(rhs.col(i));
+				break;
+			case SparseSolverMethod::LDLT:
+				sol.col(i) = m_ldlt.solve(rhs.col(i));
+				break;
+			case SparseSolverMethod::LU:
+				sol.col(i) = m_lu.solve(rhs.col(i));
+				break;
+			}
+		}
+		output = sol;
+	}
+
+	template<typename T>
+	bool BandedCholesky_t<T>::factorize(const MATRIX_t<T>& band)
+	{
+		assert_throw(band.cols() >= 1, "the band must have at least the diagonal");
+		m_L = band;
+		m_factorized = false;
+
+		int n = (int)m_L.rows();
+		int w = (int)m_L.cols() - 1;
+		for (int i = 0; i < n; i++)
+		{
+			int jmin = std::max(0, i - w);
+			for (int j = jmin; j <= i; j++)
+			{
+				T sum = m_L(i, i - j);
+				for (int k = std::max(jmin, j - w); k < j; k++)
+					sum -= m_L(i, i - k) * m_L(j, j - k);
+
+				if (i == j)
+				{
+					if (!(sum > 0))
+						return false;
+					m_L(i, 0) = std::sqrt(sum);
+				}
+				else
+					m_L(i, i - j) = sum / m_L(j, 0);
+			}
+		}
+
+		m_factorized = true;
+		return true;
+	}
+
+	template<typename T>
+	void BandedCholesky_t<T>::solve(const MATRIX_t<T>& b, MATRIX_t<T>& output) const
+	{
+		assert_throw(m_factorized, "the solver is not factorized");
+		assert_throw(b.rows() == m_L.rows(), "size of b does not match the matrix");
+
+		int n = (int)m_L.rows();
+		int w = (int)m_L.cols() - 1;
+		int n_col = (int)b.cols();
+		MATRIX_col_t<T> sol = b;
+
+#pragma omp parallel for if(n_col > 1)
+		for (int c = 0; c < n_col; c++)
+		{
+			T* x = sol.col(c).data();
+
+			//L*y=b
+			for (int i = 0; i < n; i++)
+			{
+				T sum = x[i];
+				for (int k = std::max(0, i - w); k < i; k++)
+					sum -= m_L(i, i - k) * x[k];
+				x[i] = sum / m_L(i, 0);
+			}
+
+			//L^T*x=y
+			for (int i = n - 1; i >= 0; i--)
+			{
+				T sum = x[i];
+				int kmax = std::min(n - 1, i + w);
+				for (int k = i + 1; k <= kmax; k++)
+					sum -= m_L(k, k - i) * x[k];
+				x[i] = sum / m_L(i, 0);
+			}
+		}
+		output = sol;
+	}
+};
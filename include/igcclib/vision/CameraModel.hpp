@@ -39,7 +39,8 @@ namespace _NS_UTILITY
 		void set_image_size(int width, int height) { m_width = width; m_height = height; }
 
 		/**
-		* \brief project 3d points in camera coordinate to 2d coordinate
+		* \brief project 3d points in camera coordinate to 2d coordinate, the same as cv::projectPoints(),
+		* which ignores the skew of the projection matrix
 		*
 		* \param pts input 3d points
 		* \return the projected 2d points
@@ -49,6 +50,47 @@ namespace _NS_UTILITY
 		/** \brief project a single 3d point to 2d */
 		fVECTOR_2 project_points(const fVECTOR_3& p, bool with_distortion = true) const;
 
+		/// <summary>
+		/// project 3d points in world coordinate stored as separate x,y,z arrays, in parallel.
+		/// The extrinsic transform, projection and opencv distortion model are evaluated natively,
+		/// the results are the same as cv::projectPoints(), which also ignores the skew of the projection matrix.
+		/// </summary>
+		/// <param name="n_point">number of points</param>
+		/// <param name="xs">x coordinates of the points, similarly for ys and zs</param>
+		/// <param name="out_us">output horizontal image coordinates, similarly for out_vs</param>
+		/// <param name="with_distortion">apply the distortion coefficients or not</param>
+		/// <param name="out_depths">if not null, output z of the points in camera coordinate</param>
+		void project_points(int n_point, const float* xs, const float* ys, const float* zs,
+			float* out_us, float* out_vs, bool with_distortion = true, float* out_depths = nullptr) const;
+
+		/// <summary>
+		/// remove distortion from image coordinates, giving the normalized coordinates (x/z, y/z) of the points
+		/// in camera coordinate. The distortion is inverted by fixed-point iterations like cv::undistortPoints(),
+		/// and the skew is ignored like in project_points().
+		/// </summary>
+		/// <param name="n_point">number of points</param>
+		/// <param name="us">horizontal image coordinates, similarly for vs</param>
+		/// <param name="out_xs">output normalized x coordinates, similarly for out_ys</param>
+		/// <param name="with_distortion">remove the distortion or only invert the projection matrix</param>
+		/// <param name="n_iteration">number of fixed-point iterations</param>
+		void undistort_points(int n_point, const float* us, const float* vs, float* out_xs, float* out_ys,
+			bool with_distortion = true, int n_iteration = 10) const;
+
+		/// <summary>
+		/// lookup maps of the undistorted normalized coordinates (x/z, y/z) of all pixels, where pixel (i,j)
+		/// is at u=j, v=i. The ray of a pixel in camera coordinate is (x,y,1).
+		/// </summary>
+		/// <param name="out_x">height x width normalized x coordinates</param>
+		/// <param name="out_y">height x width normalized y coordinates</param>
+		void make_undistortion_map(MATRIX_f& out_x, MATRIX_f& out_y, int n_iteration = 10) const;
+
+		/// <summary>
+		/// lookup maps that undistort the image with cv::remap(), like cv::initUndistortRectifyMap() with
+		/// the same projection matrix. For every pixel of the undistorted image, the map gives its location
+		/// in the distorted image.
+		/// </summary>
+		void make_distortion_map(MATRIX_f& out_map_x, MATRIX_f& out_map_y) const;
+
 		/** \brief convert a point in world coordinate to camera coordinate */
 		fVECTOR_3 convert_world_to_camera(const fVECTOR_3& p) const;
 
@@ -59,6 +101,17 @@ namespace _NS_UTILITY
 		void ray_from_projected_points(
 			const fVECTOR_2& p, fVECTOR_3* out_ray_p0, fVECTOR_3* out_ray_dir) const;
 
+		/// <summary>
+		/// convert projected points to 3d rays in world coordinate, in parallel.
+		/// All rays start from the camera position.
+		/// </summary>
+		/// <param name="pts">nx2 image coordinates</param>
+		/// <param name="out_ray_p0">the camera position</param>
+		/// <param name="out_ray_dirs">nx3 normalized ray directions</param>
+		/// <param name="with_distortion">remove the distortion before computing the rays or not</param>
+		void ray_from_projected_points(const fMATRIX& pts, fVECTOR_3* out_ray_p0, fMATRIX* out_ray_dirs,
+			bool with_distortion = false) const;
+
 		/** \brief get fov in width, in degree */
 		double get_fov_width_degree() const;
 
@@ -0,0 +1,58 @@
+#pragma once
+#include <igcclib/core/igcclib_eigen_def.hpp>
+#include <igcclib/vision/igcclib_opencv_def.hpp>
+#include <igcclib/vision/CameraModel.hpp>
+
+namespace _NS_UTILITY
+{
+	/// <summary>
+	/// Back projection of depth images into point clouds in camera coordinate. The undistorted ray of
+	/// every pixel is computed once from the camera model and kept in a table, then a whole depth image
+	/// is converted by multiplying each depth with its ray, in parallel over rows.
+	/// </summary>
+	class IGCCLIB_API DepthBackProjector
+	{
+	public:
+		/// <summary>
+		/// build the ray table of a perspective camera whose image size is set. The table is kept if the
+		/// projection matrix, distortion and image size are the same as the last call.
+		/// </summary>
+		/// <param name="camera">the depth camera</param>
+		/// <param name="n_iteration">number of iterations to remove the distortion</param>
+		/// <returns>whether the table is rebuilt</returns>
+		bool init(const CameraModel& camera, int n_iteration = 10);
+
+		/// <summary>
+		/// convert a depth image into 3d points
+		/// </summary>
+		/// <param name="depth">CV_16UC1, CV_32FC1 or CV_64FC1 depth image of the camera size, 0 or non-finite depth is invalid</param>
+		/// <param name="out_xyz">CV_32FC3 points, invalid pixels are (0,0,0)</param>
+		/// <param name="depth_scale">multiplied to the depth values, e.g. 0.001 converts mm to m</param>
+		/// <param name="out_normals">if not null, CV_32FC3 unit normals facing the camera, by central differences.
+		/// Pixels on the border or next to invalid pixels are (0,0,0).</param>
+		/// <param name="is_range">if true, the depth is the distance along the ray, otherwise it is z</param>
+		void back_project(const cv::Mat& depth, cv::Mat& out_xyz, double depth_scale = 1.0,
+			cv::Mat* out_normals = nullptr, bool is_range = false) const;
+
+		/** \brief the 3d point of a single pixel */
+		fVECTOR_3 back_project_pixel(int x, int y, double depth, bool is_range = false) const;
+
+		bool is_init() const { return m_ray_x.size() > 0; }
+		int get_width() const { return (int)m_ray_x.cols(); }
+		int get_height() const { return (int)m_ray_x.rows(); }
+
+		/** \brief the ray table, the ray of pixel (i,j) is (x(i,j), y(i,j), 1) in camera coordinate */
+		const MATRIX_f& get_ray_x() const { return m_ray_x; }
+		const MATRIX_f& get_ray_y() const { return m_ray_y; }
+
+	protected:
+		MATRIX_f m_ray_x;
+		MATRIX_f m_ray_y;
+		MATRIX_f m_ray_inv_norm;	//1/|(x,y,1)|, to convert range to z
+
+		//the camera parameters of the table
+		fMATRIX_3 m_projection_matrix = fMATRIX_3::Zero();
+		fVECTOR m_distortion;
+		int m_n_iteration = 0;
+	};
+}
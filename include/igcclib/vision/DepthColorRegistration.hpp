@@ -0,0 +1,95 @@
+#pragma once
+#include <igcclib/core/igcclib_eigen_def.hpp>
+#include <igcclib/vision/igcclib_opencv_def.hpp>
+#include <igcclib/vision/CameraModel.hpp>
+#include <igcclib/vision/DepthBackProjector.hpp>
+
+namespace _NS_UTILITY
+{
+	/// <summary>
+	/// Registration of a color camera to a depth camera, which finds the color of every depth pixel.
+	/// The ray of every depth pixel is rotated into the color camera coordinate once and kept in a table,
+	/// so that a depth pixel at depth z lands on z*dir+t in the color camera. A frame is then registered
+	/// in one pass over the depth rows in parallel, which projects the points into the color image
+	/// and samples the colors. Output buffers are only reallocated when their size or type changes.
+	/// </summary>
+	class IGCCLIB_API DepthColorRegistration
+	{
+	public:
+		/// <summary>
+		/// build the tables for a pair of perspective cameras whose image sizes are set. The tables are kept
+		/// if the intrinsics, extrinsics, distortions and image sizes are the same as the last call.
+		/// </summary>
+		/// <param name="depth_camera">the depth camera</param>
+		/// <param name="color_camera">the color camera, its extrinsic is relative to the same world as the depth camera</param>
+		/// <param name="n_iteration">number of iterations to remove the distortion of the depth camera</param>
+		/// <returns>whether the tables are rebuilt</returns>
+		bool init(const CameraModel& depth_camera, const CameraModel& color_camera, int n_iteration = 10);
+
+		/// <summary>
+		/// build only the ray table of the depth camera, for frames without a color camera. The color tables are
+		/// dropped if the rays change, and rebuilt by the next init().
+		/// </summary>
+		/// <returns>whether the ray table is rebuilt</returns>
+		bool init_depth_rays(const CameraModel& depth_camera, int n_iteration = 10);
+
+		/// <summary>
+		/// find the color image coordinate of every depth pixel
+		/// </summary>
+		/// <param name="depth">CV_16UC1, CV_32FC1 or CV_64FC1 depth image of the depth camera size, 0 or non-finite depth is invalid</param>
+		/// <param name="out_xy">CV_32FC2 (x,y) in the color image, infinity for invalid depth or points behind the color camera</param>
+		/// <param name="depth_scale">multiplied to the depth values to get the unit of the camera extrinsics</param>
+		void compute_color_coordinates(const cv::Mat& depth, cv::Mat& out_xy, double depth_scale = 1.0) const;
+
+		/// <summary>
+		/// find the color of every depth pixel, by projecting it into the color image and sampling there
+		/// </summary>
+		/// <param name="depth">CV_16UC1, CV_32FC1 or CV_64FC1 depth image of the depth camera size, 0 or non-finite depth is invalid</param>
+		/// <param name="color">the color image of the color camera size, uint8, uint16 or float with at most 4 channels</param>
+		/// <param name="out_color">color of the depth pixels with the type of the color image, invalid pixels are 0</param>
+		/// <param name="out_mask">if not null, CV_8UC1 mask which is 255 where the depth is valid and lands in the color image</param>
+		/// <param name="interpolation">cv::INTER_NEAREST or cv::INTER_LINEAR</param>
+		/// <param name="depth_scale">multiplied to the depth values to get the unit of the camera extrinsics</param>
+		/// <param name="out_xy">if not null, the color image coordinates like compute_color_coordinates()</param>
+		void register_color(const cv::Mat& depth, const cv::Mat& color, cv::Mat& out_color,
+			cv::Mat* out_mask = nullptr, int interpolation = cv::INTER_NEAREST,
+			double depth_scale = 1.0, cv::Mat* out_xy = nullptr) const;
+
+		/** \brief the color image coordinate of a single depth pixel, infinity if the depth is invalid or the point is behind the color camera */
+		fVECTOR_2 compute_color_coordinate(int x, int y, double depth) const;
+
+		/// <summary>
+		/// sample the color of every depth pixel through a precomputed coordinate map, like those given by depth sensors.
+		/// This does not need the cameras.
+		/// </summary>
+		/// <param name="depth2color_xy">CV_32FC2 (x,y) in the color image of every depth pixel, non-finite values are invalid</param>
+		/// <param name="color">the color image, uint8, uint16 or float with at most 4 channels</param>
+		/// <param name="out_color">color of the depth pixels with the type of the color image, invalid pixels are 0</param>
+		/// <param name="out_mask">if not null, CV_8UC1 mask which is 255 where the coordinate is valid and lands in the color image</param>
+		/// <param name="interpolation">cv::INTER_NEAREST or cv::INTER_LINEAR</param>
+		/// <param name="depth">if not null, the depth image, pixels with 0 or non-finite depth are invalid</param>
+		static void remap_color(const cv::Mat& depth2color_xy, const cv::Mat& color, cv::Mat& out_color,
+			cv::Mat* out_mask = nullptr, int interpolation = cv::INTER_NEAREST, const cv::Mat* depth = nullptr);
+
+		bool is_init() const { return m_dir_x.size() > 0; }
+		int get_width() const { return (int)m_dir_x.cols(); }
+		int get_height() const { return (int)m_dir_x.rows(); }
+		cv::Size get_color_size() const { return cv::Size(m_color_camera.get_image_width(), m_color_camera.get_image_height()); }
+
+		/** \brief the back projector of the depth camera, from which the color tables are built */
+		const DepthBackProjector& get_depth_rays() const { return m_depth_rays; }
+
+	protected:
+		//the point at depth z of depth pixel (i,j) is z*(dir_x, dir_y, dir_z)(i,j) + offset in color camera coordinate
+		MATRIX_f m_dir_x, m_dir_y, m_dir_z;
+		float m_offset[3] = { 0,0,0 };
+
+		//the color camera with identity extrinsic, which projects points in its own coordinate
+		CameraModel m_color_camera;
+
+		//the calibration of the tables
+		DepthBackProjector m_depth_rays;
+		fMATRIX_4 m_depth_extrinsic = fMATRIX_4::Zero();
+		fMATRIX_4 m_color_extrinsic = fMATRIX_4::Zero();
+	};
+}
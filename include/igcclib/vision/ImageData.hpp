@@ -28,42 +28,37 @@ namespace _NS_UTILITY
 
 		void convert_to(ImageData& output, ImageFormat to_format) const
 		{
-			static std::map<std::pair<ImageFormat, ImageFormat>, int> flagdict{
-				{ { ImageFormat::BGR, ImageFormat::BGRA }, cv::COLOR_BGR2BGRA },
-				{ { ImageFormat::BGR, ImageFormat::RGB }, cv::COLOR_BGR2RGB },
-				{ { ImageFormat::BGR, ImageFormat::RGBA }, cv::COLOR_BGR2RGBA },
-				{ { ImageFormat::BGR, ImageFormat::GRAY }, cv::COLOR_BGR2GRAY },
-
-				{ { ImageFormat::BGRA, ImageFormat::BGR }, cv::COLOR_BGRA2BGR },
-				{ { ImageFormat::BGRA, ImageFormat::RGB }, cv::COLOR_BGRA2RGB },
-				{ { ImageFormat::BGRA, ImageFormat::RGBA }, cv::COLOR_BGRA2RGBA },
-				{ { ImageFormat::BGRA, ImageFormat::GRAY }, cv::COLOR_BGRA2GRAY },
-
-				{ { ImageFormat::RGB, ImageFormat::BGR }, cv::COLOR_RGB2BGR },
-				{ { ImageFormat::RGB, ImageFormat::BGRA }, cv::COLOR_RGB2BGRA },
-				{ { ImageFormat::RGB, ImageFormat::RGBA }, cv::COLOR_RGB2RGBA },
-				{ { ImageFormat::RGB, ImageFormat::GRAY }, cv::COLOR_RGB2GRAY },
+			if (format == to_format) {
+				copy_to(output);
+				return;
+			}
 
-				{ { ImageFormat::RGBA, ImageFormat::BGR }, cv::COLOR_RGBA2BGR },
-				{ { ImageFormat::RGBA, ImageFormat::BGRA }, cv::COLOR_RGBA2BGRA },
-				{ { ImageFormat::RGBA, ImageFormat::RGB }, cv::COLOR_RGBA2RGB },
-				{ { ImageFormat::RGBA, ImageFormat::GRAY }, cv::COLOR_RGBA2GRAY },
+			int cvtcode = get_cvtcolor_code(format, to_format);
+			assert_throw(cvtcode >= 0, "unsupported image format conversion");
+			cv::cvtColor(this->data, output.data, cvtcode);
+			output.format = to_format;
+		}
 
-				{ { ImageFormat::GRAY, ImageFormat::BGR }, cv::COLOR_GRAY2BGR },
-				{ { ImageFormat::GRAY, ImageFormat::BGRA }, cv::COLOR_GRAY2BGRA },
-				{ { ImageFormat::GRAY, ImageFormat::RGB }, cv::COLOR_GRAY2RGB },
-				{ { ImageFormat::GRAY, ImageFormat::RGBA }, cv::COLOR_GRAY2RGBA },
+		/** \brief the cv::cvtColor code converting between two different formats, -1 if not supported */
+		static int get_cvtcolor_code(ImageFormat from_format, ImageFormat to_format)
+		{
+			//index by the integer values of ImageFormat, GRAY=1, RGB=2, RGBA=3, BGR=4, BGRA=5
+			static const int codes[5][5] = {
+				//to GRAY, RGB, RGBA, BGR, BGRA
+				{ -1, cv::COLOR_GRAY2RGB, cv::COLOR_GRAY2RGBA, cv::COLOR_GRAY2BGR, cv::COLOR_GRAY2BGRA },	//from GRAY
+				{ cv::COLOR_RGB2GRAY, -1, cv::COLOR_RGB2RGBA, cv::COLOR_RGB2BGR, cv::COLOR_RGB2BGRA },	//from RGB
+				{ cv::COLOR_RGBA2GRAY, cv::COLOR_RGBA2RGB, -1, cv::COLOR_RGBA2BGR, cv::COLOR_RGBA2BGRA },	//from RGBA
+				{ cv::COLOR_BGR2GRAY, cv::COLOR_BGR2RGB, cv::COLOR_BGR2RGBA, -1, cv::COLOR_BGR2BGRA },	//from BGR
+				{ cv::COLOR_BGRA2GRAY, cv::COLOR_BGRA2RGB, cv::COLOR_BGRA2RGBA, cv::COLOR_BGRA2BGR, -1 },	//from BGRA
 			};
 
-			if (format == to_format) {
-				copy_to(output);
-			}
-			else {
-				auto cvtcode = flagdict[{format, to_format}];
-				cv::cvtColor(this->data, output.data, cvtcode);
-				output.format = to_format;
-			}
+			int i = (int)from_format - 1;
+			int j = (int)to_format - 1;
+			if (i < 0 || i >= 5 || j < 0 || j >= 5)
+				return -1;
+			return codes[i][j];
 		}
+
 		bool is_empty() const {
 			return data.empty();
 		}
@@ -0,0 +1,96 @@
+#pragma once
+#include <vector>
+#include <igcclib/core/igcclib_eigen_def.hpp>
+#include <igcclib/vision/igcclib_opencv_def.hpp>
+
+namespace _NS_UTILITY
+{
+	/// <summary>
+	/// Warp many images of the same size by the same or a slowly changing transform, e.g. for video
+	/// stabilization. The source position of every output pixel is computed once and kept as fixed-point
+	/// remap grids, then each image is warped by cv::remap() without recomputing the transform. The grids
+	/// are kept if a new transform moves every output pixel by less than a tolerance, so small changes of
+	/// the rotation angle do not rebuild them.
+	/// </summary>
+	class IGCCLIB_API ImageWarper
+	{
+	public:
+		/// <summary>
+		/// build the remap grids of a transform
+		/// </summary>
+		/// <param name="transmat">the right-multiply transformation matrix from input to output pixels, treating every pixel
+		/// as (x,y,1) where x+ right, y+ down, the same as the output of rotate_image()</param>
+		/// <param name="input_width">size of the input images</param>
+		/// <param name="input_height">size of the input images</param>
+		/// <param name="output_width">size of the output images</param>
+		/// <param name="output_height">size of the output images</param>
+		/// <param name="interpolation">cv::INTER_NEAREST, cv::INTER_LINEAR, cv::INTER_CUBIC or cv::INTER_LANCZOS4</param>
+		/// <returns>whether the grids are rebuilt</returns>
+		bool init(const fMATRIX_3& transmat, int input_width, int input_height,
+			int output_width, int output_height, int interpolation = cv::INTER_LINEAR);
+
+		/// <summary>
+		/// build the remap grids of a rotation about the image center in counter-clockwise direction,
+		/// with the same output size and transform as rotate_image()
+		/// </summary>
+		/// <returns>whether the grids are rebuilt</returns>
+		bool init_rotation(double angle_rad, int width, int height, bool preserve_image_size = false,
+			int interpolation = cv::INTER_LINEAR);
+
+		/// <summary>
+		/// set the largest displacement in pixels of the source positions by which a new transform
+		/// keeps the current grids. By default it is half of the fixed-point resolution, so the grids are
+		/// kept only if they would not change.
+		/// </summary>
+		void set_tolerance(double pixels) { m_tolerance = pixels; }
+		double get_tolerance() const { return m_tolerance; }
+
+		/// <summary>
+		/// warp an image of the input size
+		/// </summary>
+		/// <param name="input">the input image of any type supported by cv::remap()</param>
+		/// <param name="output">the output image, whose memory is reused if it has the right size and type</param>
+		void apply(const cv::Mat& input, cv::Mat& output,
+			int border_mode = cv::BORDER_CONSTANT, const cv::Scalar& border_value = cv::Scalar()) const;
+
+		/// <summary>
+		/// warp a batch of frames in parallel, one frame per task. Outputs are reused like apply().
+		/// </summary>
+		void apply(const std::vector<cv::Mat>& inputs, std::vector<cv::Mat>& outputs,
+			int border_mode = cv::BORDER_CONSTANT, const cv::Scalar& border_value = cv::Scalar()) const;
+
+		/**
+		* \brief compute the transform of rotate_image()
+		*
+		* \param out_transmat the right-multiply transformation matrix from input to output pixels
+		* \param out_width the output image size
+		* \param out_height the output image size
+		*/
+		static void compute_rotation_transform(fMATRIX_3& out_transmat, int& out_width, int& out_height,
+			double angle_rad, int width, int height, bool preserve_image_size);
+
+		bool is_init() const { return !m_map_xy.empty(); }
+
+		/** \brief the transform from which the grids were built, which may differ from the last one within the tolerance */
+		const fMATRIX_3& get_transmat() const { return m_transmat; }
+		cv::Size get_input_size() const { return m_input_size; }
+		cv::Size get_output_size() const { return m_map_xy.size(); }
+		int get_interpolation() const { return m_interpolation; }
+
+	protected:
+		//the source position of an output pixel
+		fVECTOR_2 get_source_position(const fMATRIX_3& inv_transform, double x, double y) const;
+
+	protected:
+		//fixed-point grids in the format of cv::convertMaps(), the integer source position of each output
+		//pixel, and the fractional part as an index into the interpolation table, empty for nearest
+		cv::Mat m_map_xy;	//CV_16SC2
+		cv::Mat m_map_frac;	//CV_16UC1
+
+		fMATRIX_3 m_transmat = fMATRIX_3::Identity();
+		fMATRIX_3 m_inv_transform = fMATRIX_3::Identity();	//from output to input pixels, for column vectors
+		cv::Size m_input_size;
+		int m_interpolation = cv::INTER_LINEAR;
+		double m_tolerance = 0.5 / cv::INTER_TAB_SIZE;
+	};
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <vector>
+#include <boost/optional.hpp>
+#include <igcclib/vision/igcclib_opencv_def.hpp>
+
+namespace _NS_UTILITY
+{
+	/// <summary>
+	/// Multi-band blending of many images into one canvas. Each image is decomposed into a laplacian
+	/// pyramid, weighted by the gaussian pyramid of its weight map, and accumulated level by level.
+	/// The pyramids use the same filters as pyramid_down() and pyramid_up(), so blending two images
+	/// with weights w and 1-w gives the result of multi_band_blending().
+	/// The level buffers are kept in the object and reused as long as the canvas size does not change,
+	/// and the filtering and accumulation of every level is split into row tiles processed in parallel.
+	/// </summary>
+	class IGCCLIB_API MultiBandBlender
+	{
+	public:
+		/// <summary>
+		/// prepare the pyramid levels for a canvas, and clear the accumulated images.
+		/// The buffers are only reallocated if the size or the number of channels changes.
+		/// </summary>
+		/// <param name="size">size of the canvas, all images fed to the blender must have this size</param>
+		/// <param name="n_channel">number of channels of the images</param>
+		/// <param name="n_band">maximum number of bands including the low-pass residual, if not set, use as many as possible.</param>
+		/// <param name="sigma">the std variance of band filters, if not set, it is derived from the scale between levels.</param>
+		void init(cv::Size size, int n_channel,
+			boost::optional<int> n_band = boost::none,
+			boost::optional<double> sigma = boost::none);
+
+		/// <summary>
+		/// add an image to the canvas
+		/// </summary>
+		/// <param name="img">uint8, float or double image. Floating point colors are assumed to be in unit range.</param>
+		/// <param name="weight">single channel weight map of the same size, uint8 weights are divided by 255</param>
+		void feed(const cv::Mat& img, const cv::Mat& weight);
+
+		/// <summary>
+		/// collapse the accumulated pyramid into the blended image. Each level is normalized by the
+		/// accumulated weights, pixels with no weight become 0.
+		/// </summary>
+		/// <param name="output">the blended image, clamped to unit range before conversion</param>
+		/// <param name="output_type">opencv type of the output, if negative, use the type of the first fed image</param>
+		void blend(cv::Mat& output, int output_type = -1);
+
+		/** \brief clear the accumulated images, keeping the buffers */
+		void reset();
+
+		/// <summary>
+		/// paste img_src into img_dst by multi-band blending like multi_band_blending(), but process the
+		/// image in horizontal strips so that the pyramid memory is bounded by the strip size.
+		/// Each strip is blended with extra rows above and below it, and all strips are padded to the same
+		/// height, so one internal blender is allocated once and reused for every strip.
+		/// The result matches multi_band_blending() with the same n_band only if n_band is given and every strip
+		/// is tall enough to hold that many levels, where the margin covers the support of the coarse band filters.
+		/// If n_band is not given, each strip uses as many levels as its own height allows, which is fewer than
+		/// the full image, so the coarse bands differ.
+		/// </summary>
+		/// <param name="output">the output image, of the same type as img_src</param>
+		/// <param name="img_src">the source image</param>
+		/// <param name="img_dst">the destination image, of the same size and format as img_src</param>
+		/// <param name="weight_src">single channel weight of the source image</param>
+		/// <param name="strip_height">number of output rows of each strip</param>
+		/// <param name="margin">extra rows on each side of a strip, if negative, use half of the strip height</param>
+		/// <param name="n_band">number of bands, as in multi_band_blending()</param>
+		/// <param name="sigma">the std variance of band filters, as in multi_band_blending()</param>
+		static void blend_by_strips(cv::Mat& output,
+			const cv::Mat& img_src, const cv::Mat& img_dst, const cv::Mat& weight_src,
+			int strip_height, int margin = -1,
+			boost::optional<int> n_band = boost::none,
+			boost::optional<double> sigma = boost::none);
+
+		int get_num_levels() const { return (int)m_sizes.size(); }
+		cv::Size get_size() const { return m_sizes.empty() ? cv::Size() : m_sizes[0]; }
+		int get_num_channels() const { return m_n_channel; }
+
+	protected:
+		//blur of pyramid_down() from level i to i+1, and of pyramid_up() from level i+1 to i
+		double get_sigma_down(int i) const;
+		double get_sigma_up(int i) const;
+
+		//convert the input to float and build the weighted laplacian pyramid in the scratch buffers
+		void build_pyramids(const cv::Mat& img, const cv::Mat& weight);
+
+	protected:
+		boost::optional<int> m_n_band;
+		boost::optional<double> m_sigma;
+		int m_n_channel = 0;
+		int m_output_type = -1;
+
+		//size of each level, from fine to coarse
+		std::vector<cv::Size> m_sizes;
+
+		//accumulated weighted laplacian and accumulated weight of each level
+		std::vector<cv::Mat> m_accum;
+		std::vector<cv::Mat> m_weight_sum;
+
+		//scratch buffers, reused across feed() and blend()
+		std::vector<cv::Mat> m_gauss;		//gaussian pyramid of the image, then the laplacian in place
+		std::vector<cv::Mat> m_weight;		//gaussian pyramid of the weight
+		std::vector<cv::Mat> m_blur;		//blurred level before down sampling
+		std::vector<cv::Mat> m_wblur;		//blurred weight before down sampling
+		std::vector<cv::Mat> m_up_nearest;	//coarser level up sampled to this level
+		std::vector<cv::Mat> m_up;			//blurred up sampled level
+	};
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <functional>
+#include <igcclib/core/igcclib_eigen_def.hpp>
+#include <igcclib/vision/igcclib_opencv_def.hpp>
+
+namespace _NS_UTILITY
+{
+	/// <summary>
+	/// Draw markers, boxes and labels over many frames, e.g. debug overlays of a long capture. The marker
+	/// is rasterized once into a mask when the style is set, and stamped at every point, instead of drawing
+	/// its lines per point like draw_markers(). Batches of frames are rendered in parallel, one frame per task,
+	/// into buffers which are reused across batches and passed directly to a video writer or image files.
+	/// Colors are in unit range and scaled by 255, like draw_markers().
+	/// </summary>
+	class IGCCLIB_API OverlayRenderer
+	{
+	public:
+		/** \brief the annotations of one frame */
+		struct Annotation
+		{
+			fMATRIX points_xy;		//Nx2 marker positions
+			fMATRIX boxes_xywh;		//Mx4 boxes as (x,y,width,height)
+			std::vector<std::string> labels;	//label i is drawn above box i, or next to point i if there is no box
+		};
+
+		OverlayRenderer();
+
+		/** \brief marker type, size and line width follow cv::drawMarker() convention */
+		void set_marker_style(const fVECTOR_3& color3f, int marker_type = cv::MARKER_CROSS, int marker_size = 20, int line_width = 1);
+		void set_box_style(const fVECTOR_3& color3f, int line_width = 1);
+		void set_label_style(const fVECTOR_3& color3f, double font_scale = 0.5, int thickness = 1,
+			int font_face = cv::FONT_HERSHEY_SIMPLEX);
+
+		/** \brief draw the annotations onto the canvas */
+		void render(cv::Mat& canvas, const Annotation& annotation) const;
+
+		/** \brief draw the annotations of each frame onto the frame in parallel, without copying the frames */
+		void render(std::vector<cv::Mat>& frames, const std::vector<Annotation>& annotations) const;
+
+		/// <summary>
+		/// render the frames in batches into the reused buffers, and pass each rendered frame in order to a function
+		/// </summary>
+		/// <param name="frames">the input frames, which are not modified</param>
+		/// <param name="annotations">the annotations of each frame</param>
+		/// <param name="write_frame">called with the frame index and the rendered frame, which is only valid during the call</param>
+		/// <param name="batch_size">number of frames rendered in parallel, if 0, use twice the number of threads</param>
+		void render(const std::vector<cv::Mat>& frames, const std::vector<Annotation>& annotations,
+			const std::function<void(size_t, const cv::Mat&)>& write_frame, size_t batch_size = 0);
+
+		/** \brief render the frames and write them to an opened video writer */
+		void render_to_video(cv::VideoWriter& writer, const std::vector<cv::Mat>& frames,
+			const std::vector<Annotation>& annotations, size_t batch_size = 0);
+
+		/** \brief render the frames and write them to image files, one file per frame */
+		void render_to_files(const std::vector<std::string>& filenames, const std::vector<cv::Mat>& frames,
+			const std::vector<Annotation>& annotations, size_t batch_size = 0);
+
+	protected:
+		//stamp the marker mask centered at every point
+		void draw_marker_stamps(cv::Mat& canvas, const fMATRIX& pts_xy) const;
+
+	protected:
+		cv::Scalar m_marker_color = cv::Scalar(0, 255, 0);
+		cv::Mat m_marker_mask;		//CV_8UC1, the marker drawn at its center
+		int m_marker_size = 20;
+		cv::Scalar m_box_color = cv::Scalar(0, 255, 0);
+		int m_box_line_width = 1;
+		cv::Scalar m_label_color = cv::Scalar(255, 255, 255);
+		double m_font_scale = 0.5;
+		int m_font_thickness = 1;
+		int m_font_face = cv::FONT_HERSHEY_SIMPLEX;
+		int m_text_height = 0;
+
+		std::vector<cv::Mat> m_buffers;
+	};
+}
@@ -1,18 +1,37 @@
 #pragma once
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <igcclib/vision/igcclib_opencv_def.hpp>
 
 namespace _NS_UTILITY
 {
+	/*!
+	 * \class VideoReader
+	 *
+	 * \brief read frames from a video file. By default, frames are decoded on demand in the calling thread.
+	 With prefetching, a background thread decodes ahead of the last read frame into a ring of preallocated
+	 frames, and keeps some frames behind it, so sequential reading and stepping back and forth near the
+	 current frame do not wait for the decoder. Random access outside of the ring seeks to the nearest
+	 keyframe at or before the target and decodes forward, or just decodes forward if the target is close ahead.
+	 The reader is meant to be used by one thread.
+	 */
 	class VideoReader
 	{
 	public:
 		/** \brief initialize video reader from a file. The codec is recognized by file extension.
+		If n_prefetch > 0, build the keyframe index and start decoding in the background, keeping at most n_prefetch frames.
 		Return whether the operation is successful. */
-		bool init_from_file(const std::string filename);
+		bool init_from_file(const std::string filename, size_t n_prefetch = 0);
 
 		/** \brief initialize video reader from a file already read into the memory */
 		// void init_from_data(const char* data);
 
+		/** \brief stop the background decoding and close the video */
+		void close();
+
 		/** \brief get the number of frames */
 		size_t get_num_frames() const;
 
@@ -28,7 +47,7 @@ namespace _NS_UTILITY
 		/** \brief read a specific frame. */
 		bool read_frame_by_index(size_t n, cv::Mat* output);
 
-		/** \brief read frame by a timestamp in seconds */
+		/** \brief read frame by a timestamp in seconds. With prefetching, the frame is found by the frame rate. */
 		bool read_frame_by_time(double t_sec, cv::Mat* output);
 
 		int get_frame_width() const;
@@ -40,10 +59,63 @@ namespace _NS_UTILITY
 		/** \brief get the index of the frame last read */
 		size_t get_current_frame_index() const;
 
-		virtual ~VideoReader() {}
+		/** \brief is the background decoding running */
+		bool is_prefetching() const { return m_decode_thread != nullptr; }
+
+		/** \brief sorted indices of the keyframes, empty if the index is not built or the backend cannot tell keyframes */
+		const std::vector<size_t>& get_keyframe_indices() const { return m_keyframes; }
+
+		VideoReader() {}
+		VideoReader(const VideoReader&) = delete;
+		VideoReader& operator=(const VideoReader&) = delete;
+		virtual ~VideoReader();
+
+	protected:
+		struct BufferedFrame
+		{
+			cv::Mat image;
+			int64_t index = -1;		//-1 if the slot is empty or being decoded
+			double time_ms = 0;
+		};
+
+		//demux the file without decoding to find the keyframes
+		void build_keyframe_index(const std::string& filename);
+
+		//the decoding thread
+		void decode_loop();
+
+		//move the decoder from frame cur to frame target, called in the decoding thread only
+		bool seek_decoder(int64_t cur, int64_t target);
+
+		//read frame n through the ring, asking the decoder to seek if needed
+		bool read_prefetched(size_t n, cv::Mat* output);
+
+		//number of frames the decoder may go beyond the next frame to read
+		int64_t get_num_ahead() const { return (int64_t)(m_ring.size() - m_ring.size() / 4); }
 
 	protected:
 		cv::VideoCapture m_video;
-		size_t m_frame_index = 0;
+		size_t m_frame_index = 0;	//with prefetching, the next frame to read
+
+		//properties read when the video is opened
+		size_t m_num_frames = 0;
+		double m_fps = 0;
+		int m_width = 0;
+		int m_height = 0;
+
+		std::vector<size_t> m_keyframes;
+
+		//background decoding, frame k is kept in slot k % ring size.
+		//the ring and the decoder state are guarded by the mutex.
+		std::shared_ptr<std::thread> m_decode_thread;
+		std::mutex m_mutex;
+		std::condition_variable m_cv_decoder;	//wakes the decoder when there is space, a seek or stopping
+		std::condition_variable m_cv_reader;	//wakes the reader when a frame is decoded or a seek is done
+		std::vector<BufferedFrame> m_ring;
+		int64_t m_decode_next = 0;		//the frame the decoder will read next
+		int64_t m_seek_target = -1;		//requested seek, -1 if none
+		int64_t m_end = -1;				//the frame at which the decoder failed, -1 if it has not failed
+		bool m_stop = false;
+		double m_last_time_ms = 0;
 	};
-}
\ No newline at end of file
+}
@@ -3,49 +3,29 @@
 
 #include <igcclib/igcclib_master.hpp>
 #include <igcclib/core/igcclib_eigen.hpp>
+#include <igcclib/core/ImageResizer.hpp>
 #include <igcclib/vision/igcclib_opencv_eigen.hpp>
 #include <igcclib/vision/igcclib_opencv.hpp>
 
 namespace _NS_UTILITY
 {
 	/// <summary>
-	/// resize an image
+	/// resize an image bilinearly, like cv::resize() with cv::INTER_LINEAR. The filters are computed in every call,
+	/// to resize many images of the same size, keep an ImageResizer instead.
 	/// </summary>
 	/// <param name="input">the input image</param>
-	/// <param name="output">the output image</param>
+	/// <param name="output">the output image, which can be the input</param>
 	/// <param name="width">the target image width</param>
 	/// <param name="height">the target image height</param>
 	template<typename T>
 	void IGCCLIB_API resize_image(const ImageRGBA_t<T>& input, ImageRGBA_t<T>& output, int width, int height)
 	{
 		using namespace _NS_UTILITY;
-		int n_ch = input.get_number_of_channels();
-		bool is_inout = &input == &output;
-
-		if (is_inout)
-		{
-			//input and output uses the same object, we need temporary object
-			ImageRGBA_t<T> tmp;
-			tmp.allocate(width, height, n_ch);
-			for (int i = 0; i < n_ch; i++)
-			{
-				cv::Mat cv_img(input.get_height(), input.get_width(), cv::DataType<T>::type, const_cast<T*>(input.get_channel(i).data()));
-				cv::Mat _output(height, width, cv::DataType<T>::type, tmp.get_channel(i).data());
-				cv::resize(cv_img, _output, cv::Size(width, height));
-			}
-			output = tmp;
-		}
-		else
-		{
-			//directly write to output
-			output.allocate(width, height, n_ch);
-			for (int i = 0; i < n_ch; i++)
-			{
-				cv::Mat cv_img(input.get_height(), input.get_width(), cv::DataType<T>::type, const_cast<T*>(input.get_channel(i).data()));
-				cv::Mat _output(height, width, cv::DataType<T>::type, output.get_channel(i).data());
-				cv::resize(cv_img, _output, cv::Size(width, height));
-			}
-		}
+
+		//the resizer reads the whole input before writing the output, so they can be the same object
+		ImageResizer resizer;
+		resizer.init(input.get_width(), input.get_height(), width, height, ImageResizer::Method::BILINEAR);
+		resizer.resize(input, output);
 	}
 
 	/// <summary>
@@ -91,6 +71,56 @@ namespace _NS_UTILITY
 	IGCCLIB_API void imwrite(const std::string filename, const cv::Mat& image,
 		ImageFormat format = ImageFormat::NONE);
 
+	namespace _ImageProcessing {
+		/// <summary>
+		/// distance transform of a CV_8UC1 mask where non zeros are empty space. When D is float,
+		/// opencv writes directly into the output matrix, otherwise the distance is converted once.
+		/// </summary>
+		template<typename D>
+		void distance_transform_u8(const cv::Mat& empty_space_mask, MATRIX_t<D>& output) {
+			output.resize(empty_space_mask.rows, empty_space_mask.cols);
+			if (std::is_same<D, float>::value) {
+				cv::Mat distmap(empty_space_mask.rows, empty_space_mask.cols, CV_32F, (void*)output.data());
+				cv::distanceTransform(empty_space_mask, distmap, cv::DIST_L2, cv::DIST_MASK_PRECISE, CV_32F);
+			}
+			else {
+				cv::Mat distmap;
+				cv::distanceTransform(empty_space_mask, distmap, cv::DIST_L2, cv::DIST_MASK_PRECISE, CV_32F);
+				output = Eigen::Map<MATRIX_f>((float*)distmap.data, distmap.rows, distmap.cols).template cast<D>();
+			}
+		}
+
+		/** \brief distance transform with labels of a CV_8UC1 mask where non zeros are empty space */
+		template<typename D>
+		void distance_transform_u8(const cv::Mat& empty_space_mask, MATRIX_t<D>& output_distance, iMATRIX& output_labels) {
+			//compute distance transform
+			cv::Mat distmap, lbmap;
+			cv::distanceTransform(empty_space_mask, distmap, lbmap, cv::DIST_L2, cv::DIST_MASK_PRECISE, cv::DIST_LABEL_PIXEL);
+
+			//find all obstacle pixels and assign a linear index to each
+			std::vector<int> pixel_index;
+			for (int i = 0; i < empty_space_mask.rows; i++) {
+				const uint8_t* p = empty_space_mask.ptr<uint8_t>(i);
+				for (int j = 0; j < empty_space_mask.cols; j++)
+					if (!p[j])
+						pixel_index.push_back(i * empty_space_mask.cols + j);
+			}
+
+			//convert the labels into pixel indices while writing the output, in parallel over rows
+			output_labels.resize(lbmap.rows, lbmap.cols);
+			cv::parallel_for_(cv::Range(0, lbmap.rows), [&](const cv::Range& range) {
+				for (int i = range.start; i < range.end; i++) {
+					const int32_t* lb = lbmap.ptr<int32_t>(i);
+					for (int j = 0; j < lbmap.cols; j++)
+						output_labels(i, j) = pixel_index[lb[j] - 1];
+				}
+			});
+
+			//output
+			output_distance = Eigen::Map<MATRIX_f>((float*)distmap.data, distmap.rows, distmap.cols).template cast<D>();
+		}
+	}
+
 	/// <summary>
 	/// perform distance transform. By default, 0 is obstacle and 1 is empty space.	
 	/// </summary>
@@ -110,13 +140,7 @@ namespace _NS_UTILITY
 		//wrap as opencv mat
 		cv::Mat _mask(empty_space_mask.rows(), empty_space_mask.cols(), 
 			CV_8UC1, empty_space_mask.data());
-
-		//compute distance transform
-		cv::Mat distmap;
-		cv::distanceTransform(_mask, distmap, cv::DIST_L2, cv::DIST_MASK_PRECISE, CV_32F);
-
-		//output
-		output = Eigen::Map<MATRIX_f>((float*)distmap.data, distmap.rows, distmap.cols).template cast<D>();
+		_ImageProcessing::distance_transform_u8(_mask, output);
 	}
 
 	/**
@@ -140,24 +164,7 @@ namespace _NS_UTILITY
 		//wrap as opencv mat
 		cv::Mat _mask(empty_space_mask.rows(), empty_space_mask.cols(),
 			CV_8UC1, empty_space_mask.data());
-
-		//compute distance transform
-		cv::Mat distmap, lbmap;
-		cv::distanceTransform(_mask, distmap, lbmap, cv::DIST_L2, cv::DIST_MASK_PRECISE, cv::DIST_LABEL_PIXEL);
-
-		//find all obstacle pixels and assign a linear index to each
-		std::vector<int> pixel_index;
-		for (int i = 0; i < _mask.total(); i++)
-			if (!_mask.data[i])
-				pixel_index.push_back(i);
-
-		lbmap.forEach<int32_t>(
-			[&](int32_t& pixel, const int* position) {pixel = pixel_index[pixel-1]; }
-		);
-
-		//output
-		output_distance = Eigen::Map<MATRIX_f>((float*)distmap.data, distmap.rows, distmap.cols).template cast<D>();
-		output_labels = Eigen::Map<iMATRIX>((int32_t*)lbmap.data, lbmap.rows, lbmap.cols).template cast<int_type>();
+		_ImageProcessing::distance_transform_u8(_mask, output_distance, output_labels);
 	}
 
 	/// <summary>
@@ -168,16 +175,44 @@ namespace _NS_UTILITY
 	/// <param name="zero_as_empty_space">if true, 0 is empty space and 1 is obstacle.</param>
 	template<typename T>
 	void IGCCLIB_API distance_transform(const cv::Mat& mask, MATRIX_t<T>& output, bool zero_as_empty_space = false) {
-		cv::Mat _mask = mask != 0;
-		MATRIX_u8 emask = Eigen::Map<MATRIX_u8>(_mask.data, _mask.rows, _mask.cols);
-		distance_transform(emask, output, zero_as_empty_space);
+		cv::Mat _mask = zero_as_empty_space ? (mask == 0) : (mask != 0);
+		_ImageProcessing::distance_transform_u8(_mask, output);
 	}
 
 	template<typename T>
 	void IGCCLIB_API distance_transform(const cv::Mat& mask, MATRIX_t<T>& output_distance, iMATRIX& output_labels, bool zero_as_empty_space = false) {
-		cv::Mat _mask = mask != 0;
-		MATRIX_u8 emask = Eigen::Map<MATRIX_u8>(_mask.data, _mask.rows, _mask.cols);
-		distance_transform(emask, output_distance, output_labels, zero_as_empty_space);
+		cv::Mat _mask = zero_as_empty_space ? (mask == 0) : (mask != 0);
+		_ImageProcessing::distance_transform_u8(_mask, output_distance, output_labels);
+	}
+
+	/// <summary>
+	/// distance transform of a large mask, processed in horizontal strips in parallel, so that
+	/// the working memory is bounded by the strip size. Each strip is extended by max_distance rows
+	/// on both sides, so distances up to max_distance are exact, larger distances are clamped to max_distance.
+	/// By default, 0 is obstacle and non zero is empty space.
+	/// </summary>
+	/// <param name="mask">single channel mask</param>
+	/// <param name="output">CV_32FC1 distance map</param>
+	/// <param name="max_distance">the distance beyond which the values are clamped</param>
+	/// <param name="zero_as_empty_space">if true, 0 is empty space and non zero is obstacle.</param>
+	/// <param name="strip_height">number of output rows of each strip</param>
+	IGCCLIB_API void distance_transform_tiled(const cv::Mat& mask, cv::Mat& output, double max_distance,
+		bool zero_as_empty_space = false, int strip_height = 512);
+
+	/** \brief tiled distance transform into a matrix, written in place when T is float */
+	template<typename T>
+	void IGCCLIB_API distance_transform_tiled(const cv::Mat& mask, MATRIX_t<T>& output, double max_distance,
+		bool zero_as_empty_space = false, int strip_height = 512) {
+		if (std::is_same<T, float>::value) {
+			output.resize(mask.rows, mask.cols);
+			cv::Mat distmap(mask.rows, mask.cols, CV_32F, (void*)output.data());
+			distance_transform_tiled(mask, distmap, max_distance, zero_as_empty_space, strip_height);
+		}
+		else {
+			cv::Mat distmap;
+			distance_transform_tiled(mask, distmap, max_distance, zero_as_empty_space, strip_height);
+			output = Eigen::Map<MATRIX_f>((float*)distmap.data, distmap.rows, distmap.cols).template cast<T>();
+		}
 	}
 
 	/// <summary>
@@ -206,13 +241,28 @@ namespace _NS_UTILITY
 
 	/**
 	* \brief find the largest connected component in input, and write it to output.
+	If several components have the largest size, the one found first in scan order is kept.
 	*
 	* \param input	the input single-channel image, where nonzero pixels are foreground
-	* \param output	output CV_8UC1 mask of the largest connected component
+	* \param output	output CV_8UC1 mask of the largest connected component, all zeros if there is no foreground
 	* \param connectivity	8 or 4 connnected
 	*/
 	IGCCLIB_API void get_largest_connected_component(const cv::Mat& input, cv::Mat* output, int connectivity = 8);
 
+	/**
+	* \brief find the largest connected component of a large image, processed in horizontal strips.
+	The strips are labeled in parallel and the components crossing strip borders are merged,
+	so the result is the same as get_largest_connected_component() while the label maps
+	are only kept for the strips being processed.
+	*
+	* \param input	the input single-channel image, where nonzero pixels are foreground
+	* \param output	output CV_8UC1 mask of the largest connected component
+	* \param connectivity	8 or 4 connnected
+	* \param strip_height	number of rows of each strip
+	*/
+	IGCCLIB_API void get_largest_connected_component_tiled(const cv::Mat& input, cv::Mat* output,
+		int connectivity = 8, int strip_height = 1024);
+
 	/// <summary>
 	/// upscale an image and then smooth it
 	/// </summary>
@@ -256,7 +306,8 @@ namespace _NS_UTILITY
 		boost::optional<double> sigma = boost::none);
 
 	/**
-	* \brief rotate the input image about its center, by a specified angle in counter-clockwise direction
+	* \brief rotate the input image about its center, by a specified angle in counter-clockwise direction.
+	To rotate many images of the same size, use ImageWarper which keeps the remap grids.
 	*
 	* \param output the output image
 	* \param out_transmat the right-multiply transformation matrix that is used to transform the input image, 
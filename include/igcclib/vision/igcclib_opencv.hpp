@@ -21,7 +21,8 @@ namespace _NS_UTILITY {
 	IGCCLIB_API fMATRIX_4 find_camera_extrinsic(const fMATRIX& pts_3d, const fMATRIX& pts_2d, const fMATRIX_3& projection_matrix);
 
 	/** \brief draw markers in an image,
-	The marker type, size and line width follows cv::drawMarkers convention.*/
+	The marker type, size and line width follows cv::drawMarkers convention.
+	To annotate many frames, use OverlayRenderer.*/
 	IGCCLIB_API void draw_markers(
 		cv::Mat& canvas, const fMATRIX& pts_xy,
 		const fVECTOR_3& color3f, 
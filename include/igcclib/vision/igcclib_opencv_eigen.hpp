@@ -26,6 +26,16 @@ namespace _NS_UTILITY
 	template<typename T>
 	IGCCLIB_API void to_matrix(const std::vector<cv::KeyPoint>& kps, MATRIX_t<T>& dst);
 
+	/// <summary>
+	/// wrap an opencv image of 1 to 4 channels as an interleaved image view, sharing the internal data.
+	/// The depth of the image must match T.
+	/// </summary>
+	template<typename T>
+	IGCCLIB_API ImageView_t<T> make_image_view(cv::Mat& img);
+
+	template<typename T>
+	IGCCLIB_API ImageView_t<const T> make_image_view(const cv::Mat& img);
+
 	/** \brief convert eigen image to opencv image */
 	template<typename T>
 	IGCCLIB_API void to_opencv_image(const ImageRGBA_t<T>& img, cv::Mat& output, bool keep_float = false);
@@ -142,6 +152,20 @@ namespace _NS_UTILITY
 		}
 	}
 
+	template<typename T>
+	ImageView_t<T> make_image_view(cv::Mat& img)
+	{
+		assert_throw(img.depth() == cv::DataType<T>::depth, "image depth does not match the view type");
+		assert_throw(img.dims == 2 && img.step[1] == img.elemSize(), "only 2d images with packed pixels are supported");
+		return ImageView_t<T>::from_interleaved((T*)img.data, img.cols, img.rows, img.channels(), (ptrdiff_t)(img.step[0] / sizeof(T)));
+	}
+
+	template<typename T>
+	ImageView_t<const T> make_image_view(const cv::Mat& img)
+	{
+		return make_image_view<T>(const_cast<cv::Mat&>(img));
+	}
+
 	//convert eigen image to opencv image
 	template<typename T>
 	void to_opencv_image(const ImageRGBA_t<T>& img, cv::Mat& output, bool keep_float)
@@ -149,38 +173,28 @@ namespace _NS_UTILITY
 		bool is_float_image = std::is_same<T, float>::value || std::is_same<T, double>::value;
 		int height = img.get_height();
 		int width = img.get_width();
+		if (img.is_empty())
+		{
+			output.release();
+			return;
+		}
 
+		//gray image only keeps the gray channel
+		auto src = img.get_view();
 		if (img.is_gray())
+			src = src.get_channel(0);
+		int nch = src.get_number_of_channels();
+
+		//copy the planes into the interleaved opencv buffer directly
+		if (is_float_image && !keep_float)
 		{
-			to_matrix(img.r, output);
-			if (is_float_image && !keep_float)
-			{
-				cv::Mat tmp;
-				output.convertTo(tmp, CV_8UC1, 255);
-				output = tmp;
-			}
+			output.create(height, width, CV_8UC(nch));
+			copy_image_view(src, make_image_view<uint8_t>(output), 255.0);
 		}
-		else //RGB or RGBA image
+		else
 		{
-			std::vector<cv::Mat> chlist(3);
-			to_matrix(img.r, chlist[0]);
-			to_matrix(img.g, chlist[1]);
-			to_matrix(img.b, chlist[2]);
-			if (img.has_alpha())
-			{
-				cv::Mat x;
-				to_matrix(img.a, x);
-				chlist.push_back(x);
-			}
-			cv::merge(chlist, output);
-
-			if (is_float_image && !keep_float)
-			{
-				cv::Mat tmp;
-				int cvtype = chlist.size() == 3 ? CV_8UC3 : CV_8UC4;
-				output.convertTo(tmp, cvtype, 255);
-				output = tmp;
-			}
+			output.create(height, width, CV_MAKETYPE(cv::DataType<T>::depth, nch));
+			copy_image_view(src, make_image_view<T>(output));
 		}
 	}
 
@@ -196,42 +210,29 @@ namespace _NS_UTILITY
 
 		assert_throw(is_integer_image || is_float_image, "only supports images containing 1,3,4 channels");
 
-		//single channel image?
-		if (img.channels() == 1)
-		{
-			MATRIX_t<T> mat;
-			to_matrix(img, mat);
-
-			if(is_integer_image && is_output_float)
-				mat /= 255;
-			
-			if (is_float_image && !is_output_float)
-				mat *= 255;
-
-			output.set_gray(mat);
-		}
-		else //RGB or RGBA
-		{
-			std::vector<cv::Mat> chlist;
-			cv::split(img, chlist);
-			
-			std::vector<MATRIX_t<T>> matlist(chlist.size());
-			for (int i = 0; i < chlist.size(); i++)
-			{
-				auto& mat = matlist[i];
-
-				to_matrix(chlist[i], mat);
-				if (is_integer_image && is_output_float)
-					mat /= 255;
-
-				if (is_float_image && !is_output_float)
-					mat *= 255;
-			}
-
-			if (chlist.size() == 3)
-				output.set_RGB(matlist[0], matlist[1], matlist[2]);
-			if (chlist.size() == 4)
-				output.set_RGBA(matlist[0], matlist[1], matlist[2], matlist[3]);
+		double scale = 1.0;
+		if (is_integer_image && is_output_float)
+			scale = 1.0 / 255;
+		if (is_float_image && !is_output_float)
+			scale = 255.0;
+
+		//single channel image becomes gray, the unused channels are emptied
+		int nch = img.channels();
+		output.allocate(img.cols, img.rows, nch);
+		for (int i = nch; i < 4; i++)
+			output.get_channel(i).resize(0, 0);
+
+		//deinterleave from the opencv buffer directly into the planes
+		auto dst = output.get_view();
+		switch (img.depth()) {
+		case CV_8U:
+			copy_image_view(make_image_view<uint8_t>(img), dst, scale);
+			break;
+		case CV_32F:
+			copy_image_view(make_image_view<float>(img), dst, scale);
+			break;
+		default:
+			copy_image_view(make_image_view<double>(img), dst, scale);
 		}
 	}
 
@@ -1,3 +1,4 @@
+#include <cmath>
 #include <igcclib/device/DefaultFrameReader.hpp>
 #include <igcclib/vision/igcclib_opencv_eigen.hpp>
 
@@ -23,12 +24,18 @@ namespace _NS_UTILITY
 		if (!m_data)
 			return false;
 
+		//without the coordinate map, use the registration of the cameras
+		const DepthColorRegistration* reg = nullptr;
 		if (m_depth2image_xy.empty())
-			return false;
+		{
+			reg = get_registration();
+			if (!reg)
+				return false;
+		}
 		auto x = depth_xy[0];
 		auto y = depth_xy[1];
 
-		auto dmap = m_depth_image;
+		const cv::Mat& dmap = m_depth_image;
 
 		//coordinate in range?
 		if (x < 0 || x >= dmap.cols || y < 0 || y >= dmap.rows)
@@ -38,12 +45,16 @@ namespace _NS_UTILITY
 			return false;
 		else
 		{
-			auto xy = m_depth2image_xy.at<cv::Vec2f>(y, x);
-			if (out_color_xy)
+			fVECTOR_2 xy;
+			if (reg)
+				xy = reg->compute_color_coordinate((int)x, (int)y, dmap.at<DepthValue_t>(y, x));
+			else
 			{
-				out_color_xy->x() = xy[0];
-				out_color_xy->y() = xy[1];
+				auto v = m_depth2image_xy.at<cv::Vec2f>(y, x);
+				xy = fVECTOR_2(v[0], v[1]);
 			}
+			if (out_color_xy)
+				*out_color_xy = xy;
 			return true;
 		}
 	}
@@ -53,15 +64,25 @@ namespace _NS_UTILITY
 		if (!m_data)
 			return false;
 
-		if (out_depth2color_xy && m_depth2image_xy.empty())
-			return false;
 		if (out_mask && m_depth_image.empty())
 			return false;
 
 		if (out_depth2color_xy)
-			m_depth2image_xy.copyTo(*out_depth2color_xy);
+		{
+			if (!m_depth2image_xy.empty())
+				*out_depth2color_xy = m_depth2image_xy;
+			else
+			{
+				const DepthColorRegistration* reg = get_registration();
+				if (!reg)
+					return false;
+				reg->compute_color_coordinates(m_depth_image, *out_depth2color_xy);
+			}
+		}
+
+		//compare() reuses the mask buffer
 		if (out_mask)
-			* out_mask = m_depth_image != 0;
+			cv::compare(m_depth_image, INVALID_DEPTH_VALUE, *out_mask, cv::CMP_NE);
 		return true;
 	}
 
@@ -76,59 +97,45 @@ namespace _NS_UTILITY
 		if (!out_color_value)
 			return true;
 
+		auto x = depth_xy[0];
+		auto y = depth_xy[1];
+
 		//check depth validity if we have depth map
 		if (!m_depth_image.empty())
 		{
-			auto x = depth_xy[0];
-			auto y = depth_xy[1];
 			if (x < 0 || x >= m_depth_image.cols || y < 0 || y >= m_depth_image.rows)
 				return false;
 			if (m_depth_image.at<DepthValue_t>(y, x) == INVALID_DEPTH_VALUE)
 				return false;
 		}
 
-		iVECTOR_4 x{ 0,0,0,0 };
-
 		//do we have the mapping?
-		if (!m_depth2color.empty())
+		const cv::Mat* src = &m_depth2color;
+		int i = (int)y;
+		int j = (int)x;
+		if (m_depth2color.empty())
 		{
-			auto i = depth_xy[1];
-			auto j = depth_xy[0];
-
-			//check range
-			if (i < 0 || i >= m_depth2color.rows || j < 0 || j >= m_depth2color.cols)
-				return false;
-
-			//in default reader, we just copy the color value
-			auto p = m_depth2color.data + (i * m_depth2color.cols + j) * m_depth2color.channels();
-			for (int k = 0; k < m_depth2color.channels(); k++)
-				x[k] = p[k];
-		}
-		else
-		{
-			if (m_color_image.empty())
-				return false;
-
-			//read data from the coordinate map
+			//read data from the coordinate map, without going through the virtual interface
 			fVECTOR_2 color_xy;
-			bool ok = get_color_coordinate_for_depth(&color_xy, depth_xy);
-			if (!ok)
+			bool ok = DefaultFrameReader::get_color_coordinate_for_depth(&color_xy, depth_xy);
+			if (!ok || !std::isfinite(color_xy[0]) || !std::isfinite(color_xy[1]))
 				return false;
+			src = &m_color_image;
+			i = cvRound(color_xy[1]);
+			j = cvRound(color_xy[0]);
+		}
 
-			int i = (int)color_xy[1];
-			int j = (int)color_xy[0];
-
-			//check range
-			if (i < 0 || i >= m_color_image.rows || j < 0 || j >= m_color_image.cols)
-				return false;
+		//check range
+		if (i < 0 || i >= src->rows || j < 0 || j >= src->cols)
+			return false;
 
-			//read
-			auto p = m_color_image.data + (i * m_color_image.cols + j) * m_color_image.channels();
-			for (int k = 0; k < m_color_image.channels(); k++)
-				x[k] = p[k];
-		}
+		//in default reader, we just copy the color value
+		iVECTOR_4 value{ 0,0,0,0 };
+		auto p = src->ptr<uint8_t>(i) + j * src->channels();
+		for (int k = 0; k < src->channels(); k++)
+			value[k] = p[k];
 
-		*out_color_value = x;
+		*out_color_value = value;
 		return true;
 	}
 
@@ -137,56 +144,63 @@ namespace _NS_UTILITY
 		if (!m_data)
 			return false;
 
-		if (m_depth2color.empty() && m_depth2image_xy.empty())
-			return false;
-
 		if (m_depth_image.empty() || m_color_image.empty())
 			return false;
 
-		if (out_mask)
-			* out_mask = m_depth_image != INVALID_DEPTH_VALUE;
+		//the device gives the colors already
+		if (!m_depth2color.empty())
+		{
+			if (out_depth2color)
+				*out_depth2color = m_depth2color;
+			if (out_mask)
+				cv::compare(m_depth_image, INVALID_DEPTH_VALUE, *out_mask, cv::CMP_NE);
+			return true;
+		}
 
-		if (out_depth2color)
+		const DepthColorRegistration* reg = nullptr;
+		if (m_depth2image_xy.empty())
 		{
-			if (!m_depth2color.empty())
-				m_depth2color.copyTo(*out_depth2color);
-			else
-			{
-				out_depth2color->create(m_depth_image.rows, m_depth_image.cols, m_color_image.type());
-				out_depth2color->setTo(cv::Scalar::all(0));
-
-#pragma omp parallel for
-				for(int ii=0; ii<m_depth_image.rows; ii++)
-					for (int jj = 0; jj < m_depth_image.cols; jj++)
-					{
-						auto p = m_depth2image_xy.at<cv::Vec2f>(ii, jj);
-						int x = (int)p[0];
-						int y = (int)p[1];
-
-						if(x == INVALID_FLOAT32_VALUE || y == INVALID_FLOAT32_VALUE)
-							continue;
-
-						auto write = out_depth2color->data + (ii * out_depth2color->cols + jj) * out_depth2color->channels();
-						
-						if (x >= 0 && x < m_color_image.cols && y >= 0 && y < m_color_image.rows)
-						{
-							auto read = m_color_image.data + (y * m_color_image.cols + x) * m_color_image.channels();
-							memcpy(write, read, m_color_image.channels());
-
-							if (out_mask)
-								out_mask->at<uint8_t>(ii, jj) = 255;
-						}
-						else
-						{
-							if (out_mask)
-								out_mask->at<uint8_t>(ii, jj) = 0;
-						}
-					}
-			}
+			reg = get_registration();
+			if (!reg)
+				return false;
 		}
+
+		if (!out_depth2color && !out_mask)
+			return true;
+
+		//sample the color image in one pass, the output buffer is reused if it has the right size and type
+		cv::Mat _output;
+		cv::Mat& output = out_depth2color ? *out_depth2color : _output;
+		if (reg)
+			reg->register_color(m_depth_image, m_color_image, output, out_mask);
+		else
+			DepthColorRegistration::remap_color(m_depth2image_xy, m_color_image, output, out_mask,
+				cv::INTER_NEAREST, &m_depth_image);
 		return true;
 	}
 
+	void DefaultFrameReader::update_registration()
+	{
+		m_has_registration = false;
+		CameraModel depth_camera;
+		m_has_depth_rays = get_depth_projection_camera(&depth_camera);
+		if (!m_has_depth_rays)
+			return;
+
+		CameraModel color_camera = get_color_camera();
+		bool has_color_camera = !m_color_image.empty() && !color_camera.is_orthographic()
+			&& color_camera.get_projection_matrix()(0, 0) != 0;
+		if (!has_color_camera)
+		{
+			m_registration.init_depth_rays(depth_camera);
+			return;
+		}
+
+		color_camera.set_image_size(m_color_image.cols, m_color_image.rows);
+		m_registration.init(depth_camera, color_camera);
+		m_has_registration = true;
+	}
+
 	CameraModel DefaultFrameReader::get_depth_camera() const
 	{
 		CameraModel output;
@@ -214,22 +228,33 @@ namespace _NS_UTILITY
 
 	bool DefaultFrameReader::get_depth_3d_point(fVECTOR_3* out_point, const iVECTOR_2& depth_xy) const
 	{
-		assert_throw(!m_depth2xyz.empty() && !m_depth_image.empty(), "depth2xyz is empty or depth map is empty");
+		assert_throw(!m_depth_image.empty(), "depth map is empty");
+
+		//without depth2xyz, use the rays of the depth camera
+		bool use_projector = m_depth2xyz.empty();
+		const DepthBackProjector* rays = get_depth_rays();
+		assert_throw(!use_projector || rays, "depth2xyz is empty and depth camera is not available");
 
 		//check range
 		auto x = depth_xy[0];
 		auto y = depth_xy[1];
 
-		bool in_range = x >= 0 && x < m_depth2xyz.cols && y >= 0 && y < m_depth2xyz.rows;
+		bool in_range = x >= 0 && x < m_depth_image.cols && y >= 0 && y < m_depth_image.rows;
 		assert_throw(in_range, "coordinate out of range");
 
-		bool is_valid = m_depth_image.at<DepthValue_t>(y, x) != 0;
+		auto depth_value = m_depth_image.at<DepthValue_t>(y, x);
+		bool is_valid = depth_value != 0;
 		if (!is_valid)
 			return false;
 
-		auto v = m_depth2xyz.at<cv::Vec3f>(y, x);
-		if (out_point)
+		if (!out_point)
+			return true;
+
+		if (use_projector)
+			*out_point = rays->back_project_pixel((int)x, (int)y, depth_value);
+		else
 		{
+			auto v = m_depth2xyz.at<cv::Vec3f>(y, x);
 			out_point->x() = v[0];
 			out_point->y() = v[1];
 			out_point->z() = v[2];
@@ -237,6 +262,27 @@ namespace _NS_UTILITY
 		return true;
 	}
 
+	bool DefaultFrameReader::get_depth_point_cloud(cv::Mat* out_depth2xyz, cv::Mat* out_normals) const
+	{
+		//the device already provides the points
+		if (!m_depth2xyz.empty() && !out_normals)
+		{
+			if (out_depth2xyz)
+				*out_depth2xyz = m_depth2xyz;
+			return true;
+		}
+
+		const DepthBackProjector* rays = get_depth_rays();
+		if (!rays)
+			return false;
+		if (!out_depth2xyz && !out_normals)
+			return true;
+
+		cv::Mat xyz;
+		rays->back_project(m_depth_image, out_depth2xyz ? *out_depth2xyz : xyz, 1.0, out_normals);
+		return true;
+	}
+
 	bool DefaultFrameReader::get_color_image(cv::Mat* output, ImageFormat fmt /*= ImageFormat::NONE*/) const
 	{
 		//assert_throw(!m_color_image.empty(), "color image is not available");
@@ -324,6 +370,9 @@ namespace _NS_UTILITY
 			m_depth_intrinsic = cv::Mat();
 			m_depth_extrinsic = cv::Mat();
 		}
+
+		//the tables are kept if the cameras are the same as the last frame
+		update_registration();
 	}
 
 	CameraModel DefaultFrameReader::get_color_camera() const
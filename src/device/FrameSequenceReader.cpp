@@ -0,0 +1,259 @@
+#include <cmath>
+#include <cctype>
+#include <algorithm>
+#include <igcclib/device/FrameSequenceReader.hpp>
+#include <igcclib/core/igcclib_common.hpp>
+#include <igcclib/io/igcclib_io_filesys.hpp>
+#include <igcclib/io/igcclib_io_numpy_opencv.hpp>
+
+namespace _NS_UTILITY
+{
+	//files recognized as frames when the sequence is a flat directory
+	static const char* FRAME_FILE_EXTENSIONS[] = {
+		".npy", ".png", ".jpg", ".jpeg", ".bmp", ".tif", ".tiff", ".exr", ".pfm"
+	};
+
+	static std::string _lower_extension(const std::string& filename)
+	{
+		std::string path, name, ext;
+		fileparts(filename, path, name, ext);
+		std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		return ext;
+	}
+
+	static size_t _num_bytes(const cv::Mat& img)
+	{
+		return img.total() * img.elemSize();
+	}
+
+	FrameSequenceReader::~FrameSequenceReader()
+	{
+		close();
+	}
+
+	bool FrameSequenceReader::init_from_dir(const std::string& dirname, const std::string& filename,
+		size_t cache_bytes, int n_worker, int n_readahead)
+	{
+		namespace bfs = boost::filesystem;
+		close();
+
+		if (!bfs::is_directory(dirname))
+			return false;
+
+		if (filename.empty())
+		{
+			for (const auto& fn : get_files_from_dir(dirname, true))
+			{
+				auto ext = _lower_extension(fn);
+				for (auto x : FRAME_FILE_EXTENSIONS)
+					if (ext == x)
+					{
+						m_filenames.push_back(fn);
+						break;
+					}
+			}
+		}
+		else
+		{
+			for (const auto& subdir : get_subdirs(dirname, true))
+			{
+				std::string fn = subdir + "/" + filename;
+				if (bfs::is_regular_file(fn))
+					m_filenames.push_back(fn);
+			}
+		}
+		sort_string_by_natural_order(m_filenames);
+
+		//the first frame gives the frame size
+		cv::Mat first;
+		if (m_filenames.empty() || !read_frame_file(m_filenames[0], first))
+		{
+			m_filenames.clear();
+			return false;
+		}
+		m_width = first.cols;
+		m_height = first.rows;
+		m_cache_budget = cache_bytes;
+		m_n_readahead = std::max(n_readahead, 0);
+		m_stop = false;
+		add_to_cache(0, first);
+
+		if (n_worker <= 0)
+			n_worker = std::max(1, (int)std::thread::hardware_concurrency());
+		for (int i = 0; i < n_worker; i++)
+			m_workers.emplace_back(new std::thread([this]() { this->worker_loop(); }));
+		return true;
+	}
+
+	void FrameSequenceReader::close()
+	{
+		if (!m_workers.empty())
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_cv_worker.notify_all();
+			for (auto& x : m_workers)
+				x->join();
+			m_workers.clear();
+		}
+
+		m_cache.clear();
+		m_lru.clear();
+		m_cache_bytes = 0;
+		m_queue.clear();
+		m_decoding.clear();
+		m_filenames.clear();
+		m_frame_index = 0;
+		m_last_read = 0;
+		m_width = m_height = 0;
+	}
+
+	bool FrameSequenceReader::read_frame_file(const std::string& filename, cv::Mat& output)
+	{
+		//called in the workers, so failures are reported by the return value
+		try
+		{
+			if (_lower_extension(filename) == ".npy")
+				read_np_array(filename, output);
+			else
+				output = cv::imread(filename, cv::IMREAD_UNCHANGED);
+		}
+		catch (const std::exception&)
+		{
+			output.release();
+		}
+		return !output.empty();
+	}
+
+	void FrameSequenceReader::worker_loop()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true)
+		{
+			m_cv_worker.wait(lock, [&]() { return m_stop || !m_queue.empty(); });
+			if (m_stop)
+				break;
+
+			size_t n = m_queue.front();
+			m_queue.pop_front();
+			if (m_cache.count(n) || m_decoding.count(n))
+				continue;
+
+			m_decoding.insert(n);
+			lock.unlock();
+			cv::Mat image;
+			read_frame_file(m_filenames[n], image);
+			lock.lock();
+			m_decoding.erase(n);
+			add_to_cache(n, image);
+			m_cv_reader.notify_all();
+		}
+	}
+
+	bool FrameSequenceReader::is_pending(size_t n) const
+	{
+		return m_decoding.count(n) > 0 || std::find(m_queue.begin(), m_queue.end(), n) != m_queue.end();
+	}
+
+	void FrameSequenceReader::schedule(size_t n, bool is_forward)
+	{
+		//requests of the previous position are no longer needed
+		m_queue.clear();
+		for (int i = 0; i <= m_n_readahead; i++)
+		{
+			if (!is_forward && (size_t)i > n)
+				break;
+			size_t k = is_forward ? n + i : n - i;
+			if (k >= m_filenames.size())
+				break;
+			if (!m_cache.count(k) && !m_decoding.count(k))
+				m_queue.push_back(k);
+		}
+		if (!m_queue.empty())
+			m_cv_worker.notify_all();
+	}
+
+	void FrameSequenceReader::add_to_cache(size_t n, const cv::Mat& image)
+	{
+		if (m_cache.count(n))
+			return;
+
+		m_lru.push_front(n);
+		auto& x = m_cache[n];
+		x.image = image;
+		x.lru_pos = m_lru.begin();
+		m_cache_bytes += _num_bytes(image);
+
+		//drop the least recently used frames, but keep the new one
+		while (m_cache_bytes > m_cache_budget && m_lru.size() > 1)
+		{
+			auto it = m_cache.find(m_lru.back());
+			m_cache_bytes -= _num_bytes(it->second.image);
+			m_cache.erase(it);
+			m_lru.pop_back();
+		}
+	}
+
+	void FrameSequenceReader::begin_sequential_read()
+	{
+		m_frame_index = 0;
+		m_last_read = 0;
+		if (m_filenames.empty())
+			return;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		schedule(0, true);
+	}
+
+	bool FrameSequenceReader::read_next_frame(cv::Mat* output)
+	{
+		return read_frame_by_index(m_frame_index, output);
+	}
+
+	bool FrameSequenceReader::read_frame_by_index(size_t n, cv::Mat* output)
+	{
+		if (!output || n >= m_filenames.size())
+			return false;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		schedule(n, n >= m_last_read);
+
+		//the frame may be dropped by read-ahead frames before this thread wakes up, then ask for it again
+		m_cv_reader.wait(lock, [&]() {
+			if (m_cache.count(n))
+				return true;
+			if (!is_pending(n))
+			{
+				m_queue.push_front(n);
+				m_cv_worker.notify_one();
+			}
+			return false;
+		});
+
+		auto& x = m_cache[n];
+		m_lru.splice(m_lru.begin(), m_lru, x.lru_pos);
+		*output = x.image;
+		m_last_read = n;
+		m_frame_index = n + 1;
+		return !output->empty();
+	}
+
+	bool FrameSequenceReader::read_frame_by_time(double t_sec, cv::Mat* output)
+	{
+		assert_throw(m_fps > 0, "frame rate is not set");
+		return read_frame_by_index((size_t)std::max(0.0, std::round(t_sec * m_fps)), output);
+	}
+
+	double FrameSequenceReader::get_current_time_ms() const
+	{
+		return m_fps > 0 ? m_last_read * 1000.0 / m_fps : 0;
+	}
+
+	size_t FrameSequenceReader::get_cache_size() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_cache_bytes;
+	}
+}
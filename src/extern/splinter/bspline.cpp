@@ -14,6 +14,7 @@
 #include <igcclib/extern/splinter/linearsolvers.h>
 #include <igcclib/extern/splinter/serializer.h>
 #include <igcclib/extern/splinter/utilities.h>
+#include <algorithm>
 #include <iostream>
 
 namespace SPLINTER
@@ -92,6 +93,116 @@ DenseMatrix BSpline::evalJacobian(DenseVector x) const
     return coefficients.transpose()*evalBasisJacobian(x);
 }
 
+DenseVector BSpline::evalBatch(const DenseMatrix &x) const
+{
+    DenseVector values;
+    evalBatchImpl(x, &values, nullptr);
+    return values;
+}
+
+DenseMatrix BSpline::evalJacobianBatch(const DenseMatrix &x) const
+{
+    DenseMatrix jacobians;
+    evalBatchImpl(x, nullptr, &jacobians);
+    return jacobians;
+}
+
+void BSpline::evalBatchImpl(const DenseMatrix &x, DenseVector *values, DenseMatrix *jacobians) const
+{
+    if (x.cols() != numVariables)
+        throw Exception("BSpline::evalBatch: Wrong dimension on evaluation points x.");
+
+    int numPoints = x.rows();
+    int nv = numVariables;
+    bool withJacobian = jacobians != nullptr;
+
+    // Per variable layout of the nonzero basis functions, the first variable varies slowest
+    // in the coefficient index, the same as the Kronecker product in BSplineBasis::eval
+    std::vector<int> numSupported(nv), offset(nv + 1, 0), stride(nv, 1);
+    for (int v = 0; v < nv; v++)
+    {
+        numSupported[v] = basis.getBasisDegree(v) + 1;
+        offset[v+1] = offset[v] + numSupported[v];
+    }
+    for (int v = nv - 2; v >= 0; v--)
+        stride[v] = stride[v+1]*basis.getNumBasisFunctions(v+1);
+
+    DenseVector outValues = DenseVector::Zero(values ? numPoints : 0);
+    DenseMatrix outJacobians = DenseMatrix::Zero(withJacobian ? numPoints : 0, nv);
+
+    #pragma omp parallel
+    {
+        // Workspace reused by all points of this thread
+        std::vector<double> basisValues(offset[nv]), basisDerivatives(offset[nv]);
+        std::vector<int> first(nv), counter(nv);
+        std::vector<double> grad(nv);
+
+        #pragma omp for
+        for (int i = 0; i < numPoints; i++)
+        {
+            bool inside = true;
+            for (int v = 0; v < nv && inside; v++)
+            {
+                double *der = withJacobian ? &basisDerivatives[offset[v]] : nullptr;
+                first[v] = basis.getBasis1D(v).evalNonZero(x(i, v), &basisValues[offset[v]], der);
+                inside = first[v] >= 0;
+            }
+            if (!inside)
+                continue;
+
+            // Visit the tensor product of the nonzero basis functions
+            double value = 0;
+            std::fill(grad.begin(), grad.end(), 0.0);
+            std::fill(counter.begin(), counter.end(), 0);
+            while (true)
+            {
+                int index = 0;
+                double prod = 1;
+                for (int v = 0; v < nv; v++)
+                {
+                    index += (first[v] + counter[v])*stride[v];
+                    prod *= basisValues[offset[v] + counter[v]];
+                }
+                double c = coefficients(index);
+                value += c*prod;
+
+                if (withJacobian)
+                {
+                    for (int d = 0; d < nv; d++)
+                    {
+                        double dprod = c;
+                        for (int v = 0; v < nv; v++)
+                            dprod *= (v == d) ? basisDerivatives[offset[v] + counter[v]] : basisValues[offset[v] + counter[v]];
+                        grad[d] += dprod;
+                    }
+                }
+
+                // Advance the counter, the last variable varies fastest
+                int v = nv - 1;
+                for (; v >= 0; v--)
+                {
+                    if (++counter[v] < numSupported[v])
+                        break;
+                    counter[v] = 0;
+                }
+                if (v < 0)
+                    break;
+            }
+
+            if (values)
+                outValues(i) = value;
+            if (withJacobian)
+                for (int d = 0; d < nv; d++)
+                    outJacobians(i, d) = grad[d];
+        }
+    }
+
+    if (values)
+        *values = std::move(outValues);
+    if (jacobians)
+        *jacobians = std::move(outJacobians);
+}
+
 /*
  * Returns the Hessian evaluated at x.
  * The Hessian is an n x n matrix,
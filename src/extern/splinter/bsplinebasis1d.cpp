@@ -70,6 +70,57 @@ SparseVector BSplineBasis1D::eval(double x) const
     return values;
 }
 
+int BSplineBasis1D::evalNonZero(double x, double *values, double *derivatives) const
+{
+    if (!insideSupport(x))
+        return -1;
+
+    supportHack(x);
+
+    int p = degree;
+    int span = indexHalfopenInterval(x);
+
+    // Triangular scheme of Cox-de Boor, Algorithm A2.2 in Piegl and Tiller (1997).
+    // values[r] holds the basis functions of degree j, starting at index span-j
+    values[0] = 1;
+    for (int j = 1; j <= p; j++)
+    {
+        // First derivatives from the degree p-1 functions, Equation 3.35 in Lyche & Moerken (2011)
+        if (j == p && derivatives != nullptr)
+        {
+            for (int k = 0; k <= p; k++)
+            {
+                int i = span - p + k;
+                double d = 0;
+                double t1 = knots.at(i+p) - knots.at(i);
+                double t2 = knots.at(i+p+1) - knots.at(i+1);
+                if (k >= 1 && t1 != 0)
+                    d += values[k-1]/t1;
+                if (k <= p-1 && t2 != 0)
+                    d -= values[k]/t2;
+                derivatives[k] = p*d;
+            }
+        }
+
+        double saved = 0;
+        for (int r = 0; r < j; r++)
+        {
+            double right = knots.at(span+r+1) - x;
+            double left = x - knots.at(span+1-j+r);
+            double denom = right + left;
+            double temp = denom != 0 ? values[r]/denom : 0;
+            values[r] = saved + right*temp;
+            saved = left*temp;
+        }
+        values[j] = saved;
+    }
+
+    if (p == 0 && derivatives != nullptr)
+        derivatives[0] = 0;
+
+    return span - p;
+}
+
 SparseVector BSplineBasis1D::evalDerivative(double x, int r) const
 {
     // Evaluate rth derivative of basis functions at x
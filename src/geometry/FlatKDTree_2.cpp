@@ -0,0 +1,229 @@
+#include <numeric>
+#include <cmath>
+#include <igcclib/geometry/FlatKDTree_2.hpp>
+
+namespace _NS_UTILITY
+{
+	//squared distance from a point to a node box, 0 if inside
+	static float _box_sqdist(const FlatKDTree_2::Node& node, float x, float y)
+	{
+		float dx = std::max(0.0f, std::max(node.minc[0] - x, x - node.maxc[0]));
+		float dy = std::max(0.0f, std::max(node.minc[1] - y, y - node.maxc[1]));
+		return dx * dx + dy * dy;
+	}
+
+	//squared distance from a point to the farthest corner of a node box
+	static float _box_max_sqdist(const FlatKDTree_2::Node& node, float x, float y)
+	{
+		float dx = std::max(std::abs(node.minc[0] - x), std::abs(node.maxc[0] - x));
+		float dy = std::max(std::abs(node.minc[1] - y), std::abs(node.maxc[1] - y));
+		return dx * dx + dy * dy;
+	}
+
+	void FlatKDTree_2::init_with_points(const float* xy, size_t n_point, int leaf_size)
+	{
+		assert_throw(leaf_size > 0, "leaf size must be positive");
+		assert_throw(n_point < (size_t)std::numeric_limits<int>::max(), "too many points");
+
+		m_nodes.clear();
+		m_xy.clear();
+		m_index.clear();
+		if (n_point == 0)
+			return;
+
+		int n = (int)n_point;
+		std::vector<int> perm(n);
+		std::iota(perm.begin(), perm.end(), 0);
+		m_nodes.reserve(2 * (n / leaf_size + 1));
+
+		//create nodes breadth first, each node splits its range at the median of the longer axis
+		Node root;
+		root.begin = 0;
+		root.end = n;
+		root.left = root.right = -1;
+		m_nodes.push_back(root);
+		for (size_t idxnode = 0; idxnode < m_nodes.size(); idxnode++)
+		{
+			auto node = m_nodes[idxnode];
+			node.minc[0] = node.minc[1] = std::numeric_limits<float>::max();
+			node.maxc[0] = node.maxc[1] = std::numeric_limits<float>::lowest();
+			for (int i = node.begin; i < node.end; i++)
+			{
+				for (int d = 0; d < 2; d++)
+				{
+					auto v = xy[perm[i] * 2 + d];
+					node.minc[d] = std::min(node.minc[d], v);
+					node.maxc[d] = std::max(node.maxc[d], v);
+				}
+			}
+
+			if (node.end - node.begin > leaf_size)
+			{
+				int dim = (node.maxc[0] - node.minc[0]) >= (node.maxc[1] - node.minc[1]) ? 0 : 1;
+				int mid = (node.begin + node.end) / 2;
+				std::nth_element(perm.begin() + node.begin, perm.begin() + mid, perm.begin() + node.end,
+					[&](int a, int b) {return xy[a * 2 + dim] < xy[b * 2 + dim]; });
+
+				Node left, right;
+				left.begin = node.begin;
+				left.end = mid;
+				right.begin = mid;
+				right.end = node.end;
+				left.left = left.right = right.left = right.right = -1;
+				node.left = (int)m_nodes.size();
+				node.right = node.left + 1;
+				m_nodes.push_back(left);
+				m_nodes.push_back(right);
+			}
+			m_nodes[idxnode] = node;
+		}
+
+		//reorder points so that each leaf is contiguous in memory
+		m_xy.resize(n * 2);
+		m_index.resize(n);
+#pragma omp parallel for
+		for (int i = 0; i < n; i++)
+		{
+			m_xy[i * 2] = xy[perm[i] * 2];
+			m_xy[i * 2 + 1] = xy[perm[i] * 2 + 1];
+			m_index[i] = perm[i];
+		}
+	}
+
+	int FlatKDTree_2::query_knn(float x, float y, int k, int_type* out_index, float* out_distance) const
+	{
+		if (k <= 0 || m_nodes.empty())
+			return 0;
+
+		//found points are kept sorted by squared distance
+		int n_found = 0;
+		auto worst = [&]() {
+			return n_found < k ? std::numeric_limits<float>::max() : out_distance[k - 1];
+		};
+
+		//nodes to visit, nearer child is visited first
+		int stack[64];
+		int n_stack = 0;
+		stack[n_stack++] = 0;
+		while (n_stack > 0)
+		{
+			const auto& node = m_nodes[stack[--n_stack]];
+			if (_box_sqdist(node, x, y) > worst())
+				continue;
+
+			if (node.left < 0)
+			{
+				for (int i = node.begin; i < node.end; i++)
+				{
+					float dx = m_xy[i * 2] - x;
+					float dy = m_xy[i * 2 + 1] - y;
+					float d = dx * dx + dy * dy;
+					if (d >= worst())
+						continue;
+
+					//insertion into the sorted list
+					int pos = std::min(n_found, k - 1);
+					while (pos > 0 && out_distance[pos - 1] > d)
+					{
+						out_distance[pos] = out_distance[pos - 1];
+						out_index[pos] = out_index[pos - 1];
+						pos--;
+					}
+					out_distance[pos] = d;
+					out_index[pos] = m_index[i];
+					n_found = std::min(n_found + 1, k);
+				}
+				continue;
+			}
+
+			auto dl = _box_sqdist(m_nodes[node.left], x, y);
+			auto dr = _box_sqdist(m_nodes[node.right], x, y);
+			if (dl <= dr)
+			{
+				stack[n_stack++] = node.right;
+				stack[n_stack++] = node.left;
+			}
+			else
+			{
+				stack[n_stack++] = node.left;
+				stack[n_stack++] = node.right;
+			}
+		}
+
+		for (int i = 0; i < n_found; i++)
+			out_distance[i] = std::sqrt(out_distance[i]);
+		return n_found;
+	}
+
+	void FlatKDTree_2::query_radius(float x, float y, float r, std::vector<int_type>& out_index,
+		std::vector<float>* out_distance) const
+	{
+		if (m_nodes.empty() || r < 0)
+			return;
+
+		float r2 = r * r;
+		int stack[64];
+		int n_stack = 0;
+		stack[n_stack++] = 0;
+		while (n_stack > 0)
+		{
+			const auto& node = m_nodes[stack[--n_stack]];
+			if (_box_sqdist(node, x, y) > r2)
+				continue;
+
+			//node entirely inside the ball, take all points without testing
+			bool is_inside = _box_max_sqdist(node, x, y) <= r2;
+			if (node.left < 0 || is_inside)
+			{
+				for (int i = node.begin; i < node.end; i++)
+				{
+					float dx = m_xy[i * 2] - x;
+					float dy = m_xy[i * 2 + 1] - y;
+					float d = dx * dx + dy * dy;
+					if (is_inside || d <= r2)
+					{
+						out_index.push_back(m_index[i]);
+						if (out_distance)
+							out_distance->push_back(std::sqrt(d));
+					}
+				}
+				continue;
+			}
+
+			stack[n_stack++] = node.left;
+			stack[n_stack++] = node.right;
+		}
+	}
+
+	void FlatKDTree_2::query_aabb(float xmin, float ymin, float xmax, float ymax, std::vector<int_type>& out_index) const
+	{
+		if (m_nodes.empty())
+			return;
+
+		int stack[64];
+		int n_stack = 0;
+		stack[n_stack++] = 0;
+		while (n_stack > 0)
+		{
+			const auto& node = m_nodes[stack[--n_stack]];
+			if (node.minc[0] > xmax || node.maxc[0] < xmin || node.minc[1] > ymax || node.maxc[1] < ymin)
+				continue;
+
+			bool is_inside = node.minc[0] >= xmin && node.maxc[0] <= xmax && node.minc[1] >= ymin && node.maxc[1] <= ymax;
+			if (node.left < 0 || is_inside)
+			{
+				for (int i = node.begin; i < node.end; i++)
+				{
+					float px = m_xy[i * 2];
+					float py = m_xy[i * 2 + 1];
+					if (is_inside || (px >= xmin && px <= xmax && py >= ymin && py <= ymax))
+						out_index.push_back(m_index[i]);
+				}
+				continue;
+			}
+
+			stack[n_stack++] = node.left;
+			stack[n_stack++] = node.right;
+		}
+	}
+}
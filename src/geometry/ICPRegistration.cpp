@@ -0,0 +1,465 @@
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <igcclib/geometry/ICPRegistration.hpp>
+#include <igcclib/geometry/MeshSearcher.hpp>
+#include <igcclib/core/igcclib_common.hpp>
+
+namespace _NS_UTILITY
+{
+	using ICPClock = std::chrono::steady_clock;
+
+	static double _seconds_since(const ICPClock::time_point& t0)
+	{
+		return std::chrono::duration<double>(ICPClock::now() - t0).count();
+	}
+
+	//median of absolute values, the input is modified
+	static float_type _median_abs(std::vector<float_type>& values)
+	{
+		if (values.empty())
+			return 0;
+		for (auto& x : values)
+			x = std::abs(x);
+		auto mid = values.begin() + values.size() / 2;
+		std::nth_element(values.begin(), mid, values.end());
+		return *mid;
+	}
+
+	static float_type _robust_weight(ICPRegistration::RobustKernel kernel, float_type r, float_type scale)
+	{
+		using RK = ICPRegistration::RobustKernel;
+		r = std::abs(r);
+		if (kernel == RK::NONE || scale <= 0)
+			return 1.0;
+
+		//tuning constants give 95% efficiency for gaussian residuals
+		switch (kernel) {
+		case RK::HUBER:
+		{
+			auto k = 1.345 * scale;
+			return r <= k ? 1.0 : k / r;
+		}
+		case RK::TUKEY:
+		{
+			auto c = 4.685 * scale;
+			if (r >= c)
+				return 0.0;
+			auto u = 1.0 - (r / c) * (r / c);
+			return u * u;
+		}
+		case RK::CAUCHY:
+		{
+			auto c = 2.3849 * scale;
+			return 1.0 / (1.0 + (r / c) * (r / c));
+		}
+		default:
+			return 1.0;
+		}
+	}
+
+	//weighted rigid transformation from src to dst, returned as right-mul matrix
+	static fMATRIX_4 _solve_point_to_point(const fMATRIX& src, const fMATRIX& dst, const fVECTOR& w)
+	{
+		auto w_sum = w.sum();
+		fVECTOR_3 c_src = (src.transpose() * w) / w_sum;
+		fVECTOR_3 c_dst = (dst.transpose() * w) / w_sum;
+
+		fMATRIX_3 covmat = fMATRIX_3::Zero();
+		for (Eigen::Index i = 0; i < src.rows(); i++)
+		{
+			fVECTOR_3 p = src.row(i).transpose() - c_src;
+			fVECTOR_3 q = dst.row(i).transpose() - c_dst;
+			covmat += w(i) * p * q.transpose();
+		}
+
+		Eigen::JacobiSVD<fMATRIX_3> svd(covmat, Eigen::ComputeFullU | Eigen::ComputeFullV);
+		fMATRIX_3 u = svd.matrixU();
+		fMATRIX_3 v = svd.matrixV();
+		fMATRIX_3 s = fMATRIX_3::Identity();
+		if ((v * u.transpose()).determinant() < 0)
+			s(2, 2) = -1;
+
+		//left-mul rotation, q = R*p + t
+		fMATRIX_3 rotmat = v * s * u.transpose();
+		fVECTOR_3 t = c_dst - rotmat * c_src;
+
+		fMATRIX_4 output = fMATRIX_4::Identity();
+		output.block(0, 0, 3, 3) = rotmat.transpose();
+		output.block(3, 0, 1, 3) = t.transpose();
+		return output;
+	}
+
+	//linearized point-to-plane solve, returned as right-mul matrix
+	static fMATRIX_4 _solve_point_to_plane(const fMATRIX& src, const fMATRIX& dst,
+		const fMATRIX& dst_normals, const fVECTOR& w)
+	{
+		using MAT6 = Eigen::Matrix<float_type, 6, 6>;
+		using VEC6 = Eigen::Matrix<float_type, 6, 1>;
+
+		MAT6 ata = MAT6::Zero();
+		VEC6 atb = VEC6::Zero();
+		for (Eigen::Index i = 0; i < src.rows(); i++)
+		{
+			fVECTOR_3 p = src.row(i);
+			fVECTOR_3 q = dst.row(i);
+			fVECTOR_3 n = dst_normals.row(i);
+
+			VEC6 a;
+			a.head(3) = p.cross(n);
+			a.tail(3) = n;
+			float_type b = (q - p).dot(n);
+			ata.noalias() += w(i) * a * a.transpose();
+			atb.noalias() += w(i) * b * a;
+		}
+
+		VEC6 x = ata.ldlt().solve(atb);
+		if (!x.allFinite())
+			return fMATRIX_4::Identity();
+
+		//the small rotation angles are turned into a proper rotation
+		fVECTOR_3 rotvec = x.head(3);
+		fMATRIX_3 rotmat = fMATRIX_3::Identity();
+		auto angle = rotvec.norm();
+		if (angle > 0)
+			rotmat = Eigen::AngleAxis<float_type>(angle, rotvec / angle).toRotationMatrix();
+
+		fMATRIX_4 output = fMATRIX_4::Identity();
+		output.block(0, 0, 3, 3) = rotmat.transpose();
+		output.block(3, 0, 1, 3) = x.tail(3).transpose();
+		return output;
+	}
+
+	void ICPRegistration::set_target_points(const fMATRIX& pts, const fMATRIX* normals /*= nullptr*/)
+	{
+		assert_throw(pts.cols() == 3, "target points must be 3d");
+		m_mesh_searcher.reset();
+		m_target_mesh.reset();
+
+		m_target_points = pts;
+		m_kdtree = std::make_shared<fKDTREE_STATIC_n>();
+		m_kdtree->init_with_points(m_target_points);
+
+		if (normals)
+		{
+			assert_throw(normals->rows() == pts.rows() && normals->cols() == 3, "target normals do not match target points");
+			m_target_normals = *normals;
+			normalize_rows(m_target_normals);
+		}
+		else
+			estimate_target_normals();
+	}
+
+	void ICPRegistration::set_target_mesh(const TriangularMesh& mesh)
+	{
+		m_kdtree.reset();
+		m_target_points = fMATRIX();
+
+		m_target_mesh = std::make_shared<TriangularMesh>(mesh);
+		m_mesh_searcher = std::make_shared<MeshSearcher>();
+		m_mesh_searcher->set_mesh(*m_target_mesh, true);
+
+		//face normals in global coordinate
+		auto v = m_target_mesh->get_vertices(true);
+		const auto& f = m_target_mesh->get_faces();
+		m_target_normals.resize(f.rows(), 3);
+		for (Eigen::Index i = 0; i < f.rows(); i++)
+		{
+			fVECTOR_3 ab = v.row(f(i, 1)) - v.row(f(i, 0));
+			fVECTOR_3 ac = v.row(f(i, 2)) - v.row(f(i, 0));
+			m_target_normals.row(i) = ab.cross(ac).normalized();
+		}
+	}
+
+	void ICPRegistration::estimate_target_normals()
+	{
+		auto n_pts = m_target_points.rows();
+		int k = std::max(3, std::min<int>(m_normal_estimation_k, (int)n_pts));
+		m_target_normals.resize(n_pts, 3);
+		if (n_pts < 3)
+		{
+			m_target_normals.setZero();
+			return;
+		}
+
+		MATRIX_i idxnn;
+		m_kdtree->query(m_target_points, k, nullptr, &idxnn);
+
+		//the normal is the direction of least variance in the neighborhood
+#pragma omp parallel for
+		for (int i = 0; i < (int)n_pts; i++)
+		{
+			fMATRIX nbpts(k, 3);
+			for (int j = 0; j < k; j++)
+				nbpts.row(j) = m_target_points.row(idxnn(i, j));
+			fMATRIX centered = nbpts.rowwise() - nbpts.colwise().mean();
+			fMATRIX_3 covmat = centered.transpose() * centered;
+			Eigen::SelfAdjointEigenSolver<fMATRIX_3> eig(covmat);
+			m_target_normals.row(i) = eig.eigenvectors().col(0).transpose();
+		}
+	}
+
+	void ICPRegistration::find_correspondence(const fMATRIX& pts, fMATRIX* out_closest_pts,
+		fMATRIX* out_normals, std::vector<uint8_t>* out_valid) const
+	{
+		assert_throw(has_target(), "registration target is not set");
+		int n_pts = (int)pts.rows();
+		bool with_normals = out_normals && m_target_normals.rows() > 0;
+
+		fMATRIX closest_pts(n_pts, 3);
+		fMATRIX normals;
+		if (with_normals)
+			normals.resize(n_pts, 3);
+		std::vector<uint8_t> valid(n_pts, 1);
+
+		if (m_kdtree)
+		{
+			//each thread queries a block of points
+			const int block_size = 1024;
+			int n_block = (n_pts + block_size - 1) / block_size;
+
+#pragma omp parallel for
+			for (int b = 0; b < n_block; b++)
+			{
+				int i0 = b * block_size;
+				int n = std::min(block_size, n_pts - i0);
+				fMATRIX block = pts.block(i0, 0, n, 3);
+				MATRIX_i idxnn;
+				m_kdtree->query(block, 1, nullptr, &idxnn);
+				for (int i = 0; i < n; i++)
+				{
+					auto idx = idxnn(i, 0);
+					closest_pts.row(i0 + i) = m_target_points.row(idx);
+					if (with_normals)
+						normals.row(i0 + i) = m_target_normals.row(idx);
+				}
+			}
+		}
+		else
+		{
+			//CGAL builds its search structures lazily, make sure it happens before going parallel
+			if (n_pts > 0)
+			{
+				fVECTOR_3 p = pts.row(0);
+				m_mesh_searcher->find_closest_point(p, nullptr, nullptr);
+			}
+
+#pragma omp parallel for
+			for (int i = 0; i < n_pts; i++)
+			{
+				fVECTOR_3 p = pts.row(i);
+				fVECTOR_3 q;
+				int_type idxtri = -1;
+				m_mesh_searcher->find_closest_point(p, &q, &idxtri);
+				if (idxtri < 0)
+				{
+					valid[i] = 0;
+					continue;
+				}
+				closest_pts.row(i) = q.transpose();
+				if (with_normals)
+					normals.row(i) = m_target_normals.row(idxtri);
+			}
+		}
+
+		if (out_closest_pts)
+			*out_closest_pts = std::move(closest_pts);
+		if (out_normals)
+			*out_normals = std::move(normals);
+		if (out_valid)
+			*out_valid = std::move(valid);
+	}
+
+	void ICPRegistration::register_points(const fMATRIX& source_pts, Result* output,
+		const fMATRIX_4* init_transmat, const fMATRIX* source_normals) const
+	{
+		assert_throw(has_target(), "registration target is not set");
+		assert_throw(source_pts.cols() == 3, "source points must be 3d");
+		if (source_normals)
+			assert_throw(source_normals->rows() == source_pts.rows() && source_normals->cols() == 3,
+				"source normals do not match source points");
+
+		const auto& opt = m_options;
+		bool use_plane = opt.metric == ErrorMetric::POINT_TO_PLANE;
+		if (use_plane)
+			assert_throw(m_target_normals.rows() > 0, "point-to-plane metric requires target normals");
+
+		bool check_normal = opt.max_normal_angle_deg > 0 && source_normals && m_target_normals.rows() > 0;
+		float_type min_normal_cos = std::cos(opt.max_normal_angle_deg * MathConstant::Deg2Rad);
+
+		Result result;
+		if (init_transmat)
+			result.transmat = *init_transmat;
+
+		auto n_source = (size_t)source_pts.rows();
+		std::vector<size_t> level_num_points = opt.level_num_points;
+		if (level_num_points.empty())
+			level_num_points.push_back(0);
+
+		for (size_t lv = 0; lv < level_num_points.size(); lv++)
+		{
+			//subsample the source points for this level
+			size_t n_use = level_num_points[lv];
+			if (n_use == 0 || n_use > n_source)
+				n_use = n_source;
+
+			fMATRIX src, src_normals;
+			if (n_use == n_source)
+			{
+				src = source_pts;
+				if (check_normal)
+					src_normals = *source_normals;
+			}
+			else
+			{
+				auto idx = random_select_index(n_use, n_source, false);
+				src = get_sub_matrix(source_pts, idx, -1);
+				if (check_normal)
+					src_normals = get_sub_matrix(*source_normals, idx, -1);
+			}
+
+			float_type prev_rmse = -1;
+			bool level_converged = false;
+			for (int it = 0; it < opt.max_iterations; it++)
+			{
+				auto t_begin = ICPClock::now();
+				IterationInfo info;
+				info.level = (int)lv;
+				info.iteration = it;
+
+				//correspondence search
+				fMATRIX src_now, dst, dst_normals;
+				std::vector<uint8_t> valid;
+				transform_points(src, result.transmat, src_now);
+				find_correspondence(src_now, &dst, (use_plane || check_normal) ? &dst_normals : nullptr, &valid);
+				info.time_correspondence = _seconds_since(t_begin);
+
+				auto t_solve = ICPClock::now();
+
+				//residuals and rejection
+				int n_pts = (int)src_now.rows();
+				fVECTOR residuals(n_pts);
+				fMATRIX src_normals_now;
+				if (check_normal)
+				{
+					src_normals_now = src_normals * result.transmat.block(0, 0, 3, 3);
+					normalize_rows(src_normals_now);
+				}
+
+#pragma omp parallel for
+				for (int i = 0; i < n_pts; i++)
+				{
+					if (!valid[i])
+						continue;
+					fVECTOR_3 d = dst.row(i) - src_now.row(i);
+					residuals(i) = use_plane ? std::abs(d.dot(dst_normals.row(i))) : d.norm();
+
+					if (opt.max_correspondence_distance > 0 && d.norm() > opt.max_correspondence_distance)
+						valid[i] = 0;
+					else if (check_normal && std::abs(src_normals_now.row(i).dot(dst_normals.row(i))) < min_normal_cos)
+						valid[i] = 0;
+				}
+
+				std::vector<float_type> inlier_residuals;
+				inlier_residuals.reserve(n_pts);
+				for (int i = 0; i < n_pts; i++)
+					if (valid[i])
+						inlier_residuals.push_back(residuals(i));
+				info.num_correspondences = inlier_residuals.size();
+
+				//trimming, reject the largest residuals
+				if (opt.trim_ratio < 1.0 && !inlier_residuals.empty())
+				{
+					size_t n_keep = std::max<size_t>(1, (size_t)(opt.trim_ratio * inlier_residuals.size()));
+					auto tmp = inlier_residuals;
+					std::nth_element(tmp.begin(), tmp.begin() + (n_keep - 1), tmp.end());
+					auto thres = tmp[n_keep - 1];
+					size_t n_kept = 0;
+					for (int i = 0; i < n_pts; i++)
+					{
+						if (!valid[i])
+							continue;
+						if (residuals(i) > thres || n_kept >= n_keep)
+							valid[i] = 0;
+						else
+							n_kept++;
+					}
+				}
+
+				//gather the inliers
+				std::vector<int> idx_inlier;
+				for (int i = 0; i < n_pts; i++)
+					if (valid[i])
+						idx_inlier.push_back(i);
+				info.num_inliers = idx_inlier.size();
+
+				if (idx_inlier.size() < 3)
+				{
+					info.time_solve = _seconds_since(t_solve);
+					info.time_total = _seconds_since(t_begin);
+					result.iterations.push_back(info);
+					break;
+				}
+
+				fMATRIX p = get_sub_matrix(src_now, idx_inlier, -1);
+				fMATRIX q = get_sub_matrix(dst, idx_inlier, -1);
+				fVECTOR r(idx_inlier.size());
+				for (size_t i = 0; i < idx_inlier.size(); i++)
+					r(i) = residuals(idx_inlier[i]);
+				info.rmse = std::sqrt(r.squaredNorm() / r.size());
+
+				//robust weights
+				fVECTOR w = fVECTOR::Ones(r.size());
+				if (opt.robust_kernel != RobustKernel::NONE)
+				{
+					float_type scale = opt.robust_scale;
+					if (scale <= 0)
+					{
+						std::vector<float_type> tmp(r.data(), r.data() + r.size());
+						scale = 1.4826 * _median_abs(tmp);
+					}
+					for (Eigen::Index i = 0; i < r.size(); i++)
+						w(i) = _robust_weight(opt.robust_kernel, r(i), scale);
+					if (w.sum() <= 0)
+						w.setOnes();
+				}
+
+				//solve the incremental transformation
+				fMATRIX_4 delta;
+				if (use_plane)
+				{
+					fMATRIX qn = get_sub_matrix(dst_normals, idx_inlier, -1);
+					delta = _solve_point_to_plane(p, q, qn, w);
+				}
+				else
+					delta = _solve_point_to_point(p, q, w);
+				result.transmat = result.transmat * delta;
+
+				info.time_solve = _seconds_since(t_solve);
+				info.time_total = _seconds_since(t_begin);
+				result.iterations.push_back(info);
+				result.rmse = info.rmse;
+
+				//early termination
+				fMATRIX_3 drot = delta.block(0, 0, 3, 3);
+				auto cos_angle = std::min<float_type>(1.0, std::max<float_type>(-1.0, (drot.trace() - 1) / 2));
+				auto d_angle_deg = std::acos(cos_angle) * MathConstant::Rad2Deg;
+				auto d_trans = delta.block(3, 0, 1, 3).norm();
+				bool small_step = d_angle_deg < opt.rotation_tolerance_deg && d_trans < opt.translation_tolerance;
+				bool small_change = prev_rmse >= 0 && std::abs(prev_rmse - info.rmse) < opt.rmse_tolerance;
+				prev_rmse = info.rmse;
+				if (small_step || small_change)
+				{
+					level_converged = true;
+					break;
+				}
+			}
+
+			if (lv + 1 == level_num_points.size())
+				result.converged = level_converged;
+		}
+
+		if (output)
+			*output = std::move(result);
+	}
+}
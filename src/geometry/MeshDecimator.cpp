@@ -0,0 +1,523 @@
+#include <queue>
+#include <algorithm>
+#include <cmath>
+#include <igcclib/geometry/MeshDecimator.hpp>
+
+namespace _NS_UTILITY
+{
+	//symmetric 4x4 quadric, upper triangle in row order: aa ab ac ad bb bc bd cc cd dd
+	using Quadric = std::array<double, 10>;
+
+	static void _quadric_from_plane(double a, double b, double c, double d, Quadric& q)
+	{
+		q = { a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d };
+	}
+
+	static void _quadric_add(Quadric& q, const Quadric& x)
+	{
+		for (int i = 0; i < 10; i++)
+			q[i] += x[i];
+	}
+
+	static double _quadric_eval(const Quadric& q, const Eigen::Vector3d& p)
+	{
+		double x = p(0), y = p(1), z = p(2);
+		return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+			+ q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+			+ q[7] * z * z + 2 * q[8] * z + q[9];
+	}
+
+	//find the position minimizing the quadric, return false if the quadric is singular
+	static bool _quadric_optimize(const Quadric& q, Eigen::Vector3d& output)
+	{
+		Eigen::Matrix3d A;
+		A << q[0], q[1], q[2],
+			q[1], q[4], q[5],
+			q[2], q[5], q[7];
+		Eigen::Vector3d b(-q[3], -q[6], -q[8]);
+
+		Eigen::FullPivLU<Eigen::Matrix3d> lu(A);
+		lu.setThreshold(1e-8);
+		if (!lu.isInvertible())
+			return false;
+		output = lu.solve(b);
+		return true;
+	}
+
+	//a candidate collapse, moving vertex 'from' into vertex 'to'.
+	//Kept small so that the heap array stays compact.
+	struct _CollapseCandidate
+	{
+		float cost;
+		int from;
+		int to;
+		uint32_t stamp_from;
+		uint32_t stamp_to;
+
+		bool operator>(const _CollapseCandidate& other) const { return cost > other.cost; }
+	};
+
+	void MeshDecimator::init_with_mesh(const TriangularMesh& mesh)
+	{
+		m_mesh = std::make_shared<TriangularMesh>(mesh);
+		const auto& vts = m_mesh->get_vertices(false);
+		const auto& faces = m_mesh->get_faces();
+		int n_vert = (int)vts.rows();
+		int n_face = (int)faces.rows();
+		assert_throw(n_face == 0 || faces.cols() == 3, "only triangular mesh is supported");
+
+		//plane quadric of each face
+		std::vector<Quadric> face_quadrics(n_face);
+#pragma omp parallel for
+		for (int i = 0; i < n_face; i++)
+		{
+			fVECTOR_3 p0 = vts.row(faces(i, 0));
+			fVECTOR_3 ab = vts.row(faces(i, 1)) - vts.row(faces(i, 0));
+			fVECTOR_3 ac = vts.row(faces(i, 2)) - vts.row(faces(i, 0));
+			fVECTOR_3 n = ab.cross(ac);
+			auto len = n.norm();
+			if (len > 0)
+			{
+				n /= len;
+				_quadric_from_plane(n(0), n(1), n(2), -n.dot(p0), face_quadrics[i]);
+			}
+			else
+				face_quadrics[i].fill(0);
+		}
+
+		//vertex-face adjacency in compressed form
+		std::vector<int> offsets(n_vert + 1, 0);
+		for (int i = 0; i < n_face; i++)
+			for (int k = 0; k < 3; k++)
+				offsets[faces(i, k) + 1]++;
+		for (int i = 0; i < n_vert; i++)
+			offsets[i + 1] += offsets[i];
+		std::vector<int> adjfaces(offsets.back());
+		{
+			std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+			for (int i = 0; i < n_face; i++)
+				for (int k = 0; k < 3; k++)
+					adjfaces[cursor[faces(i, k)]++] = i;
+		}
+
+		//vertex quadric is the sum of its face quadrics, each vertex sums independently
+		m_quadrics.resize(n_vert);
+#pragma omp parallel for
+		for (int i = 0; i < n_vert; i++)
+		{
+			m_quadrics[i].fill(0);
+			for (int k = offsets[i]; k < offsets[i + 1]; k++)
+				_quadric_add(m_quadrics[i], face_quadrics[adjfaces[k]]);
+		}
+
+		//boundary vertices, the non-manifold edges are treated as boundary as well
+		m_is_boundary.assign(n_vert, 0);
+		{
+			std::vector<std::pair<int, int>> edges;
+			edges.reserve(n_face * 3);
+			for (int i = 0; i < n_face; i++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					int u = faces(i, k);
+					int v = faces(i, (k + 1) % 3);
+					edges.emplace_back(std::min(u, v), std::max(u, v));
+				}
+			}
+			std::sort(edges.begin(), edges.end());
+			for (size_t i = 0; i < edges.size();)
+			{
+				size_t j = i;
+				while (j < edges.size() && edges[j] == edges[i])
+					j++;
+				if (j - i != 2)
+				{
+					m_is_boundary[edges[i].first] = 1;
+					m_is_boundary[edges[i].second] = 1;
+				}
+				i = j;
+			}
+		}
+
+		//uv seam vertices have different texture coordinates in different faces
+		m_is_seam.assign(n_vert, 0);
+		const auto& tex_faces = m_mesh->get_texcoord_faces();
+		if (tex_faces.rows() == n_face && n_face > 0)
+		{
+			std::vector<int> texidx(n_vert, -1);
+			for (int i = 0; i < n_face; i++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					auto v = faces(i, k);
+					auto t = (int)tex_faces(i, k);
+					if (texidx[v] < 0)
+						texidx[v] = t;
+					else if (texidx[v] != t)
+						m_is_seam[v] = 1;
+				}
+			}
+		}
+	}
+
+	void MeshDecimator::decimate_with_options(const Options& opt, TriangularMesh* output,
+		std::vector<int_type>* out_vertex_index, Info* out_info) const
+	{
+		assert_throw(is_initialized(), "call init_with_mesh() first");
+		const auto& in_vts = m_mesh->get_vertices(false);
+		const auto& in_faces = m_mesh->get_faces();
+		const auto& in_tex_faces = m_mesh->get_texcoord_faces();
+		int n_vert = (int)in_vts.rows();
+		int n_face = (int)in_faces.rows();
+		bool has_uv = n_face > 0 && in_tex_faces.rows() == n_face;
+
+		// ============ working copy of the mesh ============
+		std::vector<Eigen::Vector3d> pos(n_vert);
+		for (int i = 0; i < n_vert; i++)
+			pos[i] = in_vts.row(i).transpose().cast<double>();
+		std::vector<Quadric> quadrics = m_quadrics;
+
+		std::vector<std::array<int, 3>> faces(n_face);
+		std::vector<std::array<int, 3>> tex_faces(has_uv ? n_face : 0);
+		for (int i = 0; i < n_face; i++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				faces[i][k] = (int)in_faces(i, k);
+				if (has_uv)
+					tex_faces[i][k] = (int)in_tex_faces(i, k);
+			}
+		}
+		fMATRIX uv = has_uv ? m_mesh->get_texcoord_vertices() : fMATRIX();
+
+		std::vector<uint8_t> face_alive(n_face, 1);
+		std::vector<uint8_t> vert_alive(n_vert, 1);
+		std::vector<uint32_t> stamps(n_vert, 0);
+		std::vector<uint8_t> locked(n_vert, 0);
+		std::vector<uint8_t> is_boundary = m_is_boundary;	//updated as boundary vertices collapse into interior ones
+		for (int i = 0; i < n_vert; i++)
+			locked[i] = (opt.preserve_boundary && m_is_boundary[i]) || (opt.preserve_uv_seam && m_is_seam[i]);
+
+		std::vector<std::vector<int>> vfaces(n_vert);
+		for (int i = 0; i < n_face; i++)
+			for (int k = 0; k < 3; k++)
+				vfaces[faces[i][k]].push_back(i);
+
+		auto get_neighbors = [&](int v, std::vector<int>& out) {
+			out.clear();
+			for (auto f : vfaces[v])
+			{
+				if (!face_alive[f])
+					continue;
+				for (auto x : faces[f])
+					if (x != v)
+						out.push_back(x);
+			}
+			std::sort(out.begin(), out.end());
+			out.erase(std::unique(out.begin(), out.end()), out.end());
+		};
+
+		//cost of collapsing edge (a,b), output the direction and the new position
+		auto evaluate = [&](int a, int b, _CollapseCandidate& cand, Eigen::Vector3d* out_pos) {
+			if (locked[a] && locked[b])
+				return false;
+			if (locked[a])
+				std::swap(a, b);
+
+			Quadric q = quadrics[a];
+			_quadric_add(q, quadrics[b]);
+
+			Eigen::Vector3d p;
+			if (locked[b])
+				p = pos[b];
+			else if (!_quadric_optimize(q, p))
+			{
+				//singular quadric, choose the best among the end points and the midpoint
+				Eigen::Vector3d options[3] = { pos[a], pos[b], (pos[a] + pos[b]) / 2 };
+				double best = std::numeric_limits<double>::max();
+				for (const auto& x : options)
+				{
+					auto c = _quadric_eval(q, x);
+					if (c < best)
+					{
+						best = c;
+						p = x;
+					}
+				}
+			}
+
+			cand.cost = (float)std::max(0.0, _quadric_eval(q, p));
+			cand.from = a;
+			cand.to = b;
+			cand.stamp_from = stamps[a];
+			cand.stamp_to = stamps[b];
+			if (out_pos)
+				*out_pos = p;
+			return true;
+		};
+
+		// ============ initial candidates, evaluated in parallel ============
+		std::vector<std::vector<int>> upper_neighbors(n_vert);
+#pragma omp parallel for
+		for (int i = 0; i < n_vert; i++)
+		{
+			auto& nb = upper_neighbors[i];
+			for (auto f : vfaces[i])
+				for (auto x : faces[f])
+					if (x > i)
+						nb.push_back(x);
+			std::sort(nb.begin(), nb.end());
+			nb.erase(std::unique(nb.begin(), nb.end()), nb.end());
+		}
+
+		std::vector<std::pair<int, int>> edges;
+		for (int i = 0; i < n_vert; i++)
+			for (auto x : upper_neighbors[i])
+				edges.emplace_back(i, x);
+		std::vector<std::vector<int>>().swap(upper_neighbors);
+
+		int n_edge = (int)edges.size();
+		std::vector<_CollapseCandidate> init_cands(n_edge);
+		std::vector<uint8_t> init_valid(n_edge, 0);
+#pragma omp parallel for
+		for (int i = 0; i < n_edge; i++)
+			init_valid[i] = evaluate(edges[i].first, edges[i].second, init_cands[i], nullptr);
+
+		std::vector<_CollapseCandidate> heap_data;
+		heap_data.reserve(n_edge);
+		for (int i = 0; i < n_edge; i++)
+			if (init_valid[i])
+				heap_data.push_back(init_cands[i]);
+		std::priority_queue<_CollapseCandidate, std::vector<_CollapseCandidate>, std::greater<_CollapseCandidate>>
+			heap(std::greater<_CollapseCandidate>(), std::move(heap_data));
+
+		// ============ collapse ============
+		double cos_max_rotation = std::cos(opt.max_normal_flip_deg * MathConstant::Deg2Rad);
+		size_t n_face_alive = n_face;
+		Info info;
+		std::vector<int> nb_from, nb_to, common;
+
+		//would moving vertex v of face f to p flip the face
+		auto is_flipped = [&](int f, int v, const Eigen::Vector3d& p) {
+			const auto& fc = faces[f];
+			Eigen::Vector3d x[3], y[3];
+			for (int k = 0; k < 3; k++)
+			{
+				x[k] = pos[fc[k]];
+				y[k] = fc[k] == v ? p : x[k];
+			}
+			Eigen::Vector3d n0 = (x[1] - x[0]).cross(x[2] - x[0]);
+			Eigen::Vector3d n1 = (y[1] - y[0]).cross(y[2] - y[0]);
+			auto len0 = n0.norm();
+			auto len1 = n1.norm();
+			if (len1 <= 0)
+				return true;
+			if (len0 <= 0)
+				return false;
+			return n0.dot(n1) / (len0 * len1) < cos_max_rotation;
+		};
+
+		while (!heap.empty())
+		{
+			if (opt.target_num_faces > 0 && n_face_alive <= opt.target_num_faces)
+				break;
+
+			auto cand = heap.top();
+			heap.pop();
+
+			int u = cand.from;
+			int v = cand.to;
+			if (!vert_alive[u] || !vert_alive[v] || stamps[u] != cand.stamp_from || stamps[v] != cand.stamp_to)
+				continue;
+			if (opt.max_error > 0 && cand.cost > opt.max_error)
+				break;
+
+			Eigen::Vector3d p;
+			evaluate(u, v, cand, &p);
+
+			//link condition: the common neighbors of u and v must be exactly the
+			//opposite vertices of the faces sharing the edge, otherwise the collapse is non-manifold
+			get_neighbors(u, nb_from);
+			get_neighbors(v, nb_to);
+			common.clear();
+			std::set_intersection(nb_from.begin(), nb_from.end(), nb_to.begin(), nb_to.end(), std::back_inserter(common));
+
+			int n_shared = 0;
+			int tex_v = -1;
+			bool ok = true;
+			for (auto f : vfaces[u])
+			{
+				if (!face_alive[f])
+					continue;
+				const auto& fc = faces[f];
+				int kv = (int)(std::find(fc.begin(), fc.end(), v) - fc.begin());
+				if (kv < 3)
+				{
+					n_shared++;
+
+					//the texture coordinate of v must agree across the edge
+					if (has_uv)
+					{
+						if (tex_v < 0)
+							tex_v = tex_faces[f][kv];
+						else if (tex_v != tex_faces[f][kv])
+							ok = false;
+					}
+				}
+				else if (is_flipped(f, u, p))
+					ok = false;
+			}
+			if (!ok || n_shared == 0 || (int)common.size() != n_shared)
+				continue;
+
+			//with the boundary closed by a virtual vertex, that vertex is a common neighbor of two boundary
+			//vertices, so the edge between them must be a boundary edge, otherwise the collapse pinches the surface
+			if (is_boundary[u] && is_boundary[v] && n_shared != 1)
+				continue;
+
+			for (auto f : vfaces[v])
+			{
+				if (!face_alive[f])
+					continue;
+				const auto& fc = faces[f];
+				if (std::find(fc.begin(), fc.end(), u) == fc.end() && is_flipped(f, v, p))
+				{
+					ok = false;
+					break;
+				}
+			}
+			if (!ok)
+				continue;
+
+			//interpolate the texture coordinate of v along the edge
+			if (has_uv && !locked[v] && !m_is_seam[v] && !m_is_seam[u])
+			{
+				int tex_u = -1;
+				for (auto f : vfaces[u])
+				{
+					if (!face_alive[f])
+						continue;
+					const auto& fc = faces[f];
+					tex_u = tex_faces[f][std::find(fc.begin(), fc.end(), u) - fc.begin()];
+					break;
+				}
+
+				Eigen::Vector3d d = pos[u] - pos[v];
+				auto len2 = d.squaredNorm();
+				if (tex_u >= 0 && len2 > 0)
+				{
+					auto t = std::min(1.0, std::max(0.0, d.dot(p - pos[v]) / len2));
+					uv.row(tex_v) = uv.row(tex_v) + t * (uv.row(tex_u) - uv.row(tex_v));
+				}
+			}
+
+			//collapse u into v
+			for (auto f : vfaces[u])
+			{
+				if (!face_alive[f])
+					continue;
+				auto& fc = faces[f];
+				if (std::find(fc.begin(), fc.end(), v) != fc.end())
+				{
+					face_alive[f] = 0;
+					n_face_alive--;
+					continue;
+				}
+
+				int ku = (int)(std::find(fc.begin(), fc.end(), u) - fc.begin());
+				fc[ku] = v;
+				if (has_uv && tex_v >= 0)
+					tex_faces[f][ku] = tex_v;
+				vfaces[v].push_back(f);
+			}
+			std::vector<int>().swap(vfaces[u]);
+			vert_alive[u] = 0;
+
+			auto& vf = vfaces[v];
+			vf.erase(std::remove_if(vf.begin(), vf.end(), [&](int f) {return !face_alive[f]; }), vf.end());
+
+			pos[v] = p;
+			is_boundary[v] = is_boundary[v] || is_boundary[u];
+			_quadric_add(quadrics[v], quadrics[u]);
+			stamps[v]++;
+
+			info.num_collapses++;
+			info.max_error = std::max(info.max_error, (float_type)cand.cost);
+
+			//the edges around v have changed
+			get_neighbors(v, nb_to);
+			for (auto x : nb_to)
+			{
+				_CollapseCandidate c;
+				if (evaluate(v, x, c, nullptr))
+					heap.push(c);
+			}
+		}
+
+		// ============ create output ============
+		std::vector<int> new_vert_index(n_vert, -1);
+		std::vector<int_type> vert_source;
+		for (int i = 0; i < n_vert; i++)
+		{
+			if (vert_alive[i] && !vfaces[i].empty())
+			{
+				new_vert_index[i] = (int)vert_source.size();
+				vert_source.push_back(i);
+			}
+		}
+
+		fMATRIX out_vts(vert_source.size(), 3);
+		for (size_t i = 0; i < vert_source.size(); i++)
+			out_vts.row(i) = pos[vert_source[i]].cast<float_type>().transpose();
+
+		iMATRIX out_faces(n_face_alive, 3);
+		iMATRIX out_tex_faces(has_uv ? n_face_alive : 0, 3);
+		std::vector<int> new_tex_index(uv.rows(), -1);
+		std::vector<int> tex_source;
+		int idxface = 0;
+		for (int i = 0; i < n_face; i++)
+		{
+			if (!face_alive[i])
+				continue;
+			for (int k = 0; k < 3; k++)
+			{
+				out_faces(idxface, k) = new_vert_index[faces[i][k]];
+				if (has_uv)
+				{
+					auto t = tex_faces[i][k];
+					if (new_tex_index[t] < 0)
+					{
+						new_tex_index[t] = (int)tex_source.size();
+						tex_source.push_back(t);
+					}
+					out_tex_faces(idxface, k) = new_tex_index[t];
+				}
+			}
+			idxface++;
+		}
+
+		TriangularMesh mesh;
+		if (has_uv)
+		{
+			fMATRIX out_uv = get_sub_matrix(uv, tex_source, -1);
+			TriangularMesh::init_with_vertex_face(mesh, out_vts, out_faces, &out_uv, &out_tex_faces);
+		}
+		else
+			TriangularMesh::init_with_vertex_face(mesh, out_vts, out_faces);
+
+		mesh.set_name(m_mesh->get_name());
+		mesh.set_transmat(m_mesh->get_transmat());
+		if (m_mesh->has_texture_image())
+			mesh.set_texture_image(m_mesh->get_texture_data_uint8().data(),
+				m_mesh->get_texture_width(), m_mesh->get_texture_height(), m_mesh->get_texture_format());
+		if (m_mesh->get_num_normal_vertices() > 0)
+			mesh.recompute_normal_per_vertex();
+
+		if (output)
+			*output = mesh;
+		if (out_vertex_index)
+			*out_vertex_index = std::move(vert_source);
+		if (out_info)
+			*out_info = info;
+	}
+}
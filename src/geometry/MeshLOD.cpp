@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cmath>
+#include <igcclib/geometry/MeshLOD.hpp>
+#include <igcclib/geometry/MeshDecimator.hpp>
+
+namespace _NS_UTILITY
+{
+	void MeshLOD::init_with_mesh(MeshLOD& output, const TriangularMesh& mesh, const Options& opt)
+	{
+		output.m_levels.clear();
+
+		Level base;
+		base.mesh = std::make_shared<TriangularMesh>(mesh);
+		base.error = 0;
+		output.m_levels.push_back(base);
+
+		fVECTOR_3 minc, maxc;
+		mesh.get_aabb_corner(minc, maxc, false);
+		output.m_diagonal_length = mesh.is_empty() ? 0 : (maxc - minc).norm();
+
+		//number of faces of each level
+		auto n_face = mesh.get_num_faces();
+		std::vector<size_t> targets;
+		for (auto r : opt.face_ratios)
+		{
+			auto n = (size_t)std::round(n_face * r);
+			if (n < opt.min_num_faces || n >= n_face)
+				continue;
+			targets.push_back(n);
+		}
+		std::sort(targets.begin(), targets.end(), std::greater<size_t>());
+		targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+		if (targets.empty())
+			return;
+
+		MeshDecimator decimator;
+		decimator.init_with_mesh(mesh);
+
+		//every level is simplified from the original mesh, and decimate() does not modify the decimator
+		int n_target = (int)targets.size();
+		std::vector<Level> levels(n_target);
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int i = 0; i < n_target; i++)
+		{
+			auto dopt = decimator.get_options();
+			dopt.target_num_faces = targets[i];
+			dopt.preserve_boundary = opt.preserve_boundary;
+			dopt.preserve_uv_seam = opt.preserve_uv_seam;
+
+			MeshDecimator::Info info;
+			levels[i].mesh = std::make_shared<TriangularMesh>();
+			decimator.decimate_with_options(dopt, levels[i].mesh.get(), nullptr, &info);
+
+			//the quadric error is a sum of squared distances
+			levels[i].error = std::sqrt(info.max_error);
+		}
+
+		//locked vertices may stop the simplification early, drop the levels that are not coarser
+		for (auto& lv : levels)
+		{
+			const auto& prev = output.m_levels.back();
+			if (lv.mesh->get_num_faces() >= prev.mesh->get_num_faces())
+				continue;
+			lv.error = std::max(lv.error, prev.error);
+			output.m_levels.push_back(lv);
+		}
+	}
+
+	size_t MeshLOD::select_level_by_error(float_type max_error) const
+	{
+		size_t output = 0;
+		for (size_t i = 0; i < m_levels.size(); i++)
+		{
+			if (m_levels[i].error <= max_error)
+				output = i;
+			else
+				break;
+		}
+		return output;
+	}
+
+	size_t MeshLOD::select_level_by_screen_size(float_type screen_size, float_type pixel_tolerance) const
+	{
+		if (m_diagonal_length <= 0 || screen_size <= 0)
+			return m_levels.empty() ? 0 : m_levels.size() - 1;
+
+		//error in local unit that projects to the tolerance
+		auto max_error = pixel_tolerance * m_diagonal_length / screen_size;
+		return select_level_by_error(max_error);
+	}
+}
@@ -8,10 +8,22 @@
 
 namespace _NS_UTILITY
 {
+	//barycentric coordinates of the hit points in their triangles, hits in degenerate triangles are invalidated
+	static void _compute_hit_barycentric(const fMATRIX& vertices, const iMATRIX& faces,
+		int_type* idxtri, const fMATRIX& hitpts, fMATRIX& output)
+	{
+		std::vector<uint8_t> is_degenerate;
+		compute_barycentric_in_faces(vertices, faces, idxtri, hitpts, output, &is_degenerate);
+		for (size_t i = 0; i < is_degenerate.size(); i++)
+			if (is_degenerate[i])
+				idxtri[i] = -1;
+	}
+
 	inline void MeshSearcher::update_query_structure()
 	{
 		//update trilist
-		const auto& v = m_mesh->get_vertices();
+		m_vertices = m_mesh->get_vertices();
+		const auto& v = m_vertices;
 		const auto& f = m_mesh->get_faces();
 
 		auto pts = to_point_list_3(v);
@@ -66,34 +78,17 @@ namespace _NS_UTILITY
 			idxtri[i] = res.second - m_trilist->begin();
 		}
 
-		//compute barycentric coordinate
-		// typedef CGAL::Barycentric_coordinates::Triangle_coordinates_2<KERNEL> BC_COMPUTE;
-		std::vector<POINT_3> bcpts(ptslist.size());
-		for (int i = 0; i < ptslist.size(); i++)
-		{
-			auto& tri = m_trilist->at(idxtri[i]);
-			auto& p = nnpts[i];
-			auto bc = compute_barycentric_coordinate(tri, p);
-			bcpts[i] = bc;
-		}
-
-		//invalidate the hit if barycentric coordinate is invalid
-		if (out_bc_pts) {
-			for (size_t i = 0; i < ptslist.size(); i++) {
-				auto bc = bcpts[i];
-				if (std::isnan(bc.x()) || std::isnan(bc.y()) || std::isnan(bc.z())) {
-					//invalidate the hit
-					idxtri[i] = -1;
-				}
-			}
-		}
+		//compute barycentric coordinate, and invalidate the hits in degenerate triangles
+		fMATRIX bcpts;
+		if (out_bc_pts)
+			_compute_hit_barycentric(m_vertices, m_mesh->get_faces(), idxtri.data(), to_matrix(nnpts), bcpts);
 
 		if (out_nnpts)
 			*out_nnpts = to_matrix(nnpts);
 		if (out_idxtri)
 			*out_idxtri = to_vector(idxtri);
 		if (out_bc_pts)
-			*out_bc_pts = to_matrix(bcpts);
+			*out_bc_pts = std::move(bcpts);
 	}
 
 	inline void MeshSearcher::find_closest_point(
@@ -109,12 +104,13 @@ namespace _NS_UTILITY
 		if (out_idxtri) *out_idxtri = idxtri;
 
 		if (out_barycentric) {
-			*out_barycentric = compute_barycentric_coordinate(m_trilist->at(idxtri), p_close);
-			if (std::isnan(out_barycentric->x()) || std::isnan(out_barycentric->y()) || std::isnan(out_barycentric->z())) {
-				//invalidate the hit
-				if (out_idxtri)
-					*out_idxtri = -1;
-			}
+			//the same computation as the batch query, so both give the same result
+			fMATRIX pts(1, 3), bc;
+			pts << p_close.x(), p_close.y(), p_close.z();
+			_compute_hit_barycentric(m_vertices, m_mesh->get_faces(), &idxtri, pts, bc);
+			*out_barycentric = POINT_3(bc(0, 0), bc(0, 1), bc(0, 2));
+			if (out_idxtri)
+				*out_idxtri = idxtri;
 		}
 	}
 
@@ -124,7 +120,6 @@ namespace _NS_UTILITY
 		assert_throw(p0.rows() == dirs.rows(), "number of p0 does not match number of dirs");
 		fMATRIX hitpts(p0.rows(),3);
 		iVECTOR idxtri(p0.rows());
-		fMATRIX bcpts(p0.rows(), 3);
 		for (int i = 0; i < p0.rows(); i++)
 		{
 			POINT_3 p(p0(i, 0), p0(i, 1), p0(i, 2));
@@ -137,31 +132,19 @@ namespace _NS_UTILITY
 			hitpts(i, 1) = res_point.y();
 			hitpts(i, 2) = res_point.z();
 			idxtri(i) = res_idxtri;
-
-			//compute barycentric coordinate
-			POINT_3 res_bc(0, 0, 0);
-			if (res_idxtri >= 0)
-				res_bc = compute_barycentric_coordinate(m_trilist->at(res_idxtri), res_point);
-			bcpts(i, 0) = res_bc.x();
-			bcpts(i, 1) = res_bc.y();
-			bcpts(i, 2) = res_bc.z();
 		}
 
-		//invalidate the hit if barycentric coordinate cannot be determined
-		if (out_bcpts) {
-			for (Eigen::Index i = 0; i < bcpts.rows(); i++) {
-				auto r = bcpts.row(i);
-				if (r.array().isNaN().any())
-					idxtri[i] = -1; //invalidate the hit
-			}
-		}
+		//compute barycentric coordinate, missed rays get zeros, and hits in degenerate triangles are invalidated
+		fMATRIX bcpts;
+		if (out_bcpts)
+			_compute_hit_barycentric(m_vertices, m_mesh->get_faces(), idxtri.data(), hitpts, bcpts);
 
 		if (out_hitpts)
 			*out_hitpts = hitpts;
 		if (out_idxtri)
 			*out_idxtri = idxtri;
 		if (out_bcpts)
-			*out_bcpts = bcpts;
+			*out_bcpts = std::move(bcpts);
 	}
 
 	inline void MeshSearcher::intersect_with_ray_first(const RAY_3& ray, 
@@ -189,15 +172,13 @@ namespace _NS_UTILITY
 
 		if (out_barycentric && res)
 		{
-			*out_barycentric = compute_barycentric_coordinate(m_trilist->at(res_idxtri), res_point);
-
-			//check validity
-			if (std::isnan(out_barycentric->x()) || std::isnan(out_barycentric->y()) || std::isnan(out_barycentric->z()))
-			{
-				//invalidate the hit
-				if (out_idxtri)
-					*out_idxtri = -1;
-			}
+			//the same computation as the batch query, so both give the same result
+			fMATRIX pts(1, 3), bc;
+			pts << res_point.x(), res_point.y(), res_point.z();
+			_compute_hit_barycentric(m_vertices, m_mesh->get_faces(), &res_idxtri, pts, bc);
+			*out_barycentric = POINT_3(bc(0, 0), bc(0, 1), bc(0, 2));
+			if (out_idxtri)
+				*out_idxtri = res_idxtri;
 		}
 	}
 
@@ -231,7 +212,7 @@ namespace _NS_UTILITY
 	{
 		POINT_3 _p(p[0], p[1], p[2]);
 		POINT_3 _q, _bc;
-		find_closest_point(_p, &_q, out_idxtri, &_bc);
+		find_closest_point(_p, &_q, out_idxtri, out_barycentric ? &_bc : nullptr);
 
 		if (out_closest_point)
 			*out_closest_point = fVECTOR_3(_q.x(), _q.y(), _q.z());
@@ -1,73 +1,167 @@
+#include <algorithm>
+#include <cmath>
+#include <mutex>
 #include <igcclib/geometry/SpatialQuery_2.hpp>
-#include <CGAL/Fuzzy_iso_box.h>
-#include <CGAL/Fuzzy_sphere.h>
-#include <CGAL/Orthogonal_k_neighbor_search.h>
 
 namespace _NS_UTILITY
 {
-	using QueryBox = CGAL::Fuzzy_iso_box<SpatialQuery_2::Traits>;
-	using QuerySphere = CGAL::Fuzzy_sphere<SpatialQuery_2::Traits>;
-	using NeighborSearch = CGAL::Orthogonal_k_neighbor_search<SpatialQuery_2::Traits>;
+	//the inserted points are merged into the tree when there are more than this many
+	//or more than 1/8 of the points in the tree
+	static const size_t MIN_PENDING_TO_MERGE = 256;
+
+	using ReadLock = std::shared_lock<std::shared_mutex>;
+	using WriteLock = std::unique_lock<std::shared_mutex>;
+
+	static std::shared_ptr<const FlatKDTree_2> _build_tree(const std::vector<float>& xy)
+	{
+		auto tree = std::make_shared<FlatKDTree_2>();
+		tree->init_with_points(xy.data(), xy.size() / 2);
+		return tree;
+	}
+
+	static void _append_xy(const std::vector<POINT_2>& pts, size_t n, std::vector<float>& xy)
+	{
+		xy.resize(n * 2);
+		for (size_t i = 0; i < n; i++)
+		{
+			xy[i * 2] = (float)pts[i].x();
+			xy[i * 2 + 1] = (float)pts[i].y();
+		}
+	}
 
 	SpatialQuery_2::SpatialQuery_2()
 	{
-		m_tree.reset(new KdTree());
+		m_tree = std::make_shared<FlatKDTree_2>();
 	}
 
 	void SpatialQuery_2::init_with_points(const std::vector<POINT_2>& pts)
 	{
-		m_tree.reset(new KdTree());
+		std::vector<float> xy;
+		_append_xy(pts, pts.size(), xy);
+		auto tree = _build_tree(xy);
+
+		WriteLock lock(m_mutex);
 		m_points = pts;
+		m_tree = tree;
+		m_generation++;
+	}
 
-		for (size_t i = 0; i < pts.size(); i++)
+	size_t SpatialQuery_2::insert_point(const POINT_2& p)
+	{
+		size_t idx = 0;
+		bool need_merge = false;
+		{
+			WriteLock lock(m_mutex);
+			m_points.push_back(p);
+			idx = m_points.size() - 1;
+
+			auto n_tree = m_tree->get_num_points();
+			auto n_pending = m_points.size() - n_tree;
+			need_merge = n_pending >= MIN_PENDING_TO_MERGE && n_pending * 8 >= n_tree;
+		}
+
+		//only one thread merges at a time, others keep appending to the buffer
+		bool expected = false;
+		if (need_merge && m_is_merging.compare_exchange_strong(expected, true))
 		{
-			PointWithIndex p{ pts[i], i };
-			m_tree->insert(p);
+			merge_pending_points();
+			m_is_merging = false;
 		}
+		return idx;
 	}
 
-	size_t SpatialQuery_2::insert_point(const POINT_2& p)
+	void SpatialQuery_2::merge_pending_points()
 	{
-		m_points.push_back(p);
-		m_tree->insert({ p, m_points.size() - 1 });
-		return m_points.size() - 1;
+		size_t generation = 0;
+		std::vector<float> xy;
+		{
+			ReadLock lock(m_mutex);
+			if (m_points.size() == m_tree->get_num_points())
+				return;
+			generation = m_generation;
+			_append_xy(m_points, m_points.size(), xy);
+		}
+
+		//queries and inserts continue while the tree is built
+		auto tree = _build_tree(xy);
+
+		WriteLock lock(m_mutex);
+		if (generation == m_generation && tree->get_num_points() > m_tree->get_num_points())
+			m_tree = tree;
+	}
+
+	void SpatialQuery_2::flush()
+	{
+		merge_pending_points();
+	}
+
+	size_t SpatialQuery_2::get_num_points() const
+	{
+		ReadLock lock(m_mutex);
+		return m_points.size();
+	}
+
+	std::shared_ptr<const FlatKDTree_2> SpatialQuery_2::get_index() const
+	{
+		ReadLock lock(m_mutex);
+		return m_tree;
 	}
 
 	std::vector<size_t> SpatialQuery_2::query_by_aabb(const POINT_2& minc, const POINT_2& maxc) const
 	{
-		QueryBox box(minc, maxc);
-		std::vector<PointWithIndex> _output;
-		m_tree->search(std::back_inserter(_output), box);
+		ReadLock lock(m_mutex);
+		std::vector<int_type> idx;
+		m_tree->query_aabb((float)minc.x(), (float)minc.y(), (float)maxc.x(), (float)maxc.y(), idx);
 
-		std::vector<size_t> output(_output.size());
-		for (size_t i = 0; i < _output.size(); i++)
-			output[i] = boost::get<1>(_output[i]);
+		std::vector<size_t> output(idx.begin(), idx.end());
+		for (size_t i = m_tree->get_num_points(); i < m_points.size(); i++)
+		{
+			const auto& p = m_points[i];
+			if (p.x() >= minc.x() && p.x() <= maxc.x() && p.y() >= minc.y() && p.y() <= maxc.y())
+				output.push_back(i);
+		}
 		return output;
 	}
 
 	std::vector<size_t> SpatialQuery_2::query_by_radius(const POINT_2& center, double r) const
 	{
-		QuerySphere ball(center, r);
-		std::vector<PointWithIndex> _output;
-		m_tree->search(std::back_inserter(_output), ball);
+		ReadLock lock(m_mutex);
+		std::vector<int_type> idx;
+		m_tree->query_radius((float)center.x(), (float)center.y(), (float)r, idx);
 
-		std::vector<size_t> output(_output.size());
-		for (size_t i = 0; i < _output.size(); i++)
-			output[i] = boost::get<1>(_output[i]);
+		std::vector<size_t> output(idx.begin(), idx.end());
+		for (size_t i = m_tree->get_num_points(); i < m_points.size(); i++)
+		{
+			if (CGAL::squared_distance(m_points[i], center) <= r * r)
+				output.push_back(i);
+		}
 		return output;
 	}
 
 	std::vector<size_t> SpatialQuery_2::query_by_point(const POINT_2& p, int k, std::vector<double>* out_distance/*=nullptr*/) const
 	{
-		NeighborSearch search(*m_tree, p, k);
-		std::vector<size_t> out_indices;
-		std::vector<double> out_dist;
+		ReadLock lock(m_mutex);
+		std::vector<int_type> idx(std::max(k, 0));
+		std::vector<float> dist(idx.size());
+		int n_found = m_tree->query_knn((float)p.x(), (float)p.y(), k, idx.data(), dist.data());
+
+		//merge with the inserted points, distances are computed in double precision
+		std::vector<std::pair<double, size_t>> candidates;
+		for (int i = 0; i < n_found; i++)
+			candidates.emplace_back(std::sqrt(CGAL::squared_distance(m_points[idx[i]], p)), (size_t)idx[i]);
+		for (size_t i = m_tree->get_num_points(); i < m_points.size(); i++)
+			candidates.emplace_back(std::sqrt(CGAL::squared_distance(m_points[i], p)), i);
+		lock.unlock();
 
-		for (auto it = search.begin(); it != search.end(); ++it)
+		auto n_out = std::min(candidates.size(), (size_t)std::max(k, 0));
+		std::partial_sort(candidates.begin(), candidates.begin() + n_out, candidates.end());
+
+		std::vector<size_t> out_indices(n_out);
+		std::vector<double> out_dist(n_out);
+		for (size_t i = 0; i < n_out; i++)
 		{
-			auto idx = boost::get<1>(it->first);
-			out_indices.push_back(idx);
-			out_dist.push_back(std::sqrt(std::abs(it->second)));
+			out_dist[i] = candidates[i].first;
+			out_indices[i] = candidates[i].second;
 		}
 
 		if (out_distance)
@@ -79,4 +173,10 @@ namespace _NS_UTILITY
 	{
 		return m_points;
 	}
+
+	std::vector<POINT_2> SpatialQuery_2::get_points_copy() const
+	{
+		ReadLock lock(m_mutex);
+		return m_points;
+	}
 }
@@ -1,9 +1,219 @@
+#include <algorithm>
 #include <igcclib/vision/CameraModel.hpp>
 #include <igcclib/vision/igcclib_opencv_def.hpp>
 #include <igcclib/core/igcclib_logging.hpp>
 
 
 namespace _NS_UTILITY {
+	//points per task of the parallel kernels
+	static const int POINT_BLOCK_SIZE = 4096;
+
+	//camera parameters unpacked for the native kernels
+	struct _CameraParams
+	{
+		double ext[4][4];	//right-mul extrinsic
+		double proj[3][3];	//right-mul projection
+		double fx, fy, cx, cy;
+		double skew;	//ignored by the projection like cv::projectPoints(), only used to invert the camera matrix
+		bool is_orthographic = false;
+
+		//k1,k2,p1,p2,k3,k4,k5,k6,s1,s2,s3,s4,tx,ty, missing coefficients are 0
+		double k[14];
+		bool has_distortion = false;
+
+		//tilt of the sensor, applied to column vectors like opencv
+		bool has_tilt = false;
+		double tilt[3][3];
+		double inv_tilt[3][3];
+	};
+
+	static _CameraParams _make_camera_params(const CameraModel& camera, bool with_distortion)
+	{
+		_CameraParams cp;
+		const auto& E = camera.get_extrinsic_matrix();
+		const auto& P = camera.get_projection_matrix();
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				cp.ext[i][j] = E(i, j);
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 3; j++)
+				cp.proj[i][j] = P(i, j);
+
+		//the projection matrix is the transpose of the opencv camera matrix
+		cp.fx = P(0, 0);
+		cp.fy = P(1, 1);
+		cp.cx = P(2, 0);
+		cp.cy = P(2, 1);
+		cp.skew = P(1, 0);
+		cp.is_orthographic = camera.is_orthographic();
+
+		const auto& dist = camera.get_distortion_coefficient();
+		std::fill(cp.k, cp.k + 14, 0.0);
+		if (with_distortion)
+			for (int i = 0; i < std::min<int>(14, (int)dist.size()); i++)
+				cp.k[i] = dist(i);
+		cp.has_distortion = std::any_of(cp.k, cp.k + 14, [](double x) {return x != 0; });
+
+		//see cv::detail::computeTiltProjectionMatrix()
+		cp.has_tilt = cp.k[12] != 0 || cp.k[13] != 0;
+		if (cp.has_tilt)
+		{
+			double ctx = std::cos(cp.k[12]), stx = std::sin(cp.k[12]);
+			double cty = std::cos(cp.k[13]), sty = std::sin(cp.k[13]);
+			fMATRIX_3 rot_x, rot_y, proj_z;
+			rot_x << 1, 0, 0, 0, ctx, stx, 0, -stx, ctx;
+			rot_y << cty, 0, -sty, 0, 1, 0, sty, 0, cty;
+			fMATRIX_3 rot_xy = rot_y * rot_x;
+			proj_z << rot_xy(2, 2), 0, -rot_xy(0, 2), 0, rot_xy(2, 2), -rot_xy(1, 2), 0, 0, 1;
+			fMATRIX_3 tilt = proj_z * rot_xy;
+			fMATRIX_3 inv_tilt = tilt.inverse();
+			for (int i = 0; i < 3; i++)
+				for (int j = 0; j < 3; j++)
+				{
+					cp.tilt[i][j] = tilt(i, j);
+					cp.inv_tilt[i][j] = inv_tilt(i, j);
+				}
+		}
+		return cp;
+	}
+
+	//apply the distortion to normalized coordinates, the same as cv::projectPoints()
+	template<typename T>
+	static inline void _distort(const _CameraParams& cp, T& x, T& y)
+	{
+		const double* k = cp.k;
+		T r2 = x * x + y * y;
+		T r4 = r2 * r2;
+		T r6 = r4 * r2;
+		T a1 = 2 * x * y;
+		T a2 = r2 + 2 * x * x;
+		T a3 = r2 + 2 * y * y;
+		T cdist = 1 + (T)k[0] * r2 + (T)k[1] * r4 + (T)k[4] * r6;
+		T icdist2 = 1 / (1 + (T)k[5] * r2 + (T)k[6] * r4 + (T)k[7] * r6);
+		T xd = x * cdist * icdist2 + (T)k[2] * a1 + (T)k[3] * a2 + (T)k[8] * r2 + (T)k[9] * r4;
+		T yd = y * cdist * icdist2 + (T)k[2] * a3 + (T)k[3] * a1 + (T)k[10] * r2 + (T)k[11] * r4;
+		if (cp.has_tilt)
+		{
+			const auto& t = cp.tilt;
+			T vx = (T)t[0][0] * xd + (T)t[0][1] * yd + (T)t[0][2];
+			T vy = (T)t[1][0] * xd + (T)t[1][1] * yd + (T)t[1][2];
+			T vz = (T)t[2][0] * xd + (T)t[2][1] * yd + (T)t[2][2];
+			T inv_z = vz != 0 ? 1 / vz : 1;
+			xd = vx * inv_z;
+			yd = vy * inv_z;
+		}
+		x = xd;
+		y = yd;
+	}
+
+	//invert _distort() by fixed-point iterations, the same as cv::undistortPoints()
+	template<typename T>
+	static inline void _undistort(const _CameraParams& cp, T& x, T& y, int n_iteration)
+	{
+		const double* k = cp.k;
+		if (cp.has_tilt)
+		{
+			const auto& t = cp.inv_tilt;
+			T vx = (T)t[0][0] * x + (T)t[0][1] * y + (T)t[0][2];
+			T vy = (T)t[1][0] * x + (T)t[1][1] * y + (T)t[1][2];
+			T vz = (T)t[2][0] * x + (T)t[2][1] * y + (T)t[2][2];
+			T inv_z = vz != 0 ? 1 / vz : 1;
+			x = vx * inv_z;
+			y = vy * inv_z;
+		}
+
+		T x0 = x, y0 = y;
+		for (int it = 0; it < n_iteration; it++)
+		{
+			T r2 = x * x + y * y;
+			T icdist = (1 + (((T)k[7] * r2 + (T)k[6]) * r2 + (T)k[5]) * r2) / (1 + (((T)k[4] * r2 + (T)k[1]) * r2 + (T)k[0]) * r2);
+			if (icdist < 0)
+			{
+				x = x0;
+				y = y0;
+				break;
+			}
+			T dx = 2 * (T)k[2] * x * y + (T)k[3] * (r2 + 2 * x * x) + (T)k[8] * r2 + (T)k[9] * r2 * r2;
+			T dy = (T)k[2] * (r2 + 2 * y * y) + 2 * (T)k[3] * x * y + (T)k[10] * r2 + (T)k[11] * r2 * r2;
+			x = (x0 - dx) * icdist;
+			y = (y0 - dy) * icdist;
+		}
+	}
+
+	//project points [begin,end), the i-th point is (xs[i*stride], ys[i*stride], zs[i*stride])
+	template<typename T>
+	static void _project_range(const _CameraParams& cp, int begin, int end,
+		const T* xs, const T* ys, const T* zs, ptrdiff_t stride,
+		T* out_us, T* out_vs, T* out_depths, ptrdiff_t out_stride)
+	{
+		//parameters in the working precision
+		T e[4][4], P[3][3];
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				e[r][c] = (T)cp.ext[r][c];
+		for (int r = 0; r < 3; r++)
+			for (int c = 0; c < 3; c++)
+				P[r][c] = (T)cp.proj[r][c];
+		T fx = (T)cp.fx, fy = (T)cp.fy, cx = (T)cp.cx, cy = (T)cp.cy;
+
+		for (int i = begin; i < end; i++)
+		{
+			T x = xs[i * stride], y = ys[i * stride], z = zs[i * stride];
+			T w = x * e[0][3] + y * e[1][3] + z * e[2][3] + e[3][3];
+			T px = (x * e[0][0] + y * e[1][0] + z * e[2][0] + e[3][0]) / w;
+			T py = (x * e[0][1] + y * e[1][1] + z * e[2][1] + e[3][1]) / w;
+			T pz = (x * e[0][2] + y * e[1][2] + z * e[2][2] + e[3][2]) / w;
+			if (out_depths)
+				out_depths[i * out_stride] = pz;
+
+			T u, v;
+			if (cp.is_orthographic)
+			{
+				u = px * P[0][0] + py * P[1][0] + pz * P[2][0];
+				v = px * P[0][1] + py * P[1][1] + pz * P[2][1];
+			}
+			else
+			{
+				T inv_z = pz != 0 ? 1 / pz : 1;
+				T xn = px * inv_z;
+				T yn = py * inv_z;
+				if (cp.has_distortion)
+					_distort(cp, xn, yn);
+				u = fx * xn + cx;
+				v = fy * yn + cy;
+			}
+			out_us[i * out_stride] = u;
+			out_vs[i * out_stride] = v;
+		}
+	}
+
+	//normalized undistorted coordinates of image points [begin,end), inverting _project_range()
+	template<typename T>
+	static void _undistort_range(const _CameraParams& cp, int begin, int end, int n_iteration,
+		const T* us, const T* vs, ptrdiff_t stride, T* out_xs, T* out_ys, ptrdiff_t out_stride)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			T y = (T)((vs[i * stride] - cp.cy) / cp.fy);
+			T x = (T)((us[i * stride] - cp.cx) / cp.fx);
+			if (cp.has_distortion)
+				_undistort(cp, x, y, n_iteration);
+			out_xs[i * out_stride] = x;
+			out_ys[i * out_stride] = y;
+		}
+	}
+
+	//run func(begin, end) over blocks of points in parallel
+	template<typename FUNC_T>
+	static void _parallel_for_points(int n_point, FUNC_T func)
+	{
+		int n_block = (n_point + POINT_BLOCK_SIZE - 1) / POINT_BLOCK_SIZE;
+		cv::parallel_for_(cv::Range(0, n_block), [&](const cv::Range& range) {
+			for (int b = range.start; b < range.end; b++)
+				func(b * POINT_BLOCK_SIZE, std::min(n_point, (b + 1) * POINT_BLOCK_SIZE));
+		});
+	}
+
 	void CameraModel::ray_from_projected_points(const fVECTOR_2& p, fVECTOR_3* out_ray_p0, fVECTOR_3* out_ray_dir) const
 	{
 		fMATRIX_4 transmat = m_extrinsic_matrix.inverse();
@@ -61,46 +271,117 @@ namespace _NS_UTILITY {
 
 	fMATRIX CameraModel::project_points(const fMATRIX& pts, bool with_distortion, bool preserve_z) const
 	{
-		auto n_points = pts.rows();
+		assert_throw(pts.rows() == 0 || pts.cols() == 3, "points must be nx3");
+		int n_points = (int)pts.rows();
 
-		fMATRIX _pts;
-		transform_points(pts, m_extrinsic_matrix, _pts);
-		fVECTOR zs = _pts.col(2);
+		//project directly into the output rows, the depth goes to the 3rd column
+		fMATRIX output(n_points, preserve_z ? 3 : 2);
+		auto cp = _make_camera_params(*this, with_distortion);
+		const float_type* p = pts.data();
+		float_type* q = output.data();
+		float_type* depths = preserve_z ? q + 2 : nullptr;
+		_parallel_for_points(n_points, [&](int begin, int end) {
+			_project_range(cp, begin, end, p, p + 1, p + 2, 3, q, q + 1, depths, output.cols());
+		});
+		return output;
+	}
 
-		fMATRIX output;
-		if (is_orthographic())
-		{
-			_pts *= m_projection_matrix;
-			output = _pts.leftCols(2);
-		}
-		else
-		{
-			auto cv_float_type = cv::DataType<float_type>::type;
-			cv::Mat zero_1x3(1, 3, cv_float_type, cv::Scalar::all(0));
-			cv::Mat distcoef(1, m_distortion.size(), cv_float_type, (void*)m_distortion.data());
-			cv::Mat camera_matrix(3, 3, cv_float_type);
-			Eigen::Map<fMATRIX>((float_type*)camera_matrix.data, 3, 3) = m_projection_matrix.transpose();
+	void CameraModel::project_points(int n_point, const float* xs, const float* ys, const float* zs,
+		float* out_us, float* out_vs, bool with_distortion, float* out_depths) const
+	{
+		auto cp = _make_camera_params(*this, with_distortion);
+		_parallel_for_points(n_point, [&](int begin, int end) {
+			_project_range(cp, begin, end, xs, ys, zs, 1, out_us, out_vs, out_depths, 1);
+		});
+	}
 
-			std::vector<cv::Point3d> points(n_points);
-			for (size_t i = 0; i < points.size(); i++)
-				points[i] = cv::Point3d(_pts(i, 0), _pts(i, 1), _pts(i, 2));
+	void CameraModel::undistort_points(int n_point, const float* us, const float* vs, float* out_xs, float* out_ys,
+		bool with_distortion, int n_iteration) const
+	{
+		assert_throw(!is_orthographic(), "orthographic camera has no undistortion");
+		auto cp = _make_camera_params(*this, with_distortion);
+		_parallel_for_points(n_point, [&](int begin, int end) {
+			_undistort_range(cp, begin, end, n_iteration, us, vs, 1, out_xs, out_ys, 1);
+		});
+	}
 
-			cv::Mat distort_points;
-			cv::projectPoints(points, zero_1x3, zero_1x3, camera_matrix, distcoef, distort_points);
-			distort_points.convertTo(distort_points, cv_float_type);
+	void CameraModel::make_undistortion_map(MATRIX_f& out_x, MATRIX_f& out_y, int n_iteration) const
+	{
+		assert_throw(!is_orthographic(), "orthographic camera has no undistortion");
+		assert_throw(m_width > 0 && m_height > 0, "image size is not set");
+		auto cp = _make_camera_params(*this, true);
+		out_x.resize(m_height, m_width);
+		out_y.resize(m_height, m_width);
 
-			output = Eigen::Map<fMATRIX>((float_type*)distort_points.data, points.size(), 2);
-		}
+		//one row per task, the pixel coordinates are generated on the fly
+		cv::parallel_for_(cv::Range(0, m_height), [&](const cv::Range& range) {
+			std::vector<float> us(m_width), vs(m_width);
+			for (int i = 0; i < m_width; i++)
+				us[i] = (float)i;
+			for (int r = range.start; r < range.end; r++)
+			{
+				std::fill(vs.begin(), vs.end(), (float)r);
+				_undistort_range(cp, 0, m_width, n_iteration, us.data(), vs.data(), 1,
+					&out_x(r, 0), &out_y(r, 0), 1);
+			}
+		});
+	}
 
-		if (preserve_z)
-		{
-			fMATRIX _output(output.rows(), 3);
-			_output.leftCols(2) = output;
-			_output.col(2) = zs;
-			output = _output;
-		}
-			
-		return output;
+	void CameraModel::make_distortion_map(MATRIX_f& out_map_x, MATRIX_f& out_map_y) const
+	{
+		assert_throw(!is_orthographic(), "orthographic camera has no distortion");
+		assert_throw(m_width > 0 && m_height > 0, "image size is not set");
+		auto cp = _make_camera_params(*this, true);
+		out_map_x.resize(m_height, m_width);
+		out_map_y.resize(m_height, m_width);
+
+		cv::parallel_for_(cv::Range(0, m_height), [&](const cv::Range& range) {
+			for (int r = range.start; r < range.end; r++)
+			{
+				float* mx = &out_map_x(r, 0);
+				float* my = &out_map_y(r, 0);
+				float y0 = (float)((r - cp.cy) / cp.fy);
+				for (int c = 0; c < m_width; c++)
+				{
+					float y = y0;
+					float x = (float)((c - cp.cx - cp.skew * y0) / cp.fx);
+					if (cp.has_distortion)
+						_distort(cp, x, y);
+					mx[c] = (float)(cp.fx * x + cp.cx);
+					my[c] = (float)(cp.fy * y + cp.cy);
+				}
+			}
+		});
+	}
+
+	void CameraModel::ray_from_projected_points(const fMATRIX& pts, fVECTOR_3* out_ray_p0, fMATRIX* out_ray_dirs,
+		bool with_distortion) const
+	{
+		fMATRIX_4 transmat = m_extrinsic_matrix.inverse();
+		if (out_ray_p0)
+			*out_ray_p0 = transmat.leftCols(3).bottomRows(1).transpose();
+		if (!out_ray_dirs)
+			return;
+
+		assert_throw(pts.rows() == 0 || pts.cols() == 2, "points must be nx2");
+		assert_throw(!is_orthographic(), "orthographic camera is not supported");
+		int n_points = (int)pts.rows();
+		auto cp = _make_camera_params(*this, with_distortion);
+		fMATRIX_3 rotmat = transmat.block(0, 0, 3, 3);
+
+		//normalized coordinates into the first two columns, then rotate to world in place
+		fMATRIX& dirs = *out_ray_dirs;
+		dirs.resize(n_points, 3);
+		const float_type* p = pts.data();
+		float_type* q = dirs.data();
+		_parallel_for_points(n_points, [&](int begin, int end) {
+			_undistort_range(cp, begin, end, 10, p, p + 1, 2, q, q + 1, 3);
+			for (int i = begin; i < end; i++)
+			{
+				fVECTOR_3 d = (fVECTOR_3(dirs(i, 0), dirs(i, 1), 1).transpose() * rotmat).transpose();
+				dirs.row(i) = d.normalized().transpose();
+			}
+		});
 	}
 
 	fVECTOR_2 CameraModel::project_points(const fVECTOR_3& p, bool with_distortion) const
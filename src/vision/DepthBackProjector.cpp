@@ -0,0 +1,115 @@
+#include <cmath>
+#include <igcclib/vision/DepthBackProjector.hpp>
+
+namespace _NS_UTILITY
+{
+	//multiply one row of depth with the rays, invalid depth becomes 0
+	template<typename T>
+	static void _back_project_row(const T* depth, const float* rx, const float* ry, const float* inv_norm,
+		float scale, float* out, int width)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			float z = (float)depth[x] * scale;
+			if (!std::isfinite(z))
+				z = 0;
+			if (inv_norm)
+				z *= inv_norm[x];
+			out[x * 3] = rx[x] * z;
+			out[x * 3 + 1] = ry[x] * z;
+			out[x * 3 + 2] = z;
+		}
+	}
+
+	bool DepthBackProjector::init(const CameraModel& camera, int n_iteration)
+	{
+		assert_throw(!camera.is_orthographic(), "orthographic camera is not supported");
+		int width = camera.get_image_width();
+		int height = camera.get_image_height();
+		assert_throw(width > 0 && height > 0, "image size of the camera is not set");
+
+		const auto& projmat = camera.get_projection_matrix();
+		const auto& distortion = camera.get_distortion_coefficient();
+		bool is_same = is_init() && get_width() == width && get_height() == height
+			&& m_n_iteration == n_iteration && m_projection_matrix == projmat
+			&& m_distortion.size() == distortion.size() && m_distortion == distortion;
+		if (is_same)
+			return false;
+
+		m_projection_matrix = projmat;
+		m_distortion = distortion;
+		m_n_iteration = n_iteration;
+		camera.make_undistortion_map(m_ray_x, m_ray_y, n_iteration);
+		m_ray_inv_norm = (m_ray_x.array().square() + m_ray_y.array().square() + 1).rsqrt();
+		return true;
+	}
+
+	void DepthBackProjector::back_project(const cv::Mat& depth, cv::Mat& out_xyz, double depth_scale,
+		cv::Mat* out_normals, bool is_range) const
+	{
+		assert_throw(is_init(), "the ray table is not initialized");
+		assert_throw(depth.rows == get_height() && depth.cols == get_width(), "depth image does not match the camera size");
+		int type = depth.type();
+		assert_throw(type == CV_16UC1 || type == CV_32FC1 || type == CV_64FC1, "unsupported depth type");
+
+		int height = depth.rows;
+		int width = depth.cols;
+		float scale = (float)depth_scale;
+		out_xyz.create(height, width, CV_32FC3);
+		cv::parallel_for_(cv::Range(0, height), [&](const cv::Range& range) {
+			for (int i = range.start; i < range.end; i++)
+			{
+				const float* rx = &m_ray_x(i, 0);
+				const float* ry = &m_ray_y(i, 0);
+				const float* inv_norm = is_range ? &m_ray_inv_norm(i, 0) : nullptr;
+				float* out = out_xyz.ptr<float>(i);
+				if (type == CV_16UC1)
+					_back_project_row(depth.ptr<uint16_t>(i), rx, ry, inv_norm, scale, out, width);
+				else if (type == CV_32FC1)
+					_back_project_row(depth.ptr<float>(i), rx, ry, inv_norm, scale, out, width);
+				else
+					_back_project_row(depth.ptr<double>(i), rx, ry, inv_norm, scale, out, width);
+			}
+		});
+
+		if (!out_normals)
+			return;
+
+		//normal = dy x dx, which faces the camera as the camera looks at z+ with y+ down
+		out_normals->create(height, width, CV_32FC3);
+		cv::parallel_for_(cv::Range(0, height), [&](const cv::Range& range) {
+			for (int i = range.start; i < range.end; i++)
+			{
+				cv::Vec3f* n = out_normals->ptr<cv::Vec3f>(i);
+				if (i == 0 || i == height - 1)
+				{
+					std::fill(n, n + width, cv::Vec3f(0, 0, 0));
+					continue;
+				}
+
+				const cv::Vec3f* up = out_xyz.ptr<cv::Vec3f>(i - 1);
+				const cv::Vec3f* mid = out_xyz.ptr<cv::Vec3f>(i);
+				const cv::Vec3f* down = out_xyz.ptr<cv::Vec3f>(i + 1);
+				n[0] = n[width - 1] = cv::Vec3f(0, 0, 0);
+				for (int j = 1; j < width - 1; j++)
+				{
+					bool is_valid = mid[j][2] != 0 && mid[j - 1][2] != 0 && mid[j + 1][2] != 0
+						&& up[j][2] != 0 && down[j][2] != 0;
+					cv::Vec3f dx = mid[j + 1] - mid[j - 1];
+					cv::Vec3f dy = down[j] - up[j];
+					cv::Vec3f v = dy.cross(dx);
+					float len = (float)cv::norm(v);
+					n[j] = is_valid && len > 0 ? v / len : cv::Vec3f(0, 0, 0);
+				}
+			}
+		});
+	}
+
+	fVECTOR_3 DepthBackProjector::back_project_pixel(int x, int y, double depth, bool is_range) const
+	{
+		assert_throw(is_init(), "the ray table is not initialized");
+		assert_throw(x >= 0 && x < get_width() && y >= 0 && y < get_height(), "coordinate out of range");
+		double z = is_range ? depth * m_ray_inv_norm(y, x) : depth;
+		return fVECTOR_3(m_ray_x(y, x) * z, m_ray_y(y, x) * z, z);
+	}
+}
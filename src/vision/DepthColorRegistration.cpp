@@ -0,0 +1,318 @@
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <igcclib/vision/DepthColorRegistration.hpp>
+
+namespace _NS_UTILITY
+{
+	//sample one pixel per (u,v) from the color image into out, invalid or outside pixels become 0.
+	//valid can be null, which means all pixels are valid.
+	template<typename T>
+	static void _sample_row(const cv::Mat& color, const float* us, const float* vs, const uint8_t* valid,
+		T* out, uint8_t* mask, int width, bool bilinear)
+	{
+		int n_ch = color.channels();
+		int cols = color.cols;
+		int rows = color.rows;
+		for (int x = 0; x < width; x++)
+		{
+			float u = us[x];
+			float v = vs[x];
+			T* dst = out + x * n_ch;
+
+			//also rejects nan and infinity
+			bool ok = (!valid || valid[x]) && u > -0.5f && u < cols - 0.5f && v > -0.5f && v < rows - 0.5f;
+			if (!ok)
+			{
+				for (int c = 0; c < n_ch; c++)
+					dst[c] = 0;
+				if (mask)
+					mask[x] = 0;
+				continue;
+			}
+
+			if (mask)
+				mask[x] = 255;
+
+			if (!bilinear)
+			{
+				//the same as cv::remap() with cv::INTER_NEAREST
+				const T* src = color.ptr<T>(cvRound(v)) + cvRound(u) * n_ch;
+				for (int c = 0; c < n_ch; c++)
+					dst[c] = src[c];
+				continue;
+			}
+
+			//clamp to the border so that the half pixel around the image is still sampled
+			u = std::min(std::max(u, 0.0f), (float)(cols - 1));
+			v = std::min(std::max(v, 0.0f), (float)(rows - 1));
+			int x0 = (int)u;
+			int y0 = (int)v;
+			int x1 = std::min(x0 + 1, cols - 1);
+			int y1 = std::min(y0 + 1, rows - 1);
+			float fx = u - x0;
+			float fy = v - y0;
+			const T* r0 = color.ptr<T>(y0);
+			const T* r1 = color.ptr<T>(y1);
+			for (int c = 0; c < n_ch; c++)
+			{
+				float top = r0[x0 * n_ch + c] * (1 - fx) + r0[x1 * n_ch + c] * fx;
+				float bottom = r1[x0 * n_ch + c] * (1 - fx) + r1[x1 * n_ch + c] * fx;
+				dst[c] = cv::saturate_cast<T>(top * (1 - fy) + bottom * fy);
+			}
+		}
+	}
+
+	static void _sample_row(const cv::Mat& color, const float* us, const float* vs, const uint8_t* valid,
+		cv::Mat& out_color, int row, uint8_t* mask, bool bilinear)
+	{
+		int width = out_color.cols;
+		switch (color.depth())
+		{
+		case CV_8U:
+			_sample_row(color, us, vs, valid, out_color.ptr<uint8_t>(row), mask, width, bilinear);
+			break;
+		case CV_16U:
+			_sample_row(color, us, vs, valid, out_color.ptr<uint16_t>(row), mask, width, bilinear);
+			break;
+		default:
+			_sample_row(color, us, vs, valid, out_color.ptr<float>(row), mask, width, bilinear);
+			break;
+		}
+	}
+
+	static void _check_color(const cv::Mat& color, int interpolation)
+	{
+		int depth = color.depth();
+		assert_throw(depth == CV_8U || depth == CV_16U || depth == CV_32F, "unsupported color image type");
+		assert_throw(color.channels() <= 4, "color image has too many channels");
+		assert_throw(interpolation == cv::INTER_NEAREST || interpolation == cv::INTER_LINEAR, "unsupported interpolation");
+	}
+
+	//read one row of depth as scaled float, marking 0 and non-finite depth as invalid
+	template<typename T>
+	static void _read_depth_row(const T* depth, float scale, float* out_z, uint8_t* valid, int width)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			float z = (float)depth[x] * scale;
+			valid[x] = std::isfinite(z) && z != 0;
+			out_z[x] = valid[x] ? z : 0;
+		}
+	}
+
+	static void _read_depth_row(const cv::Mat& depth, int row, float scale, float* out_z, uint8_t* valid)
+	{
+		int width = depth.cols;
+		int type = depth.type();
+		if (type == CV_16UC1)
+			_read_depth_row(depth.ptr<uint16_t>(row), scale, out_z, valid, width);
+		else if (type == CV_32FC1)
+			_read_depth_row(depth.ptr<float>(row), scale, out_z, valid, width);
+		else
+			_read_depth_row(depth.ptr<double>(row), scale, out_z, valid, width);
+	}
+
+	bool DepthColorRegistration::init(const CameraModel& depth_camera, const CameraModel& color_camera, int n_iteration)
+	{
+		assert_throw(!color_camera.is_orthographic(), "orthographic camera is not supported");
+		assert_throw(color_camera.get_image_width() > 0 && color_camera.get_image_height() > 0,
+			"image size of the color camera is not set");
+
+		//the ray table checks the depth intrinsics by itself
+		bool is_changed = m_depth_rays.init(depth_camera, n_iteration);
+
+		const auto& color_distortion = color_camera.get_distortion_coefficient();
+		const auto& cur_distortion = m_color_camera.get_distortion_coefficient();
+		bool is_same = !is_changed && is_init()
+			&& m_depth_extrinsic == depth_camera.get_extrinsic_matrix()
+			&& m_color_extrinsic == color_camera.get_extrinsic_matrix()
+			&& m_color_camera.get_projection_matrix() == color_camera.get_projection_matrix()
+			&& cur_distortion.size() == color_distortion.size() && cur_distortion == color_distortion
+			&& get_color_size() == cv::Size(color_camera.get_image_width(), color_camera.get_image_height());
+		if (is_same)
+			return false;
+
+		m_depth_extrinsic = depth_camera.get_extrinsic_matrix();
+		m_color_extrinsic = color_camera.get_extrinsic_matrix();
+		m_color_camera = color_camera;
+		m_color_camera.set_extrinsic_matrix(fMATRIX_4::Identity());
+
+		//depth camera to world, then world to color camera, all right-mul
+		fMATRIX_4 depth2color = m_depth_extrinsic.inverse() * m_color_extrinsic;
+		fMATRIX_3 rotmat = depth2color.block(0, 0, 3, 3);
+		for (int k = 0; k < 3; k++)
+			m_offset[k] = (float)depth2color(3, k);
+
+		//dir = (ray_x, ray_y, 1) * rotmat
+		const MATRIX_f& rx = m_depth_rays.get_ray_x();
+		const MATRIX_f& ry = m_depth_rays.get_ray_y();
+		MATRIX_f* dirs[3] = { &m_dir_x, &m_dir_y, &m_dir_z };
+		for (int k = 0; k < 3; k++)
+			*dirs[k] = (rx * (float)rotmat(0, k) + ry * (float)rotmat(1, k)).array() + (float)rotmat(2, k);
+		return true;
+	}
+
+	bool DepthColorRegistration::init_depth_rays(const CameraModel& depth_camera, int n_iteration)
+	{
+		bool is_changed = m_depth_rays.init(depth_camera, n_iteration);
+		if (is_changed)
+		{
+			m_dir_x.resize(0, 0);
+			m_dir_y.resize(0, 0);
+			m_dir_z.resize(0, 0);
+		}
+		return is_changed;
+	}
+
+	void DepthColorRegistration::compute_color_coordinates(const cv::Mat& depth, cv::Mat& out_xy, double depth_scale) const
+	{
+		cv::Mat empty_color;
+		register_color(depth, empty_color, empty_color, nullptr, cv::INTER_NEAREST, depth_scale, &out_xy);
+	}
+
+	fVECTOR_2 DepthColorRegistration::compute_color_coordinate(int x, int y, double depth) const
+	{
+		assert_throw(is_init(), "the registration is not initialized");
+		assert_throw(x >= 0 && x < get_width() && y >= 0 && y < get_height(), "coordinate out of range");
+
+		float u = std::numeric_limits<float>::infinity();
+		float v = u;
+		float z = (float)depth;
+		if (std::isfinite(z) && z != 0)
+		{
+			float px = m_dir_x(y, x) * z + m_offset[0];
+			float py = m_dir_y(y, x) * z + m_offset[1];
+			float pz = m_dir_z(y, x) * z + m_offset[2];
+			float cam_z = 0;
+			m_color_camera.project_points(1, &px, &py, &pz, &u, &v, true, &cam_z);
+			if (cam_z <= 0)
+				u = v = std::numeric_limits<float>::infinity();
+		}
+		return fVECTOR_2(u, v);
+	}
+
+	void DepthColorRegistration::register_color(const cv::Mat& depth, const cv::Mat& color, cv::Mat& out_color,
+		cv::Mat* out_mask, int interpolation, double depth_scale, cv::Mat* out_xy) const
+	{
+		assert_throw(is_init(), "the registration is not initialized");
+		assert_throw(depth.rows == get_height() && depth.cols == get_width(), "depth image does not match the camera size");
+		int type = depth.type();
+		assert_throw(type == CV_16UC1 || type == CV_32FC1 || type == CV_64FC1, "unsupported depth type");
+
+		//compute_color_coordinates() passes no color
+		bool has_color = !color.empty();
+		if (has_color)
+		{
+			_check_color(color, interpolation);
+			assert_throw(color.size() == get_color_size(), "color image does not match the camera size");
+			assert_throw(color.data != out_color.data, "registration cannot be done in place");
+		}
+
+		int height = depth.rows;
+		int width = depth.cols;
+		float scale = (float)depth_scale;
+		bool bilinear = interpolation == cv::INTER_LINEAR;
+		if (has_color)
+			out_color.create(height, width, color.type());
+		if (out_mask)
+			out_mask->create(height, width, CV_8UC1);
+		if (out_xy)
+			out_xy->create(height, width, CV_32FC2);
+
+		cv::parallel_for_(cv::Range(0, height), [&](const cv::Range& range) {
+			std::vector<float> zs(width), px(width), py(width), pz(width), us(width), vs(width), cam_zs(width);
+			std::vector<uint8_t> valid(width);
+			for (int i = range.start; i < range.end; i++)
+			{
+				_read_depth_row(depth, i, scale, zs.data(), valid.data());
+
+				//points in color camera coordinate
+				const float* dx = &m_dir_x(i, 0);
+				const float* dy = &m_dir_y(i, 0);
+				const float* dz = &m_dir_z(i, 0);
+				for (int j = 0; j < width; j++)
+				{
+					px[j] = dx[j] * zs[j] + m_offset[0];
+					py[j] = dy[j] * zs[j] + m_offset[1];
+					pz[j] = dz[j] * zs[j] + m_offset[2];
+				}
+				m_color_camera.project_points(width, px.data(), py.data(), pz.data(),
+					us.data(), vs.data(), true, cam_zs.data());
+
+				for (int j = 0; j < width; j++)
+				{
+					valid[j] = valid[j] && cam_zs[j] > 0;
+					if (!valid[j])
+						us[j] = vs[j] = std::numeric_limits<float>::infinity();
+				}
+
+				if (out_xy)
+				{
+					float* xy = out_xy->ptr<float>(i);
+					for (int j = 0; j < width; j++)
+					{
+						xy[j * 2] = us[j];
+						xy[j * 2 + 1] = vs[j];
+					}
+				}
+
+				if (has_color)
+					_sample_row(color, us.data(), vs.data(), valid.data(), out_color, i,
+						out_mask ? out_mask->ptr<uint8_t>(i) : nullptr, bilinear);
+				else if (out_mask)
+				{
+					uint8_t* mask = out_mask->ptr<uint8_t>(i);
+					for (int j = 0; j < width; j++)
+						mask[j] = valid[j] ? 255 : 0;
+				}
+			}
+		});
+	}
+
+	void DepthColorRegistration::remap_color(const cv::Mat& depth2color_xy, const cv::Mat& color, cv::Mat& out_color,
+		cv::Mat* out_mask, int interpolation, const cv::Mat* depth)
+	{
+		assert_throw(depth2color_xy.type() == CV_32FC2, "coordinate map should be CV_32FC2");
+		_check_color(color, interpolation);
+		assert_throw(color.data != out_color.data, "registration cannot be done in place");
+		if (depth)
+		{
+			int type = depth->type();
+			assert_throw(type == CV_16UC1 || type == CV_32FC1 || type == CV_64FC1, "unsupported depth type");
+			assert_throw(depth->size() == depth2color_xy.size(), "depth image does not match the coordinate map");
+		}
+
+		int height = depth2color_xy.rows;
+		int width = depth2color_xy.cols;
+		bool bilinear = interpolation == cv::INTER_LINEAR;
+		out_color.create(height, width, color.type());
+		if (out_mask)
+			out_mask->create(height, width, CV_8UC1);
+
+		cv::parallel_for_(cv::Range(0, height), [&](const cv::Range& range) {
+			std::vector<float> us(width), vs(width), zs;
+			std::vector<uint8_t> valid;
+			if (depth)
+			{
+				zs.resize(width);
+				valid.resize(width);
+			}
+
+			for (int i = range.start; i < range.end; i++)
+			{
+				const float* xy = depth2color_xy.ptr<float>(i);
+				for (int j = 0; j < width; j++)
+				{
+					us[j] = xy[j * 2];
+					vs[j] = xy[j * 2 + 1];
+				}
+				if (depth)
+					_read_depth_row(*depth, i, 1.0f, zs.data(), valid.data());
+				_sample_row(color, us.data(), vs.data(), depth ? valid.data() : nullptr, out_color, i,
+					out_mask ? out_mask->ptr<uint8_t>(i) : nullptr, bilinear);
+			}
+		});
+	}
+}
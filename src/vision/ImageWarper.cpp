@@ -0,0 +1,155 @@
+#include <cmath>
+#include <algorithm>
+#include <igcclib/vision/ImageWarper.hpp>
+
+namespace _NS_UTILITY
+{
+	//fill one row of the grids, stepping the homogeneous source position along the row
+	static void _fill_grid_row(const fMATRIX_3& inv_transform, int y, int width,
+		cv::Vec2s* map_xy, uint16_t* map_frac)
+	{
+		fVECTOR_3 p = inv_transform * fVECTOR_3(0, y, 1);
+		fVECTOR_3 dp = inv_transform.col(0);
+		const double tab_size = cv::INTER_TAB_SIZE;
+		const int tab_mask = cv::INTER_TAB_SIZE - 1;
+		for (int x = 0; x < width; x++, p += dp)
+		{
+			double w = p[2] != 0 ? 1.0 / p[2] : 0;
+			double sx = p[0] * w;
+			double sy = p[1] * w;
+			if (map_frac)
+			{
+				int ix = cv::saturate_cast<int>(sx * tab_size);
+				int iy = cv::saturate_cast<int>(sy * tab_size);
+				map_xy[x] = cv::Vec2s(cv::saturate_cast<short>(ix >> cv::INTER_BITS), cv::saturate_cast<short>(iy >> cv::INTER_BITS));
+				map_frac[x] = (uint16_t)((iy & tab_mask) * cv::INTER_TAB_SIZE + (ix & tab_mask));
+			}
+			else
+				map_xy[x] = cv::Vec2s(cv::saturate_cast<short>(sx), cv::saturate_cast<short>(sy));
+		}
+	}
+
+	fVECTOR_2 ImageWarper::get_source_position(const fMATRIX_3& inv_transform, double x, double y) const
+	{
+		fVECTOR_3 p = inv_transform * fVECTOR_3(x, y, 1);
+		return p.head<2>() / p[2];
+	}
+
+	bool ImageWarper::init(const fMATRIX_3& transmat, int input_width, int input_height,
+		int output_width, int output_height, int interpolation)
+	{
+		assert_throw(output_width > 0 && output_height > 0, "output size must be positive");
+		assert_throw(interpolation == cv::INTER_NEAREST || interpolation == cv::INTER_LINEAR
+			|| interpolation == cv::INTER_CUBIC || interpolation == cv::INTER_LANCZOS4, "unsupported interpolation");
+
+		//transmat is for row vectors
+		fMATRIX_3 inv_transform = transmat.transpose().inverse();
+		assert_throw(inv_transform.allFinite(), "the transform is not invertible");
+
+		//keep the grids if the source positions hardly move, which for projective transforms
+		//is checked at the corners only
+		bool is_same_setting = is_init() && interpolation == m_interpolation
+			&& m_input_size == cv::Size(input_width, input_height)
+			&& get_output_size() == cv::Size(output_width, output_height);
+		if (is_same_setting)
+		{
+			double max_shift = 0;
+			for (double y : {0, output_height - 1})
+				for (double x : {0, output_width - 1})
+				{
+					fVECTOR_2 d = get_source_position(inv_transform, x, y) - get_source_position(m_inv_transform, x, y);
+					max_shift = std::max(max_shift, d.norm());
+				}
+			if (max_shift <= m_tolerance)
+				return false;
+		}
+
+		m_transmat = transmat;
+		m_inv_transform = inv_transform;
+		m_input_size = cv::Size(input_width, input_height);
+		m_interpolation = interpolation;
+
+		m_map_xy.create(output_height, output_width, CV_16SC2);
+		if (interpolation == cv::INTER_NEAREST)
+			m_map_frac.release();
+		else
+			m_map_frac.create(output_height, output_width, CV_16UC1);
+
+		cv::parallel_for_(cv::Range(0, output_height), [&](const cv::Range& range) {
+			for (int i = range.start; i < range.end; i++)
+				_fill_grid_row(m_inv_transform, i, output_width, m_map_xy.ptr<cv::Vec2s>(i),
+					m_map_frac.empty() ? nullptr : m_map_frac.ptr<uint16_t>(i));
+		});
+		return true;
+	}
+
+	bool ImageWarper::init_rotation(double angle_rad, int width, int height, bool preserve_image_size, int interpolation)
+	{
+		fMATRIX_3 transmat;
+		int out_width, out_height;
+		compute_rotation_transform(transmat, out_width, out_height, angle_rad, width, height, preserve_image_size);
+		return init(transmat, width, height, out_width, out_height, interpolation);
+	}
+
+	void ImageWarper::apply(const cv::Mat& input, cv::Mat& output, int border_mode, const cv::Scalar& border_value) const
+	{
+		assert_throw(is_init(), "the warper is not initialized");
+		assert_throw(input.size() == m_input_size, "input size does not match the warper");
+		assert_throw(input.data != output.data, "the output cannot be the input");
+		cv::remap(input, output, m_map_xy, m_map_frac, m_interpolation, border_mode, border_value);
+	}
+
+	void ImageWarper::apply(const std::vector<cv::Mat>& inputs, std::vector<cv::Mat>& outputs,
+		int border_mode, const cv::Scalar& border_value) const
+	{
+		assert_throw(&inputs != &outputs, "the outputs cannot be the inputs");
+		outputs.resize(inputs.size());
+
+		//remap() inside a parallel task runs in the calling thread, so each frame is warped by one worker
+		cv::parallel_for_(cv::Range(0, (int)inputs.size()), [&](const cv::Range& range) {
+			for (int i = range.start; i < range.end; i++)
+				apply(inputs[i], outputs[i], border_mode, border_value);
+		});
+	}
+
+	void ImageWarper::compute_rotation_transform(fMATRIX_3& out_transmat, int& out_width, int& out_height,
+		double angle_rad, int width, int height, bool preserve_image_size)
+	{
+		//image axis is x+ right, y+ down, to rotate in ccw direction relative to screen
+		//we should actually rotate -angle
+		auto rot = Eigen::Rotation2D<float_type>(-angle_rad);
+		fMATRIX_3 tmat;
+
+		if (!preserve_image_size)
+		{
+			fMATRIX corner_points(2, 4); //each column is a point
+			corner_points.col(0) = fVECTOR_2(0, 0);
+			corner_points.col(1) = fVECTOR_2(0, height);
+			corner_points.col(2) = fVECTOR_2(width, height);
+			corner_points.col(3) = fVECTOR_2(width, 0);
+			fMATRIX rot_pts = rot.matrix() * corner_points;
+
+			//find bounding box
+			fVECTOR_2 minc = rot_pts.rowwise().minCoeff();
+			fVECTOR_2 maxc = rot_pts.rowwise().maxCoeff();
+			fVECTOR_2 boxlen = maxc - minc;
+
+			//shift the transformed image so that after rotation its corner is at (0,0)
+			auto shift = Eigen::Translation<float_type, 2>(-minc[0], -minc[1]);
+			tmat = (shift * rot).matrix();
+			out_width = (int)boxlen[0];
+			out_height = (int)boxlen[1];
+		}
+		else
+		{
+			//rotate about the center, like cv::getRotationMatrix2D()
+			fVECTOR_2 center(width / 2.0, height / 2.0);
+			auto to_center = Eigen::Translation<float_type, 2>(center);
+			tmat = (to_center * rot * to_center.inverse()).matrix();
+			out_width = width;
+			out_height = height;
+		}
+
+		out_transmat = tmat.transpose();
+	}
+}
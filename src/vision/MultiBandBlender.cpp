@@ -0,0 +1,281 @@
+#include <limits>
+#include <algorithm>
+#include <igcclib/vision/MultiBandBlender.hpp>
+#include <igcclib/vision/igcclib_opencv.hpp>
+
+namespace _NS_UTILITY
+{
+	//rows per tile of the parallel filters
+	static const int TILE_ROWS = 64;
+
+	//gaussian blur split into row tiles. Filtering a row range of a larger image reads the
+	//neighboring rows outside of the range, so the tiles give the same result as one call.
+	static void _parallel_blur(const cv::Mat& input, cv::Mat& output, double sigma)
+	{
+		assert_throw(input.data != output.data, "blur cannot be done in place");
+		output.create(input.size(), input.type());
+		int n_tile = (input.rows + TILE_ROWS - 1) / TILE_ROWS;
+		cv::parallel_for_(cv::Range(0, n_tile), [&](const cv::Range& r) {
+			for (int t = r.start; t < r.end; t++)
+			{
+				cv::Range rows(t * TILE_ROWS, std::min(input.rows, (t + 1) * TILE_ROWS));
+				cv::Mat dst = output.rowRange(rows);
+				cv::GaussianBlur(input.rowRange(rows), dst, cv::Size(0, 0), sigma);
+			}
+		});
+	}
+
+	//convert to float, integer images are assumed to be in [0,255]
+	static void _to_float(const cv::Mat& input, cv::Mat& output)
+	{
+		if (is_type_integer(input))
+			input.convertTo(output, CV_FLOAT_TYPE, 1.0 / 255);
+		else
+			input.convertTo(output, CV_FLOAT_TYPE);
+	}
+
+	void MultiBandBlender::init(cv::Size size, int n_channel, boost::optional<int> n_band, boost::optional<double> sigma)
+	{
+		assert_throw(size.width > 0 && size.height > 0, "the canvas is empty");
+		assert_throw(n_channel > 0, "number of channels must be positive");
+
+		m_n_band = n_band;
+		m_sigma = sigma;
+		m_n_channel = n_channel;
+		m_output_type = -1;
+
+		//same stopping rule as multi_band_blending()
+		int max_band = n_band ? std::max(*n_band, 1) : std::numeric_limits<int>::max();
+		m_sizes.clear();
+		m_sizes.push_back(size);
+		while ((int)m_sizes.size() < max_band)
+		{
+			const auto& cur = m_sizes.back();
+			cv::Size downsize(cur.width / 2, cur.height / 2);
+			if (downsize.width <= 5 || downsize.height <= 5)
+				break;
+			m_sizes.push_back(downsize);
+		}
+
+		//create() keeps the existing buffer if the size and type are unchanged
+		size_t n_level = m_sizes.size();
+		m_accum.resize(n_level);
+		m_weight_sum.resize(n_level);
+		m_gauss.resize(n_level);
+		m_weight.resize(n_level);
+		m_blur.resize(n_level);
+		m_wblur.resize(n_level);
+		m_up_nearest.resize(n_level);
+		m_up.resize(n_level);
+		for (size_t i = 0; i < n_level; i++)
+		{
+			m_accum[i].create(m_sizes[i], CV_MAKETYPE(CV_FLOAT_TYPE, n_channel));
+			m_weight_sum[i].create(m_sizes[i], CV_FLOAT_TYPE);
+		}
+		reset();
+	}
+
+	void MultiBandBlender::reset()
+	{
+		for (auto& x : m_accum)
+			x.setTo(0);
+		for (auto& x : m_weight_sum)
+			x.setTo(0);
+		m_output_type = -1;
+	}
+
+	double MultiBandBlender::get_sigma_down(int i) const
+	{
+		if (m_sigma)
+			return *m_sigma;
+		double scale = diagonal_length(m_sizes[i + 1]) / diagonal_length(m_sizes[i]);
+		return 2 * scale / 6.0;
+	}
+
+	double MultiBandBlender::get_sigma_up(int i) const
+	{
+		if (m_sigma)
+			return *m_sigma;
+		double scale = diagonal_length(m_sizes[i]) / diagonal_length(m_sizes[i + 1]);
+		return 2 * scale / 6.0;
+	}
+
+	void MultiBandBlender::build_pyramids(const cv::Mat& img, const cv::Mat& weight)
+	{
+		int n_level = get_num_levels();
+		_to_float(img, m_gauss[0]);
+		_to_float(weight, m_weight[0]);
+
+		//gaussian pyramids, the same as pyramid_down()
+		for (int i = 0; i < n_level - 1; i++)
+		{
+			double sigma = get_sigma_down(i);
+			_parallel_blur(m_gauss[i], m_blur[i], sigma);
+			cv::resize(m_blur[i], m_gauss[i + 1], m_sizes[i + 1], 0, 0, cv::INTER_NEAREST);
+			_parallel_blur(m_weight[i], m_wblur[i], sigma);
+			cv::resize(m_wblur[i], m_weight[i + 1], m_sizes[i + 1], 0, 0, cv::INTER_NEAREST);
+		}
+
+		//turn the image pyramid into laplacian in place, from fine to coarse so that
+		//the next level is still gaussian when it is up sampled
+		for (int i = 0; i < n_level - 1; i++)
+		{
+			cv::resize(m_gauss[i + 1], m_up_nearest[i], m_sizes[i], 0, 0, cv::INTER_NEAREST);
+			_parallel_blur(m_up_nearest[i], m_up[i], get_sigma_up(i));
+			cv::subtract(m_gauss[i], m_up[i], m_gauss[i]);
+		}
+	}
+
+	void MultiBandBlender::feed(const cv::Mat& img, const cv::Mat& weight)
+	{
+		assert_throw(!m_sizes.empty(), "the blender is not initialized");
+		assert_throw(img.size() == m_sizes[0], "the image size does not match the canvas");
+		assert_throw(img.channels() == m_n_channel, "the number of channels does not match the canvas");
+		assert_throw(is_same_size(img, weight), "weight map and image do not have the same size");
+		assert_throw(weight.channels() == 1, "weight map should have single channel");
+		assert_throw(is_type<uint8_t>(img) || is_type_floating_point(img), "unsupported image type");
+
+		if (m_output_type < 0)
+			m_output_type = img.type();
+
+		build_pyramids(img, weight);
+
+		//accumulate the weighted laplacian, tiles of all levels are processed in parallel
+		int n_ch = m_n_channel;
+		std::vector<cv::Vec2i> tiles;	//(level, first row)
+		for (int i = 0; i < get_num_levels(); i++)
+			for (int r = 0; r < m_sizes[i].height; r += TILE_ROWS)
+				tiles.emplace_back(i, r);
+
+		cv::parallel_for_(cv::Range(0, (int)tiles.size()), [&](const cv::Range& range) {
+			for (int t = range.start; t < range.end; t++)
+			{
+				int lv = tiles[t][0];
+				int r_end = std::min(m_sizes[lv].height, tiles[t][1] + TILE_ROWS);
+				int n_col = m_sizes[lv].width;
+				for (int y = tiles[t][1]; y < r_end; y++)
+				{
+					const float* lap = m_gauss[lv].ptr<float>(y);
+					const float* w = m_weight[lv].ptr<float>(y);
+					float* acc = m_accum[lv].ptr<float>(y);
+					float* wsum = m_weight_sum[lv].ptr<float>(y);
+					for (int x = 0; x < n_col; x++)
+					{
+						wsum[x] += w[x];
+						for (int c = 0; c < n_ch; c++)
+							acc[x * n_ch + c] += lap[x * n_ch + c] * w[x];
+					}
+				}
+			}
+		});
+	}
+
+	void MultiBandBlender::blend(cv::Mat& output, int output_type)
+	{
+		assert_throw(!m_sizes.empty(), "the blender is not initialized");
+		if (output_type < 0)
+			output_type = m_output_type;
+		assert_throw(output_type >= 0, "no image is fed and the output type is not given");
+
+		//normalize every level by the accumulated weight, into the scratch pyramid
+		int n_ch = m_n_channel;
+		int n_level = get_num_levels();
+		std::vector<cv::Vec2i> tiles;
+		for (int i = 0; i < n_level; i++)
+		{
+			m_gauss[i].create(m_sizes[i], CV_MAKETYPE(CV_FLOAT_TYPE, n_ch));
+			for (int r = 0; r < m_sizes[i].height; r += TILE_ROWS)
+				tiles.emplace_back(i, r);
+		}
+
+		const float eps = 1e-8f;
+		cv::parallel_for_(cv::Range(0, (int)tiles.size()), [&](const cv::Range& range) {
+			for (int t = range.start; t < range.end; t++)
+			{
+				int lv = tiles[t][0];
+				int r_end = std::min(m_sizes[lv].height, tiles[t][1] + TILE_ROWS);
+				int n_col = m_sizes[lv].width;
+				for (int y = tiles[t][1]; y < r_end; y++)
+				{
+					const float* acc = m_accum[lv].ptr<float>(y);
+					const float* wsum = m_weight_sum[lv].ptr<float>(y);
+					float* out = m_gauss[lv].ptr<float>(y);
+					for (int x = 0; x < n_col; x++)
+					{
+						float s = wsum[x] > eps ? 1.0f / wsum[x] : 0.0f;
+						for (int c = 0; c < n_ch; c++)
+							out[x * n_ch + c] = acc[x * n_ch + c] * s;
+					}
+				}
+			}
+		});
+
+		//collapse from coarse to fine, the same as pyramid_up()
+		for (int i = n_level - 2; i >= 0; i--)
+		{
+			cv::resize(m_gauss[i + 1], m_up_nearest[i], m_sizes[i], 0, 0, cv::INTER_NEAREST);
+			_parallel_blur(m_up_nearest[i], m_up[i], get_sigma_up(i));
+			cv::add(m_gauss[i], m_up[i], m_gauss[i]);
+		}
+
+		cv::Mat& recon = m_gauss[0];
+		clamp_values(recon, 0, 1);
+		if (CV_MAT_DEPTH(output_type) == CV_8U)
+			recon.convertTo(output, output_type, 255.0);
+		else
+			recon.convertTo(output, output_type);
+	}
+
+	void MultiBandBlender::blend_by_strips(cv::Mat& output,
+		const cv::Mat& img_src, const cv::Mat& img_dst, const cv::Mat& weight_src,
+		int strip_height, int margin, boost::optional<int> n_band, boost::optional<double> sigma)
+	{
+		assert_throw(is_type<uint8_t>(img_src) || is_type_floating_point(img_src), "unsupported image type");
+		assert_throw(is_same_size(img_src, img_dst), "the src and dst images do not have the same size");
+		assert_throw(is_same_format(img_src, img_dst), "the src and dst images do not have the same format");
+		assert_throw(is_same_size(weight_src, img_src), "weight map and src do not have the same size");
+		assert_throw(weight_src.channels() == 1, "weight map should have single channel");
+		assert_throw(strip_height > 0, "strip height must be positive");
+
+		if (margin < 0)
+			margin = strip_height / 2;
+
+		//strips begin at multiples of this, so that nearest down sampling picks the same rows as in the full image
+		const int align = 64;
+
+		//every strip has this height, the last ones are padded below the image, so the buffers are allocated once
+		int n_row = img_src.rows;
+		int window = std::min(n_row, (strip_height + 2 * margin + align - 1) / align * align + align);
+
+		MultiBandBlender blender;
+		blender.init(cv::Size(img_src.cols, window), img_src.channels(), n_band, sigma);
+		output.create(img_src.size(), img_src.type());
+
+		cv::Mat src, dst, w_pad, w_src, w_dst, strip_output;
+		for (int r0 = 0; r0 < n_row; r0 += strip_height)
+		{
+			int r1 = std::min(n_row, r0 + strip_height);
+			int a = std::max(0, r0 - margin);
+			a -= a % align;
+			int b = std::min(n_row, a + window);
+			cv::Range rows(a, b);
+
+			//reflected like the border of the gaussian blur
+			int pad = a + window - b;
+			int border = b - a > 1 ? cv::BORDER_REFLECT_101 : cv::BORDER_REPLICATE;
+			cv::copyMakeBorder(img_src.rowRange(rows), src, 0, pad, 0, 0, border);
+			cv::copyMakeBorder(img_dst.rowRange(rows), dst, 0, pad, 0, 0, border);
+			cv::copyMakeBorder(weight_src.rowRange(rows), w_pad, 0, pad, 0, 0, border);
+			_to_float(w_pad, w_src);
+			cv::subtract(cv::Scalar::all(1.0), w_src, w_dst);
+
+			blender.reset();
+			blender.feed(src, w_src);
+			blender.feed(dst, w_dst);
+			blender.blend(strip_output, img_src.type());
+
+			cv::Mat out_rows = output.rowRange(r0, r1);
+			strip_output.rowRange(r0 - a, r1 - a).copyTo(out_rows);
+		}
+	}
+}
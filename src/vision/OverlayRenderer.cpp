@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <igcclib/vision/OverlayRenderer.hpp>
+
+namespace _NS_UTILITY
+{
+	static cv::Scalar _to_scalar(const fVECTOR_3& color3f)
+	{
+		return cv::Scalar(color3f[0] * 255, color3f[1] * 255, color3f[2] * 255);
+	}
+
+	OverlayRenderer::OverlayRenderer()
+	{
+		set_marker_style(fVECTOR_3(0, 1, 0));
+		set_label_style(fVECTOR_3(1, 1, 1));
+	}
+
+	void OverlayRenderer::set_marker_style(const fVECTOR_3& color3f, int marker_type, int marker_size, int line_width)
+	{
+		m_marker_color = _to_scalar(color3f);
+		m_marker_size = marker_size;
+
+		//large enough for the line ends and caps
+		int half = marker_size / 2 + line_width + 1;
+		m_marker_mask = cv::Mat::zeros(2 * half + 1, 2 * half + 1, CV_8UC1);
+		cv::drawMarker(m_marker_mask, cv::Point(half, half), cv::Scalar(255), marker_type, marker_size, line_width);
+	}
+
+	void OverlayRenderer::set_box_style(const fVECTOR_3& color3f, int line_width)
+	{
+		m_box_color = _to_scalar(color3f);
+		m_box_line_width = line_width;
+	}
+
+	void OverlayRenderer::set_label_style(const fVECTOR_3& color3f, double font_scale, int thickness, int font_face)
+	{
+		m_label_color = _to_scalar(color3f);
+		m_font_scale = font_scale;
+		m_font_thickness = thickness;
+		m_font_face = font_face;
+
+		int baseline = 0;
+		m_text_height = cv::getTextSize("Ag", font_face, font_scale, thickness, &baseline).height;
+	}
+
+	void OverlayRenderer::draw_marker_stamps(cv::Mat& canvas, const fMATRIX& pts_xy) const
+	{
+		int half = m_marker_mask.cols / 2;
+		cv::Rect canvas_rect(0, 0, canvas.cols, canvas.rows);
+		for (fMATRIX::Index i = 0; i < pts_xy.rows(); i++)
+		{
+			//the stamp is clipped by the canvas
+			cv::Rect rect((int)pts_xy(i, 0) - half, (int)pts_xy(i, 1) - half, m_marker_mask.cols, m_marker_mask.rows);
+			cv::Rect clipped = rect & canvas_rect;
+			if (clipped.empty())
+				continue;
+			canvas(clipped).setTo(m_marker_color, m_marker_mask(clipped - rect.tl()));
+		}
+	}
+
+	void OverlayRenderer::render(cv::Mat& canvas, const Annotation& annotation) const
+	{
+		const auto& pts = annotation.points_xy;
+		const auto& boxes = annotation.boxes_xywh;
+		assert_throw(pts.rows() == 0 || pts.cols() == 2, "points should be Nx2");
+		assert_throw(boxes.rows() == 0 || boxes.cols() == 4, "boxes should be Nx4");
+
+		draw_marker_stamps(canvas, pts);
+		for (fMATRIX::Index i = 0; i < boxes.rows(); i++)
+		{
+			cv::Rect rect((int)boxes(i, 0), (int)boxes(i, 1), (int)boxes(i, 2), (int)boxes(i, 3));
+			cv::rectangle(canvas, rect, m_box_color, m_box_line_width);
+		}
+
+		//labels go above the boxes, or below if there is no room, otherwise to the right of the points
+		bool is_box_label = boxes.rows() > 0;
+		size_t n_label = std::min(annotation.labels.size(), (size_t)(is_box_label ? boxes.rows() : pts.rows()));
+		for (size_t i = 0; i < n_label; i++)
+		{
+			if (annotation.labels[i].empty())
+				continue;
+
+			cv::Point org;
+			if (is_box_label)
+			{
+				org = cv::Point((int)boxes(i, 0), (int)boxes(i, 1) - 3);
+				if (org.y < m_text_height)
+					org.y = (int)boxes(i, 1) + m_text_height + 3;
+			}
+			else
+				org = cv::Point((int)pts(i, 0) + m_marker_size / 2 + 2, (int)pts(i, 1) + m_text_height / 2);
+			cv::putText(canvas, annotation.labels[i], org, m_font_face, m_font_scale, m_label_color, m_font_thickness);
+		}
+	}
+
+	void OverlayRenderer::render(std::vector<cv::Mat>& frames, const std::vector<Annotation>& annotations) const
+	{
+		assert_throw(frames.size() == annotations.size(), "every frame should have its annotation");
+		cv::parallel_for_(cv::Range(0, (int)frames.size()), [&](const cv::Range& range) {
+			for (int i = range.start; i < range.end; i++)
+				render(frames[i], annotations[i]);
+		});
+	}
+
+	void OverlayRenderer::render(const std::vector<cv::Mat>& frames, const std::vector<Annotation>& annotations,
+		const std::function<void(size_t, const cv::Mat&)>& write_frame, size_t batch_size)
+	{
+		assert_throw(frames.size() == annotations.size(), "every frame should have its annotation");
+		if (batch_size == 0)
+			batch_size = 2 * (size_t)std::max(cv::getNumThreads(), 1);
+		if (m_buffers.size() < batch_size)
+			m_buffers.resize(batch_size);
+
+		for (size_t start = 0; start < frames.size(); start += batch_size)
+		{
+			size_t n = std::min(batch_size, frames.size() - start);
+
+			//copyTo() reuses the buffer if it has the same size and type as the frame
+			cv::parallel_for_(cv::Range(0, (int)n), [&](const cv::Range& range) {
+				for (int i = range.start; i < range.end; i++)
+				{
+					frames[start + i].copyTo(m_buffers[i]);
+					render(m_buffers[i], annotations[start + i]);
+				}
+			});
+
+			//the writer gets the frames in order
+			for (size_t i = 0; i < n; i++)
+				write_frame(start + i, m_buffers[i]);
+		}
+	}
+
+	void OverlayRenderer::render_to_video(cv::VideoWriter& writer, const std::vector<cv::Mat>& frames,
+		const std::vector<Annotation>& annotations, size_t batch_size)
+	{
+		assert_throw(writer.isOpened(), "video writer is not opened");
+		render(frames, annotations, [&](size_t, const cv::Mat& img) { writer.write(img); }, batch_size);
+	}
+
+	void OverlayRenderer::render_to_files(const std::vector<std::string>& filenames, const std::vector<cv::Mat>& frames,
+		const std::vector<Annotation>& annotations, size_t batch_size)
+	{
+		assert_throw(filenames.size() == frames.size(), "every frame should have its filename");
+		render(frames, annotations, [&](size_t i, const cv::Mat& img) {
+			assert_throw(cv::imwrite(filenames[i], img), "failed to write " + filenames[i]);
+		}, batch_size);
+	}
+}
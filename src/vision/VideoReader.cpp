@@ -1,36 +1,237 @@
+#include <cmath>
+#include <algorithm>
 #include <igcclib/vision/VideoReader.hpp>
 
+//raw stream reading with the keyframe flag of packets
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 6)
+	#define VIDEO_READER_WITH_KEYFRAME_FLAG
+#endif
+
 namespace _NS_UTILITY
 {
-	bool VideoReader::init_from_file(const std::string filename)
+	//without keyframe index, targets at most this far ahead are reached by decoding forward instead of seeking
+	static const int64_t MAX_FORWARD_DECODE = 32;
+
+	VideoReader::~VideoReader()
+	{
+		close();
+	}
+
+	bool VideoReader::init_from_file(const std::string filename, size_t n_prefetch)
+	{
+		close();
+		if (!m_video.open(filename))
+			return false;
+
+		m_num_frames = (size_t)m_video.get(cv::CAP_PROP_FRAME_COUNT);
+		m_fps = m_video.get(cv::CAP_PROP_FPS);
+		m_width = (int)m_video.get(cv::CAP_PROP_FRAME_WIDTH);
+		m_height = (int)m_video.get(cv::CAP_PROP_FRAME_HEIGHT);
+		m_frame_index = 0;
+		if (n_prefetch == 0)
+			return true;
+
+		build_keyframe_index(filename);
+
+		//the decoder reads into these buffers, which are reused as long as the frame size does not change
+		m_ring.resize(n_prefetch);
+		for (auto& x : m_ring)
+		{
+			x.image.create(m_height, m_width, CV_8UC3);
+			x.index = -1;
+		}
+		m_decode_next = 0;
+		m_seek_target = -1;
+		m_end = -1;
+		m_stop = false;
+		m_last_time_ms = 0;
+		m_decode_thread.reset(new std::thread([this]() { this->decode_loop(); }));
+		return true;
+	}
+
+	void VideoReader::close()
+	{
+		if (m_decode_thread)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_cv_decoder.notify_all();
+			m_decode_thread->join();
+			m_decode_thread.reset();
+		}
+
+		m_ring.clear();
+		m_keyframes.clear();
+		m_video.release();
+		m_num_frames = 0;
+		m_fps = 0;
+		m_width = m_height = 0;
+		m_frame_index = 0;
+	}
+
+	void VideoReader::build_keyframe_index(const std::string& filename)
+	{
+		m_keyframes.clear();
+#ifdef VIDEO_READER_WITH_KEYFRAME_FLAG
+		//in raw mode, grab() only reads the next packet, and every packet is a frame of the video stream
+		cv::VideoCapture raw(filename, cv::CAP_FFMPEG);
+		if (!raw.isOpened() || !raw.set(cv::CAP_PROP_FORMAT, -1))
+			return;
+		for (size_t i = 0; raw.grab(); i++)
+			if (raw.get(cv::CAP_PROP_LRF_HAS_KEY_FRAME) != 0)
+				m_keyframes.push_back(i);
+#else
+		(void)filename;
+#endif
+	}
+
+	void VideoReader::decode_loop()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		int64_t n_ring = (int64_t)m_ring.size();
+		int64_t n_ahead = get_num_ahead();
+		while (true)
+		{
+			m_cv_decoder.wait(lock, [&]() {
+				return m_stop || m_seek_target >= 0
+					|| (m_end < 0 && m_decode_next < (int64_t)m_frame_index + n_ahead);
+			});
+			if (m_stop)
+				break;
+
+			//the decoder state always follows the actual position of the video, even if
+			//the reader asked for another frame while the video was being read
+			if (m_seek_target >= 0)
+			{
+				int64_t cur = m_decode_next;
+				int64_t target = m_seek_target;
+				m_seek_target = -1;
+				lock.unlock();
+				bool ok = seek_decoder(cur, target);
+				lock.lock();
+				m_decode_next = target;
+				m_end = ok ? -1 : target;
+				m_cv_reader.notify_all();
+				continue;
+			}
+
+			//claim the slot of the next frame, which drops the frame n_ring before it
+			int64_t k = m_decode_next;
+			auto& slot = m_ring[k % n_ring];
+			slot.index = -1;
+			lock.unlock();
+			bool ok = m_video.read(slot.image);
+			double t = m_video.get(cv::CAP_PROP_POS_MSEC);
+			lock.lock();
+			if (ok)
+			{
+				slot.index = k;
+				slot.time_ms = t;
+				m_decode_next = k + 1;
+			}
+			else
+				m_end = k;
+			m_cv_reader.notify_all();
+		}
+	}
+
+	bool VideoReader::seek_decoder(int64_t cur, int64_t target)
 	{
-		return m_video.open(filename);
+		//the last keyframe at or before the target
+		int64_t key = -1;
+		auto it = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), (size_t)target);
+		if (it != m_keyframes.begin())
+			key = (int64_t)*(it - 1);
+
+		//decode forward from the current position if that does not pass a keyframe
+		bool need_seek = target < cur || (key >= 0 ? key > cur : target - cur > MAX_FORWARD_DECODE);
+		int64_t start = cur;
+		if (need_seek)
+		{
+			start = key >= 0 ? key : target;
+			if (!m_video.set(cv::CAP_PROP_POS_FRAMES, (double)start))
+				return false;
+		}
+
+		//grab() decodes without converting the frame
+		for (int64_t i = start; i < target; i++)
+			if (!m_video.grab())
+				return false;
+		return true;
 	}
 
+	bool VideoReader::read_prefetched(size_t n, cv::Mat* output)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		int64_t k = (int64_t)n;
+		auto& slot = m_ring[n % m_ring.size()];
+
+		//seek unless the frame is in the ring, or the decoder will reach it soon
+		if (slot.index != k)
+		{
+			bool is_coming = m_seek_target < 0 && m_end < 0
+				&& k >= m_decode_next && k < m_decode_next + get_num_ahead();
+			if (!is_coming)
+			{
+				m_seek_target = k;
+				m_end = -1;
+			}
+		}
+		m_frame_index = n;
+		m_cv_decoder.notify_all();
+
+		m_cv_reader.wait(lock, [&]() {
+			return slot.index == k || (m_seek_target < 0 && m_end >= 0 && k >= m_end);
+		});
+		if (slot.index != k)
+			return false;
+
+		if (output)
+			slot.image.copyTo(*output);
+		m_last_time_ms = slot.time_ms;
+		m_frame_index = n + 1;
+		m_cv_decoder.notify_all();
+		return true;
+	}
 
 	size_t VideoReader::get_num_frames() const
 	{
-		if (m_video.isOpened())
-			return m_video.get(cv::VideoCaptureProperties::CAP_PROP_FRAME_COUNT);
-		else
-			return 0;
+		return m_num_frames;
 	}
 
 	double VideoReader::get_frame_rate() const
 	{
-		if (m_video.isOpened())
-			return 0;
-		else
-			return m_video.get(cv::VideoCaptureProperties::CAP_PROP_FPS);
+		return m_fps;
 	}
 
 	void VideoReader::begin_sequential_read()
 	{
-		m_video.set(cv::VideoCaptureProperties::CAP_PROP_POS_FRAMES, 0);
+		if (!is_prefetching())
+		{
+			m_video.set(cv::VideoCaptureProperties::CAP_PROP_POS_FRAMES, 0);
+			return;
+		}
+
+		//start decoding from the first frame right away
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_frame_index = 0;
+			if (m_ring[0].index != 0)
+			{
+				m_seek_target = 0;
+				m_end = -1;
+			}
+		}
+		m_cv_decoder.notify_all();
 	}
 
 	bool VideoReader::read_next_frame(cv::Mat* output)
 	{
+		if (is_prefetching())
+			return read_prefetched(m_frame_index, output);
+
 		if (output && m_video.isOpened())
 		{
 			return m_video.read(*output);
@@ -43,6 +244,10 @@ namespace _NS_UTILITY
 		if (!output)
 			return false;
 
+		//the video belongs to the decoding thread while prefetching
+		if (is_prefetching())
+			return read_prefetched(n, output);
+
 		assert_throw(m_video.isOpened(), "no video is opened");
 		assert_throw(m_video.set(cv::CAP_PROP_POS_FRAMES, n), "failed to seek the frame");
 		return m_video.read(*output);
@@ -53,6 +258,12 @@ namespace _NS_UTILITY
 		if (!output)
 			return false;
 
+		if (is_prefetching())
+		{
+			assert_throw(m_fps > 0, "frame rate is unknown");
+			return read_prefetched((size_t)std::max(0.0, std::round(t_sec * m_fps)), output);
+		}
+
 		assert_throw(m_video.isOpened(), "no video is opened");
 		m_video.set(cv::CAP_PROP_POS_MSEC, t_sec * 1000);
 		return m_video.read(*output);
@@ -60,24 +271,28 @@ namespace _NS_UTILITY
 
 	int VideoReader::get_frame_width() const
 	{
-		return m_video.get(cv::CAP_PROP_FRAME_WIDTH);
+		return m_width;
 	}
 
 	int VideoReader::get_frame_height() const
 	{
-		return m_video.get(cv::CAP_PROP_FRAME_HEIGHT);
+		return m_height;
 	}
 
 	double VideoReader::get_current_time_ms() const
 	{
+		if (is_prefetching())
+			return m_last_time_ms;
 		assert_throw(m_video.isOpened(), "no video is opened");
 		return m_video.get(cv::CAP_PROP_POS_MSEC);
 	}
 
 	size_t VideoReader::get_current_frame_index() const
 	{
+		if (is_prefetching())
+			return m_frame_index;
 		assert_throw(m_video.isOpened(), "no video is opened");
 		return (size_t)m_video.get(cv::CAP_PROP_POS_FRAMES);
 	}
 
-}
\ No newline at end of file
+}
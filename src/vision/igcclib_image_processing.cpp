@@ -2,62 +2,28 @@
 #include <cmath>
 
 #include <igcclib/vision/igcclib_image_processing.hpp>
+#include <igcclib/vision/ImageWarper.hpp>
 
 namespace _NS_UTILITY {
 	void rotate_image(cv::Mat& output, fMATRIX_3* out_transmat, 
 		const cv::Mat& input_image, double angle_rad, bool preserve_image_size /*= false*/)
 	{
-		auto height = input_image.rows;
-		auto width = input_image.cols;
-
-		//compose transformation matrix
-		if(!preserve_image_size)
-		{
-			fMATRIX corner_points(2, 4); //each column is a point
-			corner_points.col(0) = fVECTOR_2(0, 0);
-			corner_points.col(1) = fVECTOR_2(0, height);
-			corner_points.col(2) = fVECTOR_2(width, height);
-			corner_points.col(3) = fVECTOR_2(width, 0);
-
-			//image axis is x+ right, y+ down, to rotate in ccw direction relative to screen
-			//we should actually rotate -angle
-			auto rot = Eigen::Rotation2D<float_type>(-angle_rad);
-			fMATRIX rot_pts = rot.matrix() * corner_points;
-			
-			//find bounding box
-			fVECTOR_2 minc = rot_pts.rowwise().minCoeff();
-			fVECTOR_2 maxc = rot_pts.rowwise().maxCoeff();
-			fVECTOR_2 boxlen = maxc - minc;
-
-			//compute shift, to shift the transformed image so that after rotation its corner is at (0,0)
-			auto shift = Eigen::Translation<float_type, 2>(-minc[0], -minc[1]);
-
-			//compose the matrix
-			fMATRIX_3 tmat = (shift * rot).matrix();
-
-			cv::Mat cv_transmat(3, 3, cv::DataType<float_type>::type, tmat.data());
-			cv::Size newsize((int)boxlen[0], (int)boxlen[1]);
-
+		fMATRIX_3 transmat;
+		int out_width, out_height;
+		ImageWarper::compute_rotation_transform(transmat, out_width, out_height,
+			angle_rad, input_image.cols, input_image.rows, preserve_image_size);
+
+		//opencv uses column vectors
+		fMATRIX_3 tmat = transmat.transpose();
+		cv::Mat cv_transmat(3, 3, cv::DataType<float_type>::type, tmat.data());
+		cv::Size newsize(out_width, out_height);
+		if (preserve_image_size)
+			cv::warpAffine(input_image, output, cv_transmat.rowRange(0, 2), newsize);
+		else
 			cv::warpPerspective(input_image, output, cv_transmat, newsize);
 
-			if (out_transmat)
-				*out_transmat = tmat.transpose();
-		}
-		else {
-			cv::Point2f center(float(width / 2.0), float(height / 2.0));
-
-			auto pi = std::acos(-1.0);
-			auto rotmat = cv::getRotationMatrix2D(center, angle_rad / pi * 180, 1.0);
-			cv::warpAffine(input_image, output, rotmat, cv::Size(input_image.cols, input_image.rows));
-
-			if (out_transmat)
-			{
-				out_transmat->setIdentity();
-				rotmat.convertTo(rotmat, cv::DataType<float_type>::type);
-				out_transmat->block(0, 0, 2, 3) = Eigen::Map<fMATRIX>((float_type*)rotmat.data, 2, 3);
-				out_transmat->transposeInPlace();
-			}
-		}
+		if (out_transmat)
+			*out_transmat = transmat;
 	}
 
 	void scale_pixel_rect(iVECTOR_4& inout_xywh, int width, int height, double scale, bool force_square /*= false*/)
@@ -251,11 +217,172 @@ namespace _NS_UTILITY {
 		}
 		int idxmax = std::max_element(areas.begin(), areas.end()) - areas.begin();
 
-		output->create(input.rows, input.cols, CV_8UC1);
-		output->setTo(0);
-		for (int i = 0; i < lbmap.total(); i++)
-			if (lbmap.at<int>(i) == idxmax)
-				output->at<uint8_t>(i) = 255;
+		//no foreground at all
+		if (ncomp <= 1)
+		{
+			output->create(input.rows, input.cols, CV_8UC1);
+			output->setTo(0);
+			return;
+		}
+		cv::compare(lbmap, idxmax, *output, cv::CMP_EQ);
+	}
+
+	void get_largest_connected_component_tiled(const cv::Mat& input, cv::Mat* output, int connectivity /*= 8*/, int strip_height /*= 1024*/)
+	{
+		if (!output)
+			return;
+
+		assert_throw(input.channels() == 1, "input must be a single-channel image");
+		assert_throw(connectivity == 4 || connectivity == 8, "connectivity must be 4 or 8");
+		assert_throw(strip_height > 0, "strip height must be positive");
+
+		int n_row = input.rows;
+		int n_col = input.cols;
+		int n_strip = (n_row + strip_height - 1) / strip_height;
+		auto label_strip = [&](int s, cv::Mat& mask, cv::Mat& lbmap, cv::Mat& stats) {
+			cv::Mat centroids;
+			int r0 = s * strip_height;
+			cv::compare(input.rowRange(r0, std::min(n_row, r0 + strip_height)), 0, mask, cv::CMP_GT);
+			return cv::connectedComponentsWithStats(mask, lbmap, stats, centroids, connectivity, CV_32S);
+		};
+
+		//label the strips independently, keeping only the areas and the labels of the first and last rows
+		std::vector<std::vector<int>> strip_areas(n_strip);
+		std::vector<cv::Mat> first_rows(n_strip), last_rows(n_strip);
+		cv::parallel_for_(cv::Range(0, n_strip), [&](const cv::Range& range) {
+			cv::Mat mask, lbmap, stats;
+			for (int s = range.start; s < range.end; s++)
+			{
+				int ncomp = label_strip(s, mask, lbmap, stats);
+				auto& areas = strip_areas[s];
+				areas.assign(ncomp, 0);
+				for (int i = 1; i < ncomp; i++)
+					areas[i] = stats.at<int>(i, cv::CC_STAT_AREA);
+				first_rows[s] = lbmap.row(0).clone();
+				last_rows[s] = lbmap.row(lbmap.rows - 1).clone();
+			}
+		});
+
+		//global label = offset of the strip + local label
+		std::vector<int> offsets(n_strip + 1, 0);
+		for (int s = 0; s < n_strip; s++)
+			offsets[s + 1] = offsets[s] + (int)strip_areas[s].size();
+
+		//merge the components touching across strip borders by union-find
+		std::vector<int> parent(offsets.back());
+		std::iota(parent.begin(), parent.end(), 0);
+		auto find_root = [&](int x) {
+			while (parent[x] != x)
+			{
+				parent[x] = parent[parent[x]];
+				x = parent[x];
+			}
+			return x;
+		};
+
+		int dx_max = connectivity == 8 ? 1 : 0;
+		for (int s = 0; s + 1 < n_strip; s++)
+		{
+			const int* up = last_rows[s].ptr<int>(0);
+			const int* down = first_rows[s + 1].ptr<int>(0);
+			for (int x = 0; x < n_col; x++)
+			{
+				if (!up[x])
+					continue;
+				for (int dx = -dx_max; dx <= dx_max; dx++)
+				{
+					int xx = x + dx;
+					if (xx < 0 || xx >= n_col || !down[xx])
+						continue;
+					int a = find_root(offsets[s] + up[x]);
+					int b = find_root(offsets[s + 1] + down[xx]);
+					if (a != b)
+						parent[std::max(a, b)] = std::min(a, b);
+				}
+			}
+		}
+
+		//total area of each merged component
+		std::vector<int64_t> total_area(parent.size(), 0);
+		std::vector<int> roots(parent.size());
+		for (int s = 0; s < n_strip; s++)
+			for (int i = 1; i < (int)strip_areas[s].size(); i++)
+			{
+				int g = offsets[s] + i;
+				roots[g] = find_root(g);
+				total_area[roots[g]] += strip_areas[s][i];
+			}
+
+		//ties are broken by the smallest label, which is the component found first in scan order
+		int best = -1;
+		int64_t best_area = 0;
+		for (int g = 0; g < (int)total_area.size(); g++)
+			if (total_area[g] > best_area)
+			{
+				best = g;
+				best_area = total_area[g];
+			}
+
+		output->create(n_row, n_col, CV_8UC1);
+		if (best < 0)
+		{
+			output->setTo(0);
+			return;
+		}
+
+		//label the strips again and keep the pixels of the largest component
+		cv::parallel_for_(cv::Range(0, n_strip), [&](const cv::Range& range) {
+			cv::Mat mask, lbmap, stats;
+			std::vector<uint8_t> lut;
+			for (int s = range.start; s < range.end; s++)
+			{
+				int ncomp = label_strip(s, mask, lbmap, stats);
+				lut.assign(ncomp, 0);
+				for (int i = 1; i < ncomp; i++)
+					if (roots[offsets[s] + i] == best)
+						lut[i] = 255;
+
+				for (int y = 0; y < lbmap.rows; y++)
+				{
+					const int* lb = lbmap.ptr<int>(y);
+					uint8_t* dst = output->ptr<uint8_t>(s * strip_height + y);
+					for (int x = 0; x < n_col; x++)
+						dst[x] = lut[lb[x]];
+				}
+			}
+		});
+	}
+
+	void distance_transform_tiled(const cv::Mat& mask, cv::Mat& output, double max_distance,
+		bool zero_as_empty_space /*= false*/, int strip_height /*= 512*/)
+	{
+		assert_throw(mask.channels() == 1, "mask must be a single-channel image");
+		assert_throw(max_distance > 0, "max distance must be positive");
+		assert_throw(strip_height > 0, "strip height must be positive");
+
+		int n_row = mask.rows;
+		int margin = (int)std::ceil(max_distance);
+		int n_strip = (n_row + strip_height - 1) / strip_height;
+		output.create(mask.size(), CV_32F);
+
+		//the nearest obstacle within max_distance is at most margin rows away,
+		//so it is always inside the extended strip
+		cv::parallel_for_(cv::Range(0, n_strip), [&](const cv::Range& range) {
+			cv::Mat empty_space_mask, distmap;
+			for (int s = range.start; s < range.end; s++)
+			{
+				int r0 = s * strip_height;
+				int r1 = std::min(n_row, r0 + strip_height);
+				int a = std::max(0, r0 - margin);
+				int b = std::min(n_row, r1 + margin);
+
+				cv::compare(mask.rowRange(a, b), 0, empty_space_mask, zero_as_empty_space ? cv::CMP_EQ : cv::CMP_NE);
+				cv::distanceTransform(empty_space_mask, distmap, cv::DIST_L2, cv::DIST_MASK_PRECISE, CV_32F);
+
+				cv::Mat dst = output.rowRange(r0, r1);
+				cv::min(distmap.rowRange(r0 - a, r1 - a), max_distance, dst);
+			}
+		});
 	}
 
 	void pyramid_up(cv::Mat& output, const cv::Mat& img, cv::Size upsize, boost::optional<double> _sigma /*= boost::none*/)
@@ -4,6 +4,11 @@
 // #include <catch2/matchers/catch_matchers_vector.hpp>
 #include <catch2/matchers/catch_matchers_all.hpp>
 #include <igcclib/core/igcclib_common.hpp>
+#include <igcclib/core/ImageResizer.hpp>
+#include <igcclib/geometry/igcclib_geometry.hpp>
+#include <igcclib/geometry/MeanValueCage_2.hpp>
+#include <igcclib/extern/splinter/bspline.h>
+#include <igcclib/math/interp_nd.hpp>
 #include <spdlog/spdlog.h>
 
 using Catch::Matchers::RangeEquals;
@@ -22,4 +27,383 @@ TEST_CASE("test something from core", "[core]") {
     REQUIRE(test_sort_string({"1", "10", "2"}) == std::vector<std::string>{"1", "2", "10"});
     REQUIRE_THAT(igcclib::linspace<double>(0, 1, 5), RangeEquals(std::vector<double>{0, 0.25, 0.5, 0.75, 1.0}, predicate_float_equal));
     REQUIRE_THAT(igcclib::linspace<int>(0,10,5), RangeEquals(std::vector<int>{0,2,4,6,8}));
-}
\ No newline at end of file
+}
+
+TEST_CASE("barycentric coordinates in faces", "[core]") {
+    using namespace igcclib;
+
+    // two triangles, the second one is degenerate (collinear)
+    fMATRIX vertices(6, 3);
+    vertices << 0, 0, 0,   2, 0, 0,   0, 3, 1,
+                0, 0, 0,   1, 1, 1,   2, 2, 2;
+    iMATRIX faces(2, 3);
+    faces << 0, 1, 2,  3, 4, 5;
+
+    fMATRIX pts(4, 3);
+    pts << 0.5, 0.5, 0.2,   1.0, 1.5, 0.5,   0.4, 0.6, 0.5,   9, 9, 9;
+    std::vector<int_type> idxfaces{0, 0, 1, -1};
+
+    fMATRIX bc;
+    std::vector<uint8_t> is_degenerate;
+    igcclib::compute_barycentric_in_faces(vertices, faces, idxfaces.data(), pts, bc, &is_degenerate);
+    REQUIRE(bc.rows() == 4);
+    REQUIRE_FALSE(bc.array().isNaN().any());
+    REQUIRE(is_degenerate == std::vector<uint8_t>{0, 0, 1, 0});
+
+    // regular triangle, compared with the least squares solution in double precision
+    for (int i = 0; i < 2; i++) {
+        fMATRIX_3 tri = vertices.topRows(3);
+        Eigen::Matrix<double, 3, 2> edges;
+        edges.col(0) = (tri.row(1) - tri.row(0)).transpose();
+        edges.col(1) = (tri.row(2) - tri.row(0)).transpose();
+        Eigen::Vector2d vw = edges.colPivHouseholderQr().solve((pts.row(i) - tri.row(0)).transpose());
+        REQUIRE_THAT(bc(i, 0), WithinAbs(1 - vw.sum(), 1e-5));
+        REQUIRE_THAT(bc(i, 1), WithinAbs(vw(0), 1e-5));
+        REQUIRE_THAT(bc(i, 2), WithinAbs(vw(1), 1e-5));
+    }
+
+    // degenerate triangle, the point is projected to the longest edge, from vertex 5 to vertex 3
+    REQUIRE_THAT(bc.row(2).sum(), WithinAbs(1.0, 1e-6));
+    REQUIRE_THAT(bc(2, 1), WithinAbs(0.0, 1e-6));
+    REQUIRE_THAT(bc(2, 0), WithinAbs(0.75, 1e-5));
+
+    // skipped points are zero
+    REQUIRE(bc.row(3).isZero());
+}
+
+// bilinear resize like cv::resize() with INTER_LINEAR, in double precision
+static igcclib::MATRIX_d resize_bilinear_reference(const igcclib::MATRIX_d& src, int width, int height) {
+    auto taps = [](int i, int src_len, int dst_len, int* idx, double* w) {
+        double c = (i + 0.5) * src_len / dst_len - 0.5;
+        int i0 = (int)std::floor(c);
+        w[1] = c - i0;
+        w[0] = 1 - w[1];
+        idx[0] = std::min(std::max(i0, 0), src_len - 1);
+        idx[1] = std::min(std::max(i0 + 1, 0), src_len - 1);
+    };
+
+    igcclib::MATRIX_d dst = igcclib::MATRIX_d::Zero(height, width);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++) {
+            int iy[2], ix[2];
+            double wy[2], wx[2];
+            taps(y, (int)src.rows(), height, iy, wy);
+            taps(x, (int)src.cols(), width, ix, wx);
+            for (int a = 0; a < 2; a++)
+                for (int b = 0; b < 2; b++)
+                    dst(y, x) += wy[a] * wx[b] * src(iy[a], ix[b]);
+        }
+    return dst;
+}
+
+TEST_CASE("image resizer", "[core]") {
+    using namespace igcclib;
+    std::srand(0);
+
+    const int src_width = 13, src_height = 9;
+    igcclib::ImageRGBA_d img;
+    img.set_RGB(MATRIX_d::Random(src_height, src_width) * 100,
+        MATRIX_d::Random(src_height, src_width) * 100,
+        MATRIX_d::Random(src_height, src_width) * 100);
+    MATRIX_u8 gray = ((img.r.array() + 100) * 1.275).round().cast<uint8_t>();
+
+    ImageResizer resizer;
+    for (auto size : std::vector<std::pair<int, int>>{{29, 20}, {5, 4}, {13, 9}, {7, 17}}) {
+        int width = size.first, height = size.second;
+        resizer.init(src_width, src_height, width, height, ImageResizer::Method::BILINEAR);
+
+        // double images are filtered in double precision
+        ImageRGBA_d output;
+        resizer.resize(img, output);
+        REQUIRE(output.get_number_of_channels() == 3);
+        for (int c = 0; c < 3; c++) {
+            MATRIX_d expected = resize_bilinear_reference(img.get_channel(c), width, height);
+            REQUIRE((output.get_channel(c) - expected).cwiseAbs().maxCoeff() < 1e-9);
+        }
+
+        // 8-bit images are rounded from the float sums
+        MATRIX_u8 gray_output(height, width);
+        resizer.resize(ImageView_t<const uint8_t>::from_interleaved(gray.data(), src_width, src_height, 1),
+            ImageView_t<uint8_t>::from_interleaved(gray_output.data(), width, height, 1));
+        MATRIX_d gray_expected = resize_bilinear_reference(gray.cast<double>(), width, height);
+        REQUIRE((gray_output.cast<double>() - gray_expected.array().round().matrix()).cwiseAbs().maxCoeff() <= 1);
+
+        // resizing into itself gives the same result
+        ImageRGBA_d inplace = img;
+        resizer.resize(inplace, inplace);
+        for (int c = 0; c < 3; c++)
+            REQUIRE(inplace.get_channel(c) == output.get_channel(c));
+    }
+}
+
+TEST_CASE("batch evaluation of splinter b-spline", "[core]") {
+    // cubic in x and quadratic in y, with interior knots
+    std::vector<std::vector<double>> knots{
+        {0, 0, 0, 0, 0.3, 0.5, 1, 1, 1, 1},
+        {0, 0, 0, 0.4, 1, 1, 1}};
+    std::srand(1);
+    Eigen::VectorXd coefs = Eigen::VectorXd::Random(6 * 4);
+    SPLINTER::BSpline spline(coefs, knots, {3, 2});
+
+    // random points, the corners of the domain and a point on the interior knots
+    Eigen::MatrixXd pts = (Eigen::MatrixXd::Random(50, 2).array() + 1) / 2;
+    pts.row(0) << 0, 0;
+    pts.row(1) << 1, 1;
+    pts.row(2) << 0, 1;
+    pts.row(3) << 0.5, 0.4;
+
+    // the batch evaluation is compared with the per-point evaluation through sparse basis products
+    Eigen::VectorXd values = spline.evalBatch(pts);
+    Eigen::MatrixXd jacobians = spline.evalJacobianBatch(pts);
+    REQUIRE(values.size() == pts.rows());
+    REQUIRE(jacobians.rows() == pts.rows());
+    REQUIRE(jacobians.cols() == 2);
+    for (Eigen::Index i = 0; i < pts.rows(); i++) {
+        Eigen::VectorXd x = pts.row(i).transpose();
+        REQUIRE_THAT(values[i], WithinAbs(spline.eval(x), 1e-12));
+        Eigen::MatrixXd jac = spline.evalJacobian(x);
+        REQUIRE_THAT(jacobians(i, 0), WithinAbs(jac(0, 0), 1e-10));
+        REQUIRE_THAT(jacobians(i, 1), WithinAbs(jac(0, 1), 1e-10));
+    }
+}
+
+TEST_CASE("batch multilinear interpolation", "[core]") {
+    using Interp = igcclib::InterpMultilinear<3, double, double>;
+    std::srand(2);
+
+    // a uniform grid whose step is not exact in floating point, and a non-uniform one
+    std::vector<std::vector<double>> uniform_grids{
+        igcclib::linspace<double>(-1, 2.3, 34), igcclib::linspace<double>(0, 1, 7), igcclib::linspace<double>(0.1, 0.7, 13)};
+    std::vector<std::vector<double>> nonuniform_grids = uniform_grids;
+    nonuniform_grids[1] = {0, 0.05, 0.3, 0.31, 0.8, 1};
+
+    for (const auto& grids : {uniform_grids, nonuniform_grids}) {
+        std::vector<int> grid_len;
+        size_t n_value = 1;
+        for (const auto& g : grids) {
+            grid_len.push_back((int)g.size());
+            n_value *= g.size();
+        }
+        Eigen::VectorXd values = Eigen::VectorXd::Random(n_value);
+        Interp interp(grids.begin(), grid_len.begin(), values.data(), values.data() + values.size());
+        REQUIRE(interp.is_uniform_grid() == (grids == uniform_grids));
+
+        // the cell lookup is the same as the binary search, including the grid points
+        for (int dim = 0; dim < 3; dim++) {
+            std::vector<double> xs = grids[dim];
+            for (int k = 0; k < 200; k++)
+                xs.push_back(grids[dim].front() - 0.2 + (grids[dim].back() - grids[dim].front() + 0.4) * k / 199);
+            for (double x : xs) {
+                int expected = (int)(std::upper_bound(grids[dim].begin(), grids[dim].end(), x) - grids[dim].begin()) - 1;
+                REQUIRE(interp.find_cell(dim, x) == expected);
+            }
+        }
+
+        // points inside and outside of the grid, compared with the recursive interpolation
+        Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> pts(2000, 3);
+        for (int dim = 0; dim < 3; dim++) {
+            double lo = grids[dim].front(), hi = grids[dim].back();
+            pts.col(dim) = (Eigen::VectorXd::Random(pts.rows()).array() + 1) / 2 * (hi - lo + 0.4) + lo - 0.2;
+        }
+        pts.row(0) << grids[0][3], grids[1][2], grids[2][5];
+        std::vector<double> batch(pts.rows());
+        interp.interp_batch((int)pts.rows(), pts.data(), batch.data());
+        for (Eigen::Index i = 0; i < pts.rows(); i++)
+            REQUIRE_THAT(batch[i], WithinAbs(interp.interp(pts.row(i).data()), 1e-12));
+    }
+}
+
+TEST_CASE("image view conversions", "[core]") {
+    using namespace igcclib;
+    std::srand(3);
+    const int width = 37, height = 23;
+
+    // a double image in [0,1] with an alpha channel, and the same values as an interleaved uint8 buffer
+    ImageRGBA_d img;
+    img.set_RGBA(MATRIX_d::Random(height, width).cwiseAbs(), MATRIX_d::Random(height, width).cwiseAbs(),
+        MATRIX_d::Random(height, width).cwiseAbs(), MATRIX_d::Random(height, width).cwiseAbs());
+    std::vector<uint8_t> pixels((size_t)width * height * 3);
+    for (auto& p : pixels)
+        p = (uint8_t)(std::rand() % 256);
+
+    // to_linear_buffer(), compared with the old per-element normalization, rounded for integer outputs
+    std::vector<uint8_t> buffer_u8;
+    std::vector<float> buffer_f;
+    img.to_linear_buffer(buffer_u8, 0, 1, 0, 255);
+    img.to_linear_buffer(buffer_f, 0, 1, -1, 1);
+    REQUIRE(buffer_u8.size() == (size_t)width * height * 4);
+    for (int i = 0; i < width * height; i++)
+        for (int k = 0; k < 4; k++) {
+            double v = img.get_channel(k)(i);
+            REQUIRE(buffer_u8[i * 4 + k] == (uint8_t)std::round(v * 255));
+            REQUIRE_THAT(buffer_f[i * 4 + k], WithinAbs(v * 2 - 1, 1e-6));
+        }
+
+    // from_linear_buffer() and back
+    ImageRGBA_d from_u8;
+    from_u8.from_linear_buffer(pixels, width, height, 3, 0, 255, 0, 1);
+    REQUIRE(from_u8.get_number_of_channels() == 3);
+    for (int i = 0; i < width * height; i++)
+        for (int k = 0; k < 3; k++)
+            REQUIRE_THAT(from_u8.get_channel(k)(i), WithinAbs(pixels[i * 3 + k] / 255.0, 1e-12));
+    std::vector<uint8_t> round_trip;
+    from_u8.to_linear_buffer(round_trip, 0, 1, 0, 255);
+    REQUIRE(round_trip == pixels);
+
+    // a gray image with alpha is stored as two channels, gray and alpha
+    ImageRGBA_d gray;
+    gray.set_gray(MATRIX_d::Random(height, width).cwiseAbs(), MATRIX_d::Random(height, width).cwiseAbs());
+    std::vector<double> buffer_gray;
+    gray.to_linear_buffer(buffer_gray, 0, 1, 0, 1);
+    REQUIRE(buffer_gray.size() == (size_t)width * height * 2);
+    for (int i = 0; i < width * height; i++) {
+        REQUIRE(buffer_gray[i * 2] == gray.get_channel(0)(i));
+        REQUIRE(buffer_gray[i * 2 + 1] == gray.get_channel(3)(i));
+    }
+
+    // copy between a region of a padded interleaved buffer and the planes
+    const ptrdiff_t row_stride = width * 3 + 5;
+    std::vector<uint8_t> padded((size_t)row_stride * height, 0);
+    for (int y = 0; y < height; y++)
+        std::copy(pixels.begin() + y * width * 3, pixels.begin() + (y + 1) * width * 3, padded.begin() + y * row_stride);
+    auto src = ImageView_t<const uint8_t>::from_interleaved(padded.data(), width, height, 3, row_stride).get_region(4, 3, 20, 15);
+    ImageRGBA_t<uint8_t> planes;
+    planes.allocate(20, 15, 3);
+    copy_image_view(src, planes.get_view());
+    for (int y = 0; y < 15; y++)
+        for (int x = 0; x < 20; x++)
+            for (int k = 0; k < 3; k++)
+                REQUIRE(planes.get_channel(k)(y, x) == pixels[((y + 3) * width + x + 4) * 3 + k]);
+}
+
+TEST_CASE("image format conversion", "[core]") {
+    using namespace igcclib;
+    std::srand(4);
+    const int width = 29, height = 17;
+    const ImageFormat formats[] = {ImageFormat::GRAY, ImageFormat::RGB, ImageFormat::RGBA, ImageFormat::BGR, ImageFormat::BGRA};
+
+    // naive per-pixel reference, reads (r,g,b,a) and writes the channels in the order of the format,
+    // returns whether the destination gets an opaque alpha
+    auto read_rgba = [](const uint8_t* p, ImageFormat fmt, double* rgba) {
+        rgba[3] = -1;
+        switch (fmt) {
+        case ImageFormat::GRAY: rgba[0] = rgba[1] = rgba[2] = p[0]; break;
+        case ImageFormat::RGB: rgba[0] = p[0]; rgba[1] = p[1]; rgba[2] = p[2]; break;
+        case ImageFormat::RGBA: rgba[0] = p[0]; rgba[1] = p[1]; rgba[2] = p[2]; rgba[3] = p[3]; break;
+        case ImageFormat::BGR: rgba[0] = p[2]; rgba[1] = p[1]; rgba[2] = p[0]; break;
+        default: rgba[0] = p[2]; rgba[1] = p[1]; rgba[2] = p[0]; rgba[3] = p[3]; break;
+        }
+    };
+    auto write_rgba = [](const double* rgba, ImageFormat src_fmt, ImageFormat fmt, double* out) {
+        double gray = src_fmt == ImageFormat::GRAY ? rgba[0] : 0.299 * rgba[0] + 0.587 * rgba[1] + 0.114 * rgba[2];
+        bool is_alpha_added = rgba[3] < 0;
+        switch (fmt) {
+        case ImageFormat::GRAY: out[0] = gray; break;
+        case ImageFormat::RGB: out[0] = rgba[0]; out[1] = rgba[1]; out[2] = rgba[2]; break;
+        case ImageFormat::RGBA: out[0] = rgba[0]; out[1] = rgba[1]; out[2] = rgba[2]; out[3] = rgba[3]; break;
+        case ImageFormat::BGR: out[0] = rgba[2]; out[1] = rgba[1]; out[2] = rgba[0]; break;
+        default: out[0] = rgba[2]; out[1] = rgba[1]; out[2] = rgba[0]; out[3] = rgba[3]; break;
+        }
+        return is_alpha_added && (fmt == ImageFormat::RGBA || fmt == ImageFormat::BGRA);
+    };
+
+    for (auto src_format : formats)
+        for (auto dst_format : formats) {
+            int src_nch = get_num_channel(src_format);
+            int dst_nch = get_num_channel(dst_format);
+            std::vector<uint8_t> src((size_t)width * height * src_nch);
+            for (auto& p : src)
+                p = (uint8_t)(std::rand() % 256);
+            auto src_view = ImageView_t<const uint8_t>::from_interleaved(src.data(), width, height, src_nch);
+
+            // uint8 to uint8 with saturation, and uint8 to double in unit range
+            std::vector<uint8_t> dst_u8((size_t)width * height * dst_nch);
+            std::vector<double> dst_d((size_t)width * height * dst_nch);
+            convert_image_format(src_view, src_format,
+                ImageView_t<uint8_t>::from_interleaved(dst_u8.data(), width, height, dst_nch), dst_format, 1.5, -20);
+            convert_image_format(src_view, src_format,
+                ImageView_t<double>::from_interleaved(dst_d.data(), width, height, dst_nch), dst_format, 1.0 / 255);
+
+            for (int i = 0; i < width * height; i++) {
+                double rgba[4], expect[4];
+                read_rgba(&src[(size_t)i * src_nch], src_format, rgba);
+                bool is_alpha_added = write_rgba(rgba, src_format, dst_format, expect);
+                for (int k = 0; k < dst_nch; k++) {
+                    bool is_added = is_alpha_added && k == 3;
+                    double v_u8 = std::min(std::max(std::round(expect[k] * 1.5 - 20), 0.0), 255.0);
+                    REQUIRE(dst_u8[(size_t)i * dst_nch + k] == (is_added ? 255 : (uint8_t)v_u8));
+                    REQUIRE_THAT(dst_d[(size_t)i * dst_nch + k], WithinAbs(is_added ? 1.0 : expect[k] / 255, 1e-12));
+                }
+            }
+        }
+
+    // convert_to() keeps the channels, rounds and saturates integer outputs
+    ImageRGBA_d img;
+    img.set_gray(MATRIX_d::Random(height, width), MATRIX_d::Random(height, width));
+    ImageRGBA_u img_u8;
+    img.convert_to(img_u8, 200, 100);
+    REQUIRE(img_u8.is_gray());
+    REQUIRE(img_u8.has_alpha());
+    for (int k : {0, 3})
+        for (int i = 0; i < width * height; i++) {
+            double v = std::min(std::max(std::round(img.get_channel(k)(i) * 200 + 100), 0.0), 255.0);
+            REQUIRE(img_u8.get_channel(k)(i) == (uint8_t)v);
+        }
+}
+
+TEST_CASE("sparse mean value cage", "[core]") {
+    using namespace igcclib;
+    const double pi = std::acos(-1.0);
+
+    // a circle with a narrow notch cut to its center, the weights near the notch are large and of both signs
+    const int n_circle = 64;
+    fMATRIX cage(n_circle + 1, 2);
+    for (int k = 0; k < n_circle; k++) {
+        double a = 2 * pi * (k + 0.5) / n_circle;
+        cage.row(k) << std::cos(a), std::sin(a);
+    }
+    cage.row(n_circle) << 0, 0;
+
+    std::srand(5);
+    const int n_pts = 2000;
+    fMATRIX pts(n_pts, 2);
+    for (int i = 0; i < n_pts;) {
+        double x = 2.0 * std::rand() / RAND_MAX - 1, y = 2.0 * std::rand() / RAND_MAX - 1;
+        bool is_in_notch = x > 0 && std::abs(y) < x * std::tan(pi / n_circle);
+        if (x * x + y * y < 0.9 && !is_in_notch)
+            pts.row(i++) << x, y;
+    }
+
+    const double threshold = 0.05;
+    MeanValueCage_2 dense, sparse;
+    dense.init(cage, pts);
+    sparse.init(cage, pts, threshold);
+    REQUIRE(sparse.is_sparse());
+    const fMATRIX& w_dense = dense.get_weights_dense();
+    fMATRIX w_sparse = sparse.get_weights_sparse().toDense();
+
+    // each sparse row is the kept dense weights renormalized, or the full dense row if they cancel out
+    int n_full_row = 0;
+    for (int i = 0; i < n_pts; i++) {
+        double kept_sum = 0;
+        for (int k = 0; k < w_dense.cols(); k++)
+            if (std::abs(w_dense(i, k)) >= threshold)
+                kept_sum += w_dense(i, k);
+        bool is_full_row = kept_sum < MeanValueCage_2::MIN_KEPT_WEIGHT_SUM;
+        n_full_row += is_full_row;
+
+        REQUIRE_THAT(w_sparse.row(i).sum(), WithinAbs(1.0, 1e-9));
+        for (int k = 0; k < w_dense.cols(); k++) {
+            double expect = is_full_row ? w_dense(i, k) : (std::abs(w_dense(i, k)) >= threshold ? w_dense(i, k) / kept_sum : 0.0);
+            REQUIRE_THAT(w_sparse(i, k), WithinAbs(expect, 1e-12));
+        }
+    }
+    REQUIRE(n_full_row > 0);
+
+    // the dropped weights are small, so no point moves far from its dense deformation
+    fMATRIX deformed = cage;
+    deformed.col(0) *= 1.5;
+    deformed.row(n_circle) << 0.2, 0.1;
+    double max_shift = (sparse.apply(deformed) - dense.apply(deformed)).rowwise().norm().maxCoeff();
+    REQUIRE(max_shift < 1.0);
+}
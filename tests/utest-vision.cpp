@@ -5,6 +5,8 @@
 #include <spdlog/spdlog.h>
 #include <igcclib/vision/igcclib_opencv.hpp>
 #include <igcclib/vision/igcclib_image_processing.hpp>
+#include <igcclib/vision/ImageWarper.hpp>
+#include <igcclib/vision/CameraModel.hpp>
 
 // required definitions of data directory in IGCCLIB_TEST_DATA_DIR, otherwise raise compile error
 #ifndef IGCCLIB_TEST_DATA_DIR
@@ -62,4 +64,209 @@ TEST_CASE("test vision component", "[vision]") {
     
     // resize it
     REQUIRE_NOTHROW(do_resize(img, 512, 512));
-}
\ No newline at end of file
+}
+TEST_CASE("largest connected component", "[vision]") {
+    // 4-row strips, so that the components cross the strip borders in the tiled version
+    const int strip_height = 4;
+    cv::Mat lcc;
+
+    // no foreground gives an empty mask
+    cv::Mat empty = cv::Mat::zeros(32, 40, CV_8UC1);
+    igcclib::get_largest_connected_component(empty, &lcc);
+    REQUIRE(lcc.type() == CV_8UC1);
+    REQUIRE(lcc.size() == empty.size());
+    REQUIRE(cv::countNonZero(lcc) == 0);
+    igcclib::get_largest_connected_component_tiled(empty, &lcc, 8, strip_height);
+    REQUIRE(lcc.size() == empty.size());
+    REQUIRE(cv::countNonZero(lcc) == 0);
+
+    // two components of the same area and a smaller one, the first one in scan order is kept
+    cv::Mat img = cv::Mat::zeros(32, 40, CV_8UC1);
+    img(cv::Rect(2, 2, 6, 6)).setTo(1);
+    img(cv::Rect(20, 18, 9, 4)).setTo(7);
+    img(cv::Rect(30, 2, 3, 3)).setTo(1);
+    cv::Mat expected = cv::Mat::zeros(img.size(), CV_8UC1);
+    expected(cv::Rect(2, 2, 6, 6)).setTo(255);
+
+    for (int connectivity : {4, 8}) {
+        igcclib::get_largest_connected_component(img, &lcc, connectivity);
+        REQUIRE(cv::norm(lcc, expected, cv::NORM_INF) == 0);
+        igcclib::get_largest_connected_component_tiled(img, &lcc, connectivity, strip_height);
+        REQUIRE(cv::norm(lcc, expected, cv::NORM_INF) == 0);
+    }
+}
+
+TEST_CASE("resize image", "[vision]") {
+    cv::Mat img(37, 53, CV_8UC3), img_d(37, 53, CV_64FC3);
+    cv::randu(img, 0, 256);
+    cv::randu(img_d, -100, 100);
+    igcclib::ImageRGBA_t<uint8_t> eigen_img;
+    igcclib::ImageRGBA_d eigen_img_d;
+    igcclib::to_eigen_image(img, eigen_img);
+    igcclib::to_eigen_image(img_d, eigen_img_d);
+
+    for (auto size : {cv::Size(80, 61), cv::Size(20, 15), cv::Size(53, 37), cv::Size(29, 70)}) {
+        // 8-bit images, opencv uses fixed-point weights so the rounding may differ by 1
+        cv::Mat expected, output;
+        cv::resize(img, expected, size, 0, 0, cv::INTER_LINEAR);
+        igcclib::ImageRGBA_t<uint8_t> resized;
+        igcclib::resize_image(eigen_img, resized, size.width, size.height);
+        igcclib::to_opencv_image(resized, output);
+        REQUIRE(output.size() == size);
+        REQUIRE(cv::norm(output, expected, cv::NORM_INF) <= 1);
+
+        // double images
+        cv::resize(img_d, expected, size, 0, 0, cv::INTER_LINEAR);
+        igcclib::ImageRGBA_d resized_d;
+        igcclib::resize_image(eigen_img_d, resized_d, size.width, size.height);
+        igcclib::to_opencv_image(resized_d, output, true);
+        REQUIRE(cv::norm(output, expected, cv::NORM_INF) < 1e-9);
+
+        // resizing in place gives the same result
+        auto inplace = eigen_img;
+        igcclib::resize_image(inplace, inplace, size.width, size.height);
+        for (int i = 0; i < 3; i++)
+            REQUIRE(inplace.get_channel(i) == resized.get_channel(i));
+    }
+}
+
+TEST_CASE("rotate image", "[vision]") {
+    // a smooth image, so that the fixed-point sampling positions of opencv change the values by at most 1
+    cv::Mat img(48, 64, CV_8UC3);
+    for (int y = 0; y < img.rows; y++)
+        for (int x = 0; x < img.cols; x++)
+            img.at<cv::Vec3b>(y, x) = cv::Vec3b(x * 3, y * 4, (x + y) * 2);
+    cv::Mat ones(img.size(), CV_8UC1, cv::Scalar(255));
+
+    const double pi = std::acos(-1.0);
+    for (double angle : {0.3, -1.2, 2.5}) {
+        double c = std::cos(angle), s = std::sin(angle);
+        for (bool preserve_image_size : {true, false}) {
+            // the old implementation, rotating about the center by cv::getRotationMatrix2D(),
+            // or shifting the rotated image so that its bounding box starts at (0,0)
+            cv::Mat expected, transform;
+            cv::Size expected_size = img.size();
+            if (preserve_image_size) {
+                transform = cv::getRotationMatrix2D(cv::Point2f(img.cols / 2.0f, img.rows / 2.0f), angle / pi * 180, 1.0);
+                cv::warpAffine(img, expected, transform, expected_size);
+            }
+            else {
+                double xs[] = {0, 0, (double)img.cols, (double)img.cols};
+                double ys[] = {0, (double)img.rows, (double)img.rows, 0};
+                double minx = 1e10, miny = 1e10, maxx = -1e10, maxy = -1e10;
+                for (int i = 0; i < 4; i++) {
+                    double x = c * xs[i] + s * ys[i];
+                    double y = -s * xs[i] + c * ys[i];
+                    minx = std::min(minx, x);
+                    miny = std::min(miny, y);
+                    maxx = std::max(maxx, x);
+                    maxy = std::max(maxy, y);
+                }
+                transform = (cv::Mat_<double>(3, 3) << c, s, -minx, -s, c, -miny, 0, 0, 1);
+                expected_size = cv::Size((int)(maxx - minx), (int)(maxy - miny));
+                cv::warpPerspective(img, expected, transform, expected_size);
+            }
+
+            cv::Mat output, valid;
+            igcclib::fMATRIX_3 transmat;
+            igcclib::rotate_image(output, &transmat, img, angle, preserve_image_size);
+            REQUIRE(output.size() == expected_size);
+            for (int i = 0; i < transform.rows; i++)
+                for (int j = 0; j < 3; j++)
+                    REQUIRE_THAT(transmat(j, i), Catch::Matchers::WithinAbs(transform.at<double>(i, j), 1e-6));
+
+            // pixels next to the border of the rotated image mix with the border color, and are skipped
+            igcclib::rotate_image(valid, nullptr, ones, angle, preserve_image_size);
+            cv::erode(valid == 255, valid, cv::Mat());
+            REQUIRE(cv::norm(output, expected, cv::NORM_INF, valid) <= 1);
+
+            // the warper gives the same image
+            igcclib::ImageWarper warper;
+            warper.init_rotation(angle, img.cols, img.rows, preserve_image_size);
+            warper.apply(img, output);
+            REQUIRE(output.size() == expected_size);
+            REQUIRE(cv::norm(output, expected, cv::NORM_INF, valid) <= 1);
+        }
+    }
+}
+
+TEST_CASE("camera projection", "[vision]") {
+    // opencv camera with all 14 distortion coefficients, and a pose given by rvec and tvec
+    cv::Mat camera_matrix = (cv::Mat_<double>(3, 3) << 500, 0, 320, 0, 480, 240, 0, 0, 1);
+    cv::Mat dist = (cv::Mat_<double>(1, 14) << 0.1, -0.05, 0.001, -0.002, 0.01, 0.02, -0.01, 0.005,
+        0.001, -0.0005, 0.0008, 0.0003, 0.01, -0.02);
+    cv::Mat rvec = (cv::Mat_<double>(3, 1) << 0.1, -0.2, 0.05);
+    cv::Mat tvec = (cv::Mat_<double>(3, 1) << 0.3, -0.1, 2.0);
+    cv::Mat rotmat;
+    cv::Rodrigues(rvec, rotmat);
+
+    // the same camera, with right-mul matrices
+    igcclib::CameraModel camera;
+    igcclib::fMATRIX_3 projmat;
+    igcclib::fMATRIX_4 extmat = igcclib::fMATRIX_4::Identity();
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            projmat(j, i) = camera_matrix.at<double>(i, j);
+            extmat(j, i) = rotmat.at<double>(i, j);
+        }
+        extmat(3, i) = tvec.at<double>(i);
+    }
+    igcclib::fVECTOR distcoef(14);
+    for (int i = 0; i < 14; i++)
+        distcoef(i) = dist.at<double>(i);
+    camera.set_projection_matrix(projmat);
+    camera.set_extrinsic_matrix(extmat);
+    camera.set_distortion_coefficient(distcoef);
+
+    const int n_point = 5000;
+    cv::Mat pts(n_point, 3, CV_64FC1);
+    cv::randu(pts, -0.5, 0.5);
+    igcclib::fMATRIX eigen_pts(n_point, 3);
+    std::vector<float> xs(n_point), ys(n_point), zs(n_point);
+    for (int i = 0; i < n_point; i++)
+        for (int j = 0; j < 3; j++)
+            eigen_pts(i, j) = pts.at<double>(i, j);
+    for (int i = 0; i < n_point; i++) {
+        xs[i] = (float)eigen_pts(i, 0);
+        ys[i] = (float)eigen_pts(i, 1);
+        zs[i] = (float)eigen_pts(i, 2);
+    }
+
+    for (double skew : {0.0, 3.0}) {
+        // opencv ignores the skew, so the projection is the same as without it
+        projmat(1, 0) = skew;
+        camera.set_projection_matrix(projmat);
+        for (bool with_distortion : {true, false}) {
+            cv::Mat expected;
+            cv::projectPoints(pts.reshape(3), rvec, tvec, camera_matrix, with_distortion ? dist : cv::Mat(), expected);
+            expected = expected.reshape(1);
+
+            igcclib::fMATRIX output = camera.project_points(eigen_pts, with_distortion);
+            std::vector<float> us(n_point), vs(n_point);
+            camera.project_points(n_point, xs.data(), ys.data(), zs.data(), us.data(), vs.data(), with_distortion);
+            for (int i = 0; i < n_point; i++) {
+                REQUIRE_THAT(output(i, 0), Catch::Matchers::WithinAbs(expected.at<double>(i, 0), 1e-8));
+                REQUIRE_THAT(output(i, 1), Catch::Matchers::WithinAbs(expected.at<double>(i, 1), 1e-8));
+                REQUIRE_THAT(us[i], Catch::Matchers::WithinAbs(expected.at<double>(i, 0), 1e-3));
+                REQUIRE_THAT(vs[i], Catch::Matchers::WithinAbs(expected.at<double>(i, 1), 1e-3));
+            }
+        }
+    }
+    projmat(1, 0) = 0;
+    camera.set_projection_matrix(projmat);
+
+    // undistortion inverts the projection of points in camera coordinate
+    camera.set_extrinsic_matrix(igcclib::fMATRIX_4::Identity());
+    std::vector<float> cam_xs(n_point), cam_ys(n_point), cam_zs(n_point, 1.0f);
+    for (int i = 0; i < n_point; i++) {
+        cam_xs[i] = xs[i];
+        cam_ys[i] = ys[i];
+    }
+    std::vector<float> us(n_point), vs(n_point), xn(n_point), yn(n_point);
+    camera.project_points(n_point, cam_xs.data(), cam_ys.data(), cam_zs.data(), us.data(), vs.data());
+    camera.undistort_points(n_point, us.data(), vs.data(), xn.data(), yn.data(), true, 20);
+    for (int i = 0; i < n_point; i++) {
+        REQUIRE_THAT(xn[i], Catch::Matchers::WithinAbs(cam_xs[i], 1e-5));
+        REQUIRE_THAT(yn[i], Catch::Matchers::WithinAbs(cam_ys[i], 1e-5));
+    }
+}